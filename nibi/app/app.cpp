@@ -1,11 +1,15 @@
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include <libnibi/alloc_profiler.hpp>
+#include <libnibi/heap.hpp>
 #include <libnibi/nibi.hpp>
 
 #include "repl/repl.hpp"
@@ -24,6 +28,21 @@ using namespace nibi;
 
 namespace {
 
+// Number of allocation sites listed by --alloc-profile
+static constexpr std::size_t ALLOC_PROFILE_REPORT_SITES = 25;
+
+// Where --alloc-profile writes its collapsed stacks
+std::string alloc_profile_path;
+
+// Bytes each program may take, set by --mem-budget. 0 if unlimited
+std::size_t memory_budget{0};
+
+// Lambda calls that may nest, set by --max-depth. 0 if unlimited
+std::size_t max_call_depth{nibi::config::NIBI_MAX_CALL_DEPTH};
+
+// How lambda bodies are run, set by --tier
+execution_tier_e execution_tier{execution_tier_e::BYTECODE};
+
 class program_data_controller_c {
 public:
   program_data_controller_c(std::vector<std::string> &args,
@@ -101,6 +120,9 @@ void error_callback_function(nibi::error_c error) {
 void run_from_file(std::filesystem::path file_name) {
   auto file_interpreter =
       interpreter_factory_c::file_interpreter(error_callback_function);
+  file_interpreter->set_memory_budget(memory_budget);
+  file_interpreter->set_max_call_depth(max_call_depth);
+  file_interpreter->set_execution_tier(execution_tier);
 
   // Bring in the standard library if enabled
   if (pdc->use_std()) {
@@ -132,6 +154,71 @@ void show_help() {
             << std::endl;
   std::cout << "  -i, --include <dirs>  Add include directory (`:` delimited)"
             << std::endl;
+  std::cout << "  --mem-stats           Print heap usage to stderr on exit"
+            << std::endl;
+  std::cout << "  --alloc-profile <file>" << std::endl;
+  std::cout << "                        Attribute allocations to call sites,"
+            << std::endl;
+  std::cout << "                        write collapsed stacks to <file> and"
+            << std::endl;
+  std::cout << "                        the top sites to stderr on exit"
+            << std::endl;
+  std::cout << "  --mem-budget <bytes>  Raise an error when a program takes"
+            << std::endl;
+  std::cout << "                        more than <bytes> of memory"
+            << std::endl;
+  std::cout << "  --max-depth <calls>   Raise an error when function calls"
+            << std::endl;
+  std::cout << "                        nest deeper than <calls>, "
+            << nibi::config::NIBI_MAX_CALL_DEPTH << " unless" << std::endl;
+  std::cout << "                        given. Calls in tail position do not"
+            << std::endl;
+  std::cout << "                        nest, 0 removes the limit" << std::endl;
+  std::cout << "  --tier <tree|bytecode|closure>" << std::endl;
+  std::cout << "                        How the bodies of functions are run,"
+            << std::endl;
+  std::cout << "                        bytecode unless given" << std::endl;
+}
+
+// Registered with atexit so it runs however the program ends,
+// including `exit` and runtime errors
+void show_mem_stats() {
+  auto stats = heap::get_stats();
+  std::cerr << "\n[ MEMORY ]\n\n"
+            << "allocations: " << stats.allocations << "\n"
+            << "frees:       " << stats.frees << "\n"
+            << "live bytes:  " << stats.live_bytes << "\n"
+            << "peak bytes:  " << stats.peak_bytes << "\n\n"
+            << std::left << std::setw(14) << "type" << std::right
+            << std::setw(12) << "live cells" << std::setw(16)
+            << "payload bytes" << "\n";
+  for (std::size_t i = 0; i <= UINT8_MAX; i++) {
+    auto type = static_cast<cell_type_e>(i);
+    auto type_stats = heap::get_type_stats(type);
+    if (!type_stats.live_cells && !type_stats.payload_bytes) {
+      continue;
+    }
+    std::cerr << std::left << std::setw(14) << cell_type_to_string(type)
+              << std::right << std::setw(12) << type_stats.live_cells
+              << std::setw(16) << type_stats.payload_bytes << "\n";
+  }
+  std::cerr << std::flush;
+}
+
+// Registered with atexit, as show_mem_stats
+void write_alloc_profile() {
+  alloc_profiler::disable();
+  alloc_profiler::write_report(std::cerr, ALLOC_PROFILE_REPORT_SITES);
+
+  std::ofstream out(alloc_profile_path);
+  if (!out.is_open()) {
+    std::cerr << "Failed to write allocation profile to `"
+              << alloc_profile_path << "`" << std::endl;
+    return;
+  }
+  alloc_profiler::write_collapsed(out);
+  std::cerr << "Allocation profile written to `" << alloc_profile_path << "`"
+            << std::endl;
 }
 
 void show_version() {
@@ -301,6 +388,69 @@ int main(int argc, char **argv) {
         return 0;
       }
 
+      if (args[i] == "--mem-stats") {
+        std::atexit(show_mem_stats);
+        continue;
+      }
+
+      if (args[i] == "--alloc-profile") {
+        if (i + 1 >= args.size()) {
+          std::cout << "Error: Expected value for [--alloc-profile]"
+                    << std::endl;
+          return 1;
+        }
+        alloc_profile_path = args[++i];
+        alloc_profiler::enable();
+        std::atexit(write_alloc_profile);
+        continue;
+      }
+
+      if (args[i] == "--mem-budget") {
+        if (i + 1 >= args.size()) {
+          std::cout << "Error: Expected value for [--mem-budget]"
+                    << std::endl;
+          return 1;
+        }
+        try {
+          memory_budget = std::stoull(args[++i]);
+        } catch (...) {
+          std::cout << "Error: Invalid value for [--mem-budget]: " << args[i]
+                    << std::endl;
+          return 1;
+        }
+        continue;
+      }
+
+      if (args[i] == "--max-depth") {
+        if (i + 1 >= args.size()) {
+          std::cout << "Error: Expected value for [--max-depth]" << std::endl;
+          return 1;
+        }
+        try {
+          max_call_depth = std::stoull(args[++i]);
+        } catch (...) {
+          std::cout << "Error: Invalid value for [--max-depth]: " << args[i]
+                    << std::endl;
+          return 1;
+        }
+        continue;
+      }
+
+      if (args[i] == "--tier") {
+        if (i + 1 >= args.size()) {
+          std::cout << "Error: Expected value for [--tier]" << std::endl;
+          return 1;
+        }
+        auto tier = execution_tier_from_string(args[++i]);
+        if (!tier.has_value()) {
+          std::cout << "Error: Invalid value for [--tier]: " << args[i]
+                    << std::endl;
+          return 1;
+        }
+        execution_tier = tier.value();
+        continue;
+      }
+
       if (args[i] == "-n" || args[i] == "--no-std") {
         use_std = false;
         continue;
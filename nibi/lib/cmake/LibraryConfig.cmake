@@ -34,6 +34,11 @@ configure_file(${PROJECT_SOURCE_DIR}/libnibi/generate/version.hpp.in
   "${PROJECT_SOURCE_DIR}/libnibi/version.hpp" @ONLY)
 set(HEADERS ${HEADERS} ${PROJECT_SOURCE_DIR}/libnibi/version.hpp)
 
+# Create 'build_config.hpp'
+configure_file(${PROJECT_SOURCE_DIR}/libnibi/generate/build_config.hpp.in
+  "${PROJECT_SOURCE_DIR}/libnibi/build_config.hpp" @ONLY)
+set(HEADERS ${HEADERS} ${PROJECT_SOURCE_DIR}/libnibi/build_config.hpp)
+
 # Install headers
 #install(FILES ${HEADERS}
 #  DESTINATION "${INSTALL_INCLUDE_DIR}/${LIBRARY_FOLDER}" )
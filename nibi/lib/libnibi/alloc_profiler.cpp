@@ -0,0 +1,247 @@
+#include "libnibi/alloc_profiler.hpp"
+#include "libnibi/cell.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+    Stacks are stored as a tree of call sites. Each node is a site
+    reached from its parent node, so entering a call is a lookup of
+    (parent, site) and recording an allocation adds to the node at the
+    top of the path. Node 0 is the root, it takes anything allocated
+    outside of a call (while parsing, for instance).
+*/
+
+namespace nibi {
+namespace alloc_profiler {
+
+std::atomic<bool> enabled{false};
+
+namespace {
+
+// Longest label kept for a call site, operations that are
+// lists themselves can be long when flattened
+static constexpr std::size_t MAX_LABEL_LENGTH = 64;
+
+struct sample_s {
+  std::size_t bytes{0};
+  std::size_t cells{0};
+  std::size_t allocations{0};
+};
+
+struct node_s {
+  uint32_t parent;
+  uint32_t label;
+  sample_s self;
+};
+
+class profile_c {
+public:
+  profile_c() {
+    nodes_.push_back({0, intern("<no call>"), {}});
+    path_.push_back(0);
+  }
+
+  void enter(cell_c &site) {
+    auto label = label_id(site);
+    auto parent = path_.back();
+    auto key = (static_cast<uint64_t>(parent) << 32) | label;
+    auto it = children_.find(key);
+    if (it != children_.end()) {
+      path_.push_back(it->second);
+      return;
+    }
+    auto node = static_cast<uint32_t>(nodes_.size());
+    nodes_.push_back({parent, label, {}});
+    children_[key] = node;
+    path_.push_back(node);
+  }
+
+  void leave() {
+    if (path_.size() > 1) {
+      path_.pop_back();
+    }
+  }
+
+  void record(const std::size_t bytes, const bool cell) {
+    auto &self = nodes_[path_.back()].self;
+    self.bytes += bytes;
+    self.allocations++;
+    if (cell) {
+      self.cells++;
+    }
+  }
+
+  void write_report(std::ostream &out, const std::size_t limit) const {
+    // Sites are reported by where they allocate, whatever called them
+    std::vector<sample_s> by_label(labels_.size());
+    for (auto &node : nodes_) {
+      auto &total = by_label[node.label];
+      total.bytes += node.self.bytes;
+      total.cells += node.self.cells;
+      total.allocations += node.self.allocations;
+    }
+
+    std::vector<uint32_t> order;
+    for (uint32_t i = 0; i < by_label.size(); i++) {
+      if (by_label[i].allocations) {
+        order.push_back(i);
+      }
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t lhs, uint32_t rhs) {
+      if (by_label[lhs].bytes != by_label[rhs].bytes) {
+        return by_label[lhs].bytes > by_label[rhs].bytes;
+      }
+      return by_label[lhs].allocations > by_label[rhs].allocations;
+    });
+    if (limit && order.size() > limit) {
+      order.resize(limit);
+    }
+
+    out << "\n[ ALLOCATION SITES ]\n\n"
+        << std::setw(14) << "bytes" << std::setw(12) << "cells"
+        << std::setw(14) << "allocations"
+        << "  site\n";
+    for (auto label : order) {
+      auto &total = by_label[label];
+      out << std::setw(14) << total.bytes << std::setw(12) << total.cells
+          << std::setw(14) << total.allocations << "  " << labels_[label]
+          << "\n";
+    }
+    out << std::flush;
+  }
+
+  void write_collapsed(std::ostream &out) const {
+    std::vector<uint32_t> frames;
+    for (uint32_t i = 0; i < nodes_.size(); i++) {
+      if (!nodes_[i].self.bytes) {
+        continue;
+      }
+      frames.clear();
+      for (auto node = i; node; node = nodes_[node].parent) {
+        frames.push_back(nodes_[node].label);
+      }
+      if (frames.empty()) {
+        frames.push_back(nodes_[0].label);
+      }
+      for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+        if (it != frames.rbegin()) {
+          out << ';';
+        }
+        out << labels_[*it];
+      }
+      out << ' ' << nodes_[i].self.bytes << '\n';
+    }
+    out << std::flush;
+  }
+
+private:
+  std::vector<node_s> nodes_;
+  std::vector<uint32_t> path_;
+  std::unordered_map<uint64_t, uint32_t> children_;
+  std::vector<std::string> labels_;
+  std::unordered_map<std::string, uint32_t> label_ids_;
+
+  // Labels of located sites by their location and type, and of the
+  // symbols that have no location by their id. The cell at a location
+  // is always the same form, so each label is only built once
+  struct site_key_s {
+    uint64_t location;
+    cell_type_e type;
+    bool operator==(const site_key_s &other) const {
+      return location == other.location && type == other.type;
+    }
+  };
+  struct site_hash_s {
+    std::size_t operator()(const site_key_s &key) const {
+      return std::hash<uint64_t>()(key.location) ^
+             static_cast<std::size_t>(key.type);
+    }
+  };
+  std::unordered_map<site_key_s, uint32_t, site_hash_s> site_labels_;
+  std::unordered_map<symbol_id_t, uint32_t> symbol_labels_;
+
+  uint32_t label_id(cell_c &site) {
+    auto location = site.packed_locator();
+    if (!location) {
+      if (site.type != cell_type_e::SYMBOL) {
+        return intern(label_of(site));
+      }
+      auto [it, added] = symbol_labels_.try_emplace(site.as_symbol_id(), 0);
+      if (added) {
+        it->second = intern(label_of(site));
+      }
+      return it->second;
+    }
+    site_key_s key{location.bits, site.type};
+    auto it = site_labels_.find(key);
+    if (it != site_labels_.end()) {
+      return it->second;
+    }
+    auto id = intern(label_of(site));
+    site_labels_[key] = id;
+    return id;
+  }
+
+  uint32_t intern(const std::string &label) {
+    auto it = label_ids_.find(label);
+    if (it != label_ids_.end()) {
+      return it->second;
+    }
+    auto id = static_cast<uint32_t>(labels_.size());
+    labels_.push_back(label);
+    label_ids_[label] = id;
+    return id;
+  }
+
+  // `name file:line:column`, the same a call trace shows. The collapsed
+  // format separates frames with ';' so it may not appear in a label
+  static std::string label_of(cell_c &site) {
+    auto label = site.to_string(false, true);
+    if (label.size() > MAX_LABEL_LENGTH) {
+      label.resize(MAX_LABEL_LENGTH);
+    }
+    if (auto locator = site.locator()) {
+      label += " ";
+      label += locator->get_source_name();
+      label += ":" + std::to_string(locator->get_line()) + ":" +
+               std::to_string(locator->get_column());
+    }
+    std::replace(label.begin(), label.end(), ';', ',');
+    std::replace(label.begin(), label.end(), '\n', ' ');
+    return label;
+  }
+};
+
+// Never destroyed, reports are written from atexit handlers
+// after thread locals have been torn down
+profile_c &get_profile() {
+  thread_local profile_c *profile = new profile_c();
+  return *profile;
+}
+
+} // namespace
+
+void enable() { enabled.store(true, std::memory_order_relaxed); }
+
+void disable() { enabled.store(false, std::memory_order_relaxed); }
+
+void enter(cell_c &site) { get_profile().enter(site); }
+
+void leave() { get_profile().leave(); }
+
+void record(const std::size_t bytes, const bool cell) {
+  get_profile().record(bytes, cell);
+}
+
+void write_report(std::ostream &out, const std::size_t limit) {
+  get_profile().write_report(out, limit);
+}
+
+void write_collapsed(std::ostream &out) { get_profile().write_collapsed(out); }
+
+} // namespace alloc_profiler
+} // namespace nibi
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+/*
+    Opt-in allocation profiler. While enabled, every cell and payload
+    counted by heap.hpp is also attributed to the stack of instructions
+    the interpreter is executing, identified by the source location of
+    each call. Nothing is recorded, and the only cost is a flag check
+    per call and per allocation, until enable() is called.
+
+    Like the heap counts, samples are kept per thread and the reports
+    cover the calling thread.
+*/
+
+namespace nibi {
+
+class cell_c;
+
+namespace alloc_profiler {
+
+//! \brief Set while allocations are being attributed
+//! \note  Use is_enabled, this is only visible for it to be inlined
+extern std::atomic<bool> enabled;
+
+//! \brief Check if allocations are being attributed
+inline bool is_enabled() { return enabled.load(std::memory_order_relaxed); }
+
+//! \brief Start attributing allocations to the calls being executed
+extern void enable();
+
+//! \brief Stop attributing allocations. Samples taken are kept
+extern void disable();
+
+//! \brief Enter a call, allocations are attributed to it until it
+//!        is left
+//! \param site The instruction making the call, its location and
+//!        name label the frame
+extern void enter(cell_c &site);
+
+//! \brief Leave the innermost call
+extern void leave();
+
+//! \brief Attribute an allocation to the current stack of calls
+//! \param bytes The number of bytes taken
+//! \param cell Set if the allocation is a cell rather than a payload
+//! \note  Called by the heap counters, see heap.hpp
+extern void record(const std::size_t bytes, const bool cell);
+
+//! \brief Write the allocation sites ordered by the bytes they
+//!        allocated, with the number of cells and allocations made
+//! \param limit Number of sites to list, 0 lists them all
+extern void write_report(std::ostream &out, const std::size_t limit = 0);
+
+//! \brief Write the samples in the collapsed stack format, one line
+//!        per stack (`outer;inner;innermost bytes`), as read by
+//!        flamegraph.pl and speedscope
+extern void write_collapsed(std::ostream &out);
+
+//! \brief Enters a call for the lifetime of the object, if profiling
+//! \note  Leaves the call when an exception unwinds through it
+class frame_c {
+public:
+  frame_c(cell_c &site) : active_(is_enabled()) {
+    if (active_) {
+      enter(site);
+    }
+  }
+  ~frame_c() {
+    if (active_) {
+      leave();
+    }
+  }
+  frame_c(const frame_c &) = delete;
+  frame_c &operator=(const frame_c &) = delete;
+
+private:
+  bool active_;
+};
+
+} // namespace alloc_profiler
+} // namespace nibi
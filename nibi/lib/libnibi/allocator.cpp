@@ -0,0 +1,307 @@
+#include "libnibi/allocator.hpp"
+#include "libnibi/cell.hpp"
+#include "libnibi/heap.hpp"
+
+#include <array>
+#include <mutex>
+#include <new>
+#include <vector>
+
+/*
+    Cells are small, short lived, and created at a very high rate by the
+    interpreter (every arithmetic result, every comparison, every list
+    element). Routing them through malloc/free dominated the run time of
+    the `test_perfs` benchmarks, so they are served from slabs instead.
+
+    Each slab is SLAB_SIZE bytes, cache line aligned, and carved into
+    blocks of a single power-of-two size class. Free blocks are kept on
+    an intrusive singly linked list per size class per thread so the
+    common allocate / release pair never takes a lock. When a thread
+    runs dry it takes a batch from the shared depot, and only when that
+    is empty is a new slab requested from the system.
+
+    The out-of-line payloads of LIST, DICT, FUNCTION, ALIAS and
+    ENVIRONMENT cells come from the same slabs (see pooled_s), so
+    creating a list or a closure never reaches malloc either. Every
+    allocation is counted against its pool for the calling thread, and
+    payloads are also counted against their cell type (see heap.hpp).
+
+    Slabs are never handed back to the system. Memory freed by one
+    thread is reused by that thread, and when a thread exits its free
+    lists are given back to the depot for others to use.
+*/
+
+namespace nibi {
+namespace allocator {
+
+namespace {
+
+// Counts of the calling thread, indexed by pool_e
+thread_local std::array<pool_stats_s, static_cast<std::size_t>(pool_e::COUNT)>
+    pool_stats;
+
+// Cell type whose payload each pool serves, indexed by pool_e. Cells
+// themselves are counted by cell_c::operator new
+constexpr std::array<cell_type_e, static_cast<std::size_t>(pool_e::COUNT)>
+    payload_types{cell_type_e::NIL,         cell_type_e::LIST,
+                  cell_type_e::DICT,        cell_type_e::FUNCTION,
+                  cell_type_e::ALIAS,       cell_type_e::ENVIRONMENT,
+                  cell_type_e::STRING};
+
+// Called before the block is taken, the heap may refuse it
+inline void count_allocation(const std::size_t size, const pool_e pool) {
+  if (pool != pool_e::CELL) {
+    heap::add_payload(payload_types[static_cast<std::size_t>(pool)], size);
+  }
+  pool_stats[static_cast<std::size_t>(pool)].allocations++;
+}
+
+inline void count_release(const std::size_t size, const pool_e pool) {
+  pool_stats[static_cast<std::size_t>(pool)].releases++;
+  if (pool != pool_e::CELL) {
+    heap::remove_payload(payload_types[static_cast<std::size_t>(pool)], size);
+  }
+}
+
+#ifndef NIBI_USE_SYSTEM_ALLOCATOR
+
+// Number of blocks moved between a thread cache and the depot at once
+static constexpr std::size_t TRANSFER_BATCH_SIZE = 256;
+
+// Number of blocks a thread may hold for a class before it gives
+// a batch back to the depot
+static constexpr std::size_t THREAD_CACHE_LIMIT = 4 * TRANSFER_BATCH_SIZE;
+
+struct free_block_s {
+  free_block_s *next{nullptr};
+};
+
+struct free_list_s {
+  free_block_s *head{nullptr};
+  std::size_t count{0};
+
+  inline void push(free_block_s *block) {
+    block->next = head;
+    head = block;
+    count++;
+  }
+
+  inline free_block_s *pop() {
+    auto *block = head;
+    head = block->next;
+    count--;
+    return block;
+  }
+};
+
+inline std::size_t size_class_of(const std::size_t size) {
+  std::size_t idx = 0;
+  std::size_t block_size = MIN_SLAB_ALLOCATION;
+  while (block_size < size) {
+    block_size <<= 1;
+    idx++;
+  }
+  return idx;
+}
+
+inline constexpr std::size_t block_size_of(const std::size_t size_class) {
+  return MIN_SLAB_ALLOCATION << size_class;
+}
+
+static_assert(block_size_of(NUM_SIZE_CLASSES - 1) == MAX_SLAB_ALLOCATION,
+              "Size classes must end at MAX_SLAB_ALLOCATION");
+
+//! \brief Shared storage for slabs and blocks that are not
+//!        owned by any thread cache
+class depot_c {
+public:
+  //! \brief Move up to TRANSFER_BATCH_SIZE blocks into the given list,
+  //!        carving a new slab if the depot has none
+  void refill(const std::size_t size_class, free_list_s &target) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &source = lists_[size_class];
+    if (source.count == 0) {
+      carve_slab(size_class, target);
+      return;
+    }
+    for (std::size_t i = 0; i < TRANSFER_BATCH_SIZE && source.count; i++) {
+      target.push(source.pop());
+    }
+  }
+
+  //! \brief Take `n` blocks (or all of them) from the given list
+  void take(const std::size_t size_class, free_list_s &source,
+            std::size_t n) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &target = lists_[size_class];
+    while (n-- && source.count) {
+      target.push(source.pop());
+    }
+  }
+
+  //! \brief Return a single block directly to the depot
+  void give(const std::size_t size_class, void *ptr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lists_[size_class].push(static_cast<free_block_s *>(ptr));
+  }
+
+private:
+  void carve_slab(const std::size_t size_class, free_list_s &target) {
+    auto *slab = static_cast<uint8_t *>(
+        ::operator new(SLAB_SIZE, std::align_val_t(CACHE_LINE_SIZE)));
+    slabs_.push_back(slab);
+
+    // Push in reverse so the thread hands out blocks in address order
+    const auto block_size = block_size_of(size_class);
+    for (std::size_t offset = SLAB_SIZE; offset >= block_size;
+         offset -= block_size) {
+      target.push(reinterpret_cast<free_block_s *>(slab + offset - block_size));
+    }
+  }
+
+  std::mutex mutex_;
+  std::array<free_list_s, NUM_SIZE_CLASSES> lists_;
+  std::vector<uint8_t *> slabs_;
+};
+
+// The depot is intentionally never destroyed. Cells can be released
+// during static destruction (globals holding cells) and those must
+// still have somewhere to go.
+depot_c &get_depot() {
+  static depot_c *depot = new depot_c();
+  return *depot;
+}
+
+//! \brief Per-thread free lists
+//! \note This is kept trivially destructible so it remains usable for the
+//!       entire life of the thread, including thread_local destruction
+struct thread_cache_s {
+  std::array<free_list_s, NUM_SIZE_CLASSES> lists;
+  bool retired{false};
+};
+
+thread_local thread_cache_s thread_cache;
+
+//! \brief Gives a thread's cached blocks back to the depot when
+//!        the thread exits
+struct thread_cache_guard_s {
+  bool armed{false};
+  ~thread_cache_guard_s() {
+    if (!armed) {
+      return;
+    }
+    auto &depot = get_depot();
+    for (std::size_t i = 0; i < NUM_SIZE_CLASSES; i++) {
+      depot.take(i, thread_cache.lists[i], thread_cache.lists[i].count);
+    }
+    thread_cache.retired = true;
+  }
+};
+
+thread_local thread_cache_guard_s thread_cache_guard;
+
+#endif
+
+} // namespace
+
+#ifndef NIBI_USE_SYSTEM_ALLOCATOR
+
+void *allocate(const std::size_t size, const pool_e pool) {
+  count_allocation(size, pool);
+
+  if (size > MAX_SLAB_ALLOCATION) {
+    return ::operator new(size);
+  }
+
+  auto size_class = size_class_of(size);
+  auto &list = thread_cache.lists[size_class];
+
+  if (!list.head) {
+    if (!thread_cache.retired) {
+      thread_cache_guard.armed = true;
+    }
+    get_depot().refill(size_class, list);
+  }
+
+  return list.pop();
+}
+
+void deallocate(void *ptr, const std::size_t size, const pool_e pool) {
+  if (!ptr) {
+    return;
+  }
+
+  count_release(size, pool);
+
+  if (size > MAX_SLAB_ALLOCATION) {
+    ::operator delete(ptr);
+    return;
+  }
+
+  auto size_class = size_class_of(size);
+
+  // The thread's cache is gone, hand it straight to the depot
+  if (thread_cache.retired) {
+    get_depot().give(size_class, ptr);
+    return;
+  }
+
+  auto &list = thread_cache.lists[size_class];
+  if (!list.head) {
+    thread_cache_guard.armed = true;
+  }
+  list.push(static_cast<free_block_s *>(ptr));
+
+  if (list.count > THREAD_CACHE_LIMIT) {
+    get_depot().take(size_class, list, TRANSFER_BATCH_SIZE);
+  }
+}
+
+bool is_slab_enabled() { return true; }
+
+#else
+
+void *allocate(const std::size_t size, const pool_e pool) {
+  count_allocation(size, pool);
+  return ::operator new(size);
+}
+
+void deallocate(void *ptr, const std::size_t size, const pool_e pool) {
+  if (!ptr) {
+    return;
+  }
+  count_release(size, pool);
+  ::operator delete(ptr);
+}
+
+bool is_slab_enabled() { return false; }
+
+#endif
+
+pool_stats_s get_pool_stats(const pool_e pool) {
+  return pool_stats[static_cast<std::size_t>(pool)];
+}
+
+const char *pool_name(const pool_e pool) {
+  switch (pool) {
+  case pool_e::CELL:
+    return "cell";
+  case pool_e::LIST_INFO:
+    return "list";
+  case pool_e::DICT_INFO:
+    return "dict";
+  case pool_e::FUNCTION_INFO:
+    return "function";
+  case pool_e::ALIAS:
+    return "alias";
+  case pool_e::ENVIRONMENT_INFO:
+    return "environment";
+  case pool_e::STRING_INFO:
+    return "string";
+  default:
+    return "unknown";
+  }
+}
+
+} // namespace allocator
+} // namespace nibi
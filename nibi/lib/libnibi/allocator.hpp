@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace nibi {
+namespace allocator {
+
+//! \brief Size of a cache line. Slabs are aligned to this
+//!        and blocks never straddle a line unless they
+//!        are larger than one
+static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+//! \brief Size of each slab requested from the system
+static constexpr std::size_t SLAB_SIZE = 64 * 1024;
+
+//! \brief Smallest block that the slab allocator hands out.
+//!        Size classes are powers of two starting here
+static constexpr std::size_t MIN_SLAB_ALLOCATION = 16;
+
+//! \brief Largest request served from a slab. Anything larger
+//!        is forwarded to the system allocator
+static constexpr std::size_t MAX_SLAB_ALLOCATION = 256;
+
+//! \brief Number of size classes the slab allocator manages
+//!        (16, 32, 64, 128, 256)
+static constexpr std::size_t NUM_SIZE_CLASSES = 5;
+
+//! \brief The kinds of object served by the allocator. Each is
+//!        counted separately, see get_pool_stats
+enum class pool_e : uint8_t {
+  CELL,
+  LIST_INFO,
+  DICT_INFO,
+  FUNCTION_INFO,
+  ALIAS,
+  ENVIRONMENT_INFO,
+  STRING_INFO,
+  COUNT
+};
+
+//! \brief Allocation counts of a pool for the calling thread
+struct pool_stats_s {
+  std::size_t allocations{0};
+  std::size_t releases{0};
+};
+
+//! \brief Allocate a block of memory of at least `size` bytes
+//! \param size The number of bytes required
+//! \param pool The pool the allocation is counted against
+//! \note Blocks are taken from a thread-local free list for the
+//!       size class, refilled from a shared depot or a fresh slab.
+//!       When libnibi is built with WITH_SYSTEM_ALLOCATOR this
+//!       forwards directly to the system allocator
+extern void *allocate(const std::size_t size,
+                      const pool_e pool = pool_e::CELL);
+
+//! \brief Return a block to the allocator
+//! \param ptr The block returned by `allocate`
+//! \param size The size that was given to `allocate`
+//! \param pool The pool that was given to `allocate`
+//! \note The block is placed on the free list of the thread that
+//!       releases it, not necessarily the one that allocated it
+extern void deallocate(void *ptr, const std::size_t size,
+                       const pool_e pool = pool_e::CELL);
+
+//! \brief Get the allocation counts of a pool
+//! \note  Counts are kept per thread. A block released by a thread
+//!        other than the one that allocated it is counted by each
+extern pool_stats_s get_pool_stats(const pool_e pool);
+
+//! \brief Get the name of a pool
+extern const char *pool_name(const pool_e pool);
+
+//! \brief Base for types that are allocated from a given pool
+//! \note  Cell payloads use this so that creating a list, dict or
+//!        function never reaches the system allocator
+template <pool_e Pool> struct pooled_s {
+  static void *operator new(std::size_t size) {
+    return allocate(size, Pool);
+  }
+  static void operator delete(void *ptr, std::size_t size) {
+    deallocate(ptr, size, Pool);
+  }
+};
+
+//! \brief Check if cells are being served by the slab allocator
+//! \returns false if libnibi was built with WITH_SYSTEM_ALLOCATOR
+extern bool is_slab_enabled();
+
+} // namespace allocator
+} // namespace nibi
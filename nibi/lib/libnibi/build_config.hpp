@@ -0,0 +1,11 @@
+#ifndef NIBI_BUILD_CONFIG_
+#define NIBI_BUILD_CONFIG_
+
+// Options the library was built with that change the layout or
+// behavior of inline code in its headers. Modules include this
+// through cell.hpp so they always agree with the library
+
+// Reference counts are atomic, see cell_c::acquire
+#define NIBI_ATOMIC_REFCOUNT 0
+
+#endif // NIBI_BUILD_CONFIG_
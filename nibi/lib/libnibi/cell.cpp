@@ -1,11 +1,101 @@
 #include "libnibi/cell.hpp"
 
+#include "libnibi/allocator.hpp"
+#include "libnibi/collector.hpp"
 #include "libnibi/environment.hpp"
+#include "libnibi/heap.hpp"
 
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace nibi {
 namespace {
+
+//! \brief Source locations of the cells that have one
+//! \note  Locations are recorded for parsed code, its clones, and the
+//!        dicts, functions and aliases made from it while running, and
+//!        are only read when reporting an error. Cells may be released
+//!        on any thread, so the table is split into shards by address,
+//!        each with its own lock, for threads running interpreters side
+//!        by side to rarely wait on each other
+class locator_table_c {
+public:
+  void set(const cell_c *cell, const packed_locator_s locator) {
+    auto &shard = shard_of(cell);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.locators[cell] = locator;
+  }
+
+  packed_locator_s get(const cell_c *cell) {
+    auto &shard = shard_of(cell);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.locators.find(cell);
+    if (it == shard.locators.end()) {
+      return {};
+    }
+    return it->second;
+  }
+
+  void erase(const cell_c *cell) {
+    auto &shard = shard_of(cell);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.locators.erase(cell);
+  }
+
+private:
+  static constexpr std::size_t SHARD_BITS = 6;
+
+  struct alignas(64) shard_s {
+    std::mutex mutex;
+    std::unordered_map<const cell_c *, packed_locator_s> locators;
+  };
+
+  // Cells are served from slabs, so neighbouring addresses are mixed
+  // before picking a shard
+  shard_s &shard_of(const cell_c *cell) {
+    auto key = reinterpret_cast<std::uintptr_t>(cell) / sizeof(cell_c);
+    auto mixed = static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ull;
+    return shards_[mixed >> (64 - SHARD_BITS)];
+  }
+
+  shard_s shards_[1 << SHARD_BITS];
+};
+
+// Never destroyed, cells may be released during static destruction
+locator_table_c &get_locator_table() {
+  static locator_table_c *table = new locator_table_c();
+  return *table;
+}
+
+//! \brief The immortal cells handed out when nil or a small integer
+//!        is accessed through a cell pointer
+struct shared_cells_s {
+  cell_c *nil;
+  cell_c *integers[CELL_SHARED_INTEGER_MAX - CELL_SHARED_INTEGER_MIN + 1];
+
+  shared_cells_s() {
+    nil = new cell_c(cell_type_e::NIL);
+    nil->make_immortal();
+    for (int64_t i = CELL_SHARED_INTEGER_MIN; i <= CELL_SHARED_INTEGER_MAX;
+         i++) {
+      auto *cell = new cell_c(i);
+      cell->make_immortal();
+      integers[i - CELL_SHARED_INTEGER_MIN] = cell;
+    }
+  }
+};
+
+// Never destroyed, as above
+shared_cells_s &get_shared_cells() {
+  static shared_cells_s *cells = new shared_cells_s();
+  return *cells;
+}
+
 const char *function_type_to_string(function_type_e type) {
   switch (type) {
   case function_type_e::UNSET:
@@ -67,7 +157,300 @@ const char *cell_type_to_string(const cell_type_e type) {
   return "UNKNOWN";
 }
 
+void tagged_cell_ptr_c::materialize(const bool shared) const {
+  cell_c *cell{nullptr};
+  switch (type()) {
+  case cell_type_e::I64: {
+    auto value = integer_bits();
+    if (shared && value >= CELL_SHARED_INTEGER_MIN &&
+        value <= CELL_SHARED_INTEGER_MAX) {
+      cell = get_shared_cells().integers[value - CELL_SHARED_INTEGER_MIN];
+    } else {
+      cell = new cell_c(value);
+    }
+    break;
+  }
+  case cell_type_e::F64:
+    cell = new cell_c(double_bits());
+    break;
+  case cell_type_e::CHAR:
+    cell = new cell_c(static_cast<char>(bits_ & 0xFF));
+    break;
+  default:
+    cell = shared ? get_shared_cells().nil : new cell_c(cell_type_e::NIL);
+    break;
+  }
+  cell->acquire();
+  bits_ = reinterpret_cast<uint64_t>(cell);
+}
+
+void tagged_cell_ptr_c::unshare() const {
+  auto *shared = reinterpret_cast<cell_c *>(bits_);
+  auto *cell = new cell_c(shared->type);
+  cell->data = shared->data;
+  cell->acquire();
+  bits_ = reinterpret_cast<uint64_t>(cell);
+}
+
+std::string tagged_cell_ptr_c::to_string(bool quote_strings,
+                                         bool flatten_complex) const {
+  switch (tag()) {
+  case POINTER_TAG:
+    return reinterpret_cast<cell_c *>(bits_)->to_string(quote_strings,
+                                                         flatten_complex);
+  case INTEGER_TAG:
+    return std::to_string(integer_bits());
+  case MISC_TAG:
+    break;
+  default:
+    return std::to_string(double_bits());
+  }
+
+  if (type() == cell_type_e::NIL) {
+    return "nil";
+  }
+
+  auto ch = static_cast<char>(bits_ & 0xFF);
+  if (quote_strings) {
+    return "'" + std::string(1, ch) + "'";
+  }
+  return std::string(1, ch);
+}
+
+tagged_cell_ptr_c tagged_cell_ptr_c::clone(env_c &env) const {
+  if (is_immediate()) {
+    return *this;
+  }
+  return reinterpret_cast<cell_c *>(bits_)->clone(env);
+}
+
+void *cell_c::operator new(std::size_t size) {
+  heap::take_cell(size);
+  return allocator::allocate(size, allocator::pool_e::CELL);
+}
+
+void cell_c::operator delete(void *ptr, std::size_t size) {
+  heap::give_cell(size);
+  allocator::deallocate(ptr, size, allocator::pool_e::CELL);
+}
+
+locator_ptr cell_c::locator() const {
+  return source_manager_c::resolve(packed_locator());
+}
+
+packed_locator_s cell_c::packed_locator() const {
+  if (!(flags_ & FLAG_HAS_LOCATOR)) {
+    return {};
+  }
+  return get_locator_table().get(this);
+}
+
+void cell_c::set_locator(const locator_ptr &locator) {
+  set_locator(source_manager_c::pack(locator));
+}
+
+void cell_c::set_locator(const packed_locator_s locator) {
+  if (!locator) {
+    if (flags_ & FLAG_HAS_LOCATOR) {
+      get_locator_table().erase(this);
+      flags_ &= ~FLAG_HAS_LOCATOR;
+    }
+    return;
+  }
+  get_locator_table().set(this, locator);
+  flags_ |= FLAG_HAS_LOCATOR;
+}
+
+namespace {
+
+// Buffers are allocated with their characters and a terminator
+// following the header
+string_buffer_s *allocate_string_buffer(const std::size_t capacity) {
+  auto bytes = sizeof(string_buffer_s) + capacity + 1;
+  heap::add_payload(cell_type_e::STRING, bytes);
+  auto *buffer = new (::operator new(bytes)) string_buffer_s;
+  buffer->capacity = capacity;
+  return buffer;
+}
+
+void release_string_buffer(string_buffer_s *buffer) {
+  if (--buffer->owners) {
+    return;
+  }
+  heap::remove_payload(cell_type_e::STRING,
+                       sizeof(string_buffer_s) + buffer->capacity + 1);
+  buffer->~string_buffer_s();
+  ::operator delete(buffer);
+}
+
+} // namespace
+
+void cell_c::assign_string(const std::string_view value) {
+  if (value.size() <= CELL_SMALL_STRING_CAPACITY) {
+    flags_ &= ~FLAG_HEAP_STRING;
+    if (!value.empty()) {
+      std::memcpy(this->data.small_str.chars, value.data(), value.size());
+    }
+    if (value.size() < CELL_SMALL_STRING_CAPACITY) {
+      this->data.small_str.chars[value.size()] = '\0';
+    }
+    this->data.small_str.remaining = CELL_SMALL_STRING_CAPACITY - value.size();
+    return;
+  }
+
+  auto info = std::make_unique<string_info_s>(nullptr, value.size());
+  info->buffer = allocate_string_buffer(value.size());
+  info->buffer->used = value.size();
+  std::memcpy(info->buffer->chars(), value.data(), value.size());
+  info->buffer->chars()[value.size()] = '\0';
+  this->data.str = info.release();
+  flags_ |= FLAG_HEAP_STRING;
+}
+
+void cell_c::share_string(const cell_c &other) {
+  if (!other.has_heap_string()) {
+    this->data.small_str = other.data.small_str;
+    flags_ &= ~FLAG_HEAP_STRING;
+    return;
+  }
+  this->data.str = new string_info_s(other.data.str->buffer,
+                                     other.data.str->size);
+  this->data.str->buffer->owners++;
+  flags_ |= FLAG_HEAP_STRING;
+}
+
+char *cell_c::own_string(const std::size_t capacity) {
+  auto current = as_string_view();
+
+  if (has_heap_string()) {
+    auto *buffer = this->data.str->buffer;
+    if (buffer->owners == 1 && capacity <= buffer->capacity) {
+      // Anything past this string was written by one since released
+      buffer->used = current.size();
+      buffer->chars()[current.size()] = '\0';
+      return buffer->chars();
+    }
+  }
+
+  std::unique_ptr<string_info_s> info;
+  if (!has_heap_string()) {
+    info = std::make_unique<string_info_s>(nullptr, current.size());
+  }
+
+  auto *buffer = allocate_string_buffer(capacity);
+  buffer->used = current.size();
+  std::memcpy(buffer->chars(), current.data(), current.size());
+  buffer->chars()[current.size()] = '\0';
+
+  if (info) {
+    this->data.str = info.release();
+    flags_ |= FLAG_HEAP_STRING;
+  } else {
+    release_string_buffer(this->data.str->buffer);
+  }
+  this->data.str->buffer = buffer;
+  return buffer->chars();
+}
+
+void cell_c::append_string(const std::string_view value) {
+  ensure_mutable();
+  auto size = as_string_view().size();
+  auto required = size + value.size();
+
+  if (!has_heap_string() && required <= CELL_SMALL_STRING_CAPACITY) {
+    std::memcpy(this->data.small_str.chars + size, value.data(),
+                value.size());
+    if (required < CELL_SMALL_STRING_CAPACITY) {
+      this->data.small_str.chars[required] = '\0';
+    }
+    this->data.small_str.remaining = CELL_SMALL_STRING_CAPACITY - required;
+    return;
+  }
+
+  char *chars = nullptr;
+  if (has_heap_string()) {
+    auto *buffer = this->data.str->buffer;
+    if (buffer->owners == 1) {
+      buffer->used = size;
+    }
+    // Other strings sharing the buffer only read below `used`
+    if (buffer->used == size && required <= buffer->capacity) {
+      chars = buffer->chars();
+    }
+  }
+
+  if (!chars) {
+    // Grown geometrically so a run of appends is linear overall.
+    // `value` may be in the old buffer, which is held until copied
+    auto *previous = has_heap_string() ? this->data.str->buffer : nullptr;
+    if (previous) {
+      previous->owners++;
+    }
+    try {
+      chars = own_string(std::max(required, size * 2));
+    } catch (...) {
+      if (previous) {
+        release_string_buffer(previous);
+      }
+      throw;
+    }
+    std::memcpy(chars + size, value.data(), value.size());
+    if (previous) {
+      release_string_buffer(previous);
+    }
+  } else {
+    std::memcpy(chars + size, value.data(), value.size());
+  }
+
+  chars[required] = '\0';
+  this->data.str->buffer->used = required;
+  this->data.str->size = required;
+}
+
+void cell_c::replace_string_at(const std::size_t index,
+                               const std::string_view value) {
+  ensure_mutable();
+  auto size = as_string_view().size();
+  if (index >= size) {
+    throw cell_access_exception_c("Index out of bounds", this->locator());
+  }
+
+  auto required = size - 1 + value.size();
+  if (!has_heap_string() && required <= CELL_SMALL_STRING_CAPACITY) {
+    std::string result{as_string_view()};
+    result.replace(index, 1, value);
+    assign_string(result);
+    return;
+  }
+
+  auto *chars = own_string(std::max(required, size));
+  std::memmove(chars + index + value.size(), chars + index + 1,
+               size - index - 1);
+  std::memcpy(chars + index, value.data(), value.size());
+  chars[required] = '\0';
+  this->data.str->buffer->used = required;
+  this->data.str->size = required;
+}
+
+void cell_c::release_string() {
+  if (has_heap_string()) {
+    release_string_buffer(this->data.str->buffer);
+    delete this->data.str;
+    flags_ &= ~FLAG_HEAP_STRING;
+  }
+  this->data.small_str.chars[0] = '\0';
+  this->data.small_str.remaining = CELL_SMALL_STRING_CAPACITY;
+}
+
 cell_c::~cell_c() {
+  if (flags_ & FLAG_HAS_LOCATOR) {
+    get_locator_table().erase(this);
+  }
+
+  if (root_slot_) {
+    collector::remove_possible_root(this);
+  }
+
   // Different types of cells may need to be manually cleaned up
   switch (this->type) {
   case cell_type_e::ABERRANT: {
@@ -81,23 +464,12 @@ cell_c::~cell_c() {
   // we need to clean the operating environment
   // as well because fauxs own their own
   case cell_type_e::FUNCTION: {
-    auto &func_info = this->as_function_info();
-    if (func_info.type == function_type_e::FAUX) {
-      if (func_info.operating_env) {
-        delete func_info.operating_env;
-        func_info.operating_env = nullptr;
-      }
-    }
-    delete this->data.fn;
+    release_function();
     this->data.fn = nullptr;
     break;
   }
-  case cell_type_e::SYMBOL:
   case cell_type_e::STRING: {
-    if (this->data.cstr) {
-      delete[] this->data.cstr;
-      this->data.cstr = nullptr;
-    }
+    release_string();
     break;
   }
   case cell_type_e::ENVIRONMENT: {
@@ -115,14 +487,14 @@ cell_c::~cell_c() {
   }
   case cell_type_e::DICT: {
     if (this->data.dict) {
-      delete this->data.dict;
+      release_payload(this->data.dict);
       this->data.dict = nullptr;
     }
     break;
   }
   case cell_type_e::LIST: {
     if (this->data.list) {
-      delete this->data.list;
+      release_payload(this->data.list);
       this->data.list = nullptr;
     }
     break;
@@ -131,15 +503,216 @@ cell_c::~cell_c() {
     break;
   }
   }
+
+  heap::remove_cell(this->type);
+}
+
+void cell_c::release_function() {
+  auto *func_info = this->data.fn;
+  if (func_info->type == function_type_e::FAUX && func_info->operating_env) {
+    defer_children(*func_info->operating_env);
+    delete func_info->operating_env;
+  }
+  delete func_info;
+}
+
+namespace {
+// Only a container that is about to lose its last reference
+// would go on to free its own children
+inline void defer_if_cascading(cell_ptr &cell) {
+  if (!cell || cell.is_immediate()) {
+    return;
+  }
+  auto *target = cell.get();
+  if (target->ref_count() == 1 && target->may_be_cyclic()) {
+    collector::defer_release(cell);
+  }
+}
+} // namespace
+
+void cell_c::defer_children(list_info_s &payload) {
+  for (auto &cell : payload.list) {
+    defer_if_cascading(cell);
+  }
+}
+
+void cell_c::defer_children(dict_info_s &payload) {
+  for (auto &pair : payload.data) {
+    defer_if_cascading(pair.second);
+  }
+}
+
+void cell_c::defer_children(env_c &env) {
+  for (auto &entry : env.get_map()) {
+    defer_if_cascading(entry.second);
+  }
+}
+
+void cell_c::add_possible_root() { collector::add_possible_root(this); }
+
+void cell_c::copy_function_info(cell_c &other) {
+  auto &other_info = *other.data.fn;
+  this->data.fn = new function_info_s(other_info);
+  if (other_info.type == function_type_e::FAUX && other_info.operating_env) {
+    this->data.fn->operating_env = new env_c(*other_info.operating_env);
+
+    // A copy of a frozen dict is an ordinary one
+    if (other.is_frozen()) {
+      env_c unused_env;
+      for (auto &entry : this->data.fn->operating_env->get_map()) {
+        entry.second = entry.second.clone(unused_env);
+      }
+    }
+  }
+}
+
+const tagged_cell_ptr_c &tagged_cell_ptr_c::freeze() const {
+  box();
+  get()->freeze();
+  return *this;
+}
+
+void cell_c::freeze() {
+  if (is_frozen()) {
+    return;
+  }
+
+  // Everything is checked before anything is frozen, so a graph
+  // that can not be frozen is left as it was
+  std::vector<cell_c *> pending{this};
+  std::unordered_set<cell_c *> reached{this};
+
+  auto visit = [&](const cell_ptr &child) {
+    if (!child) {
+      return;
+    }
+    if (child.is_immediate() ||
+        (child->is_immortal() && !child->is_frozen())) {
+      child.box();
+    }
+    auto *target = child.get();
+    if (!target->is_frozen() && reached.insert(target).second) {
+      pending.push_back(target);
+    }
+  };
+
+  for (std::size_t idx = 0; idx < pending.size(); idx++) {
+    auto *cell = pending[idx];
+    switch (cell->type) {
+    case cell_type_e::LIST:
+      // The payload must belong to this cell alone, it is about
+      // to stop being counted
+      if (cell->data.list->owners > 1) {
+        cell->unshare_list();
+      }
+      for (auto &child : cell->data.list->list) {
+        visit(child);
+      }
+      break;
+    case cell_type_e::DICT:
+      if (cell->data.dict->owners > 1) {
+        cell->unshare_dict();
+      }
+      for (auto &entry : cell->data.dict->data) {
+        visit(entry.second);
+      }
+      break;
+    case cell_type_e::ALIAS:
+      visit(cell->data.alias->cell);
+      break;
+    case cell_type_e::FUNCTION: {
+      auto *info = cell->data.fn;
+      if (info->type == function_type_e::LAMBDA_FUNCTION ||
+          info->lambda.has_value()) {
+        throw cell_access_exception_c(
+            "Functions and macros can not be frozen, they refer to the "
+            "environment they were defined in",
+            cell->locator());
+      }
+      if (info->type == function_type_e::FAUX && info->operating_env) {
+        for (auto &entry : info->operating_env->get_map()) {
+          visit(entry.second);
+        }
+      }
+      break;
+    }
+    case cell_type_e::ENVIRONMENT:
+      throw cell_access_exception_c("Environments can not be frozen",
+                                    cell->locator());
+    case cell_type_e::ABERRANT:
+      throw cell_access_exception_c("Aberrant cells can not be frozen",
+                                    cell->locator());
+    default:
+      break;
+    }
+  }
+
+  for (auto *cell : pending) {
+    if (cell->root_slot_) {
+      collector::remove_possible_root(cell);
+    }
+    cell->flags_ = (cell->flags_ & ~COLOR_MASK) | COLOR_BLACK | FLAG_FROZEN |
+                   FLAG_IMMORTAL;
+  }
 }
 
+//! \brief A list or dict whose elements are being copied by clone
+struct cell_c::clone_frame_s {
+  cell_c *source;
+  cell_c *copy;
+  std::size_t index{0};
+  cell_dict_t::const_iterator entry{};
+};
+
 cell_ptr cell_c::clone(env_c &env) {
+  if (this->type != cell_type_e::LIST && this->type != cell_type_e::DICT) {
+    return clone_value(env);
+  }
 
-  // Allocate a new cell
-  cell_ptr new_cell = allocate_cell(this->type);
+  // Nested lists and dicts are copied with an explicit stack rather
+  // than by recursion, so a deep structure can not exhaust the C++
+  // stack. Each copy is added to its parent before it is filled in
+  std::vector<clone_frame_s> frames;
+  auto clone_child = [&](const cell_ptr &child) -> cell_ptr {
+    if (!child || child.is_immediate()) {
+      return child;
+    }
+    return child.get()->begin_clone(env, frames);
+  };
+
+  auto root = begin_clone(env, frames);
+  while (!frames.empty()) {
+    auto &frame = frames.back();
+    if (frame.source->type == cell_type_e::LIST) {
+      auto &source = frame.source->data.list->list;
+      auto &copy = frame.copy->data.list->list;
+      if (frame.index == source.size()) {
+        frame.copy->data.list->resolved = true;
+        frames.pop_back();
+        continue;
+      }
+      // The frame may move as clone_child pushes, the payloads do not
+      auto &child = source[frame.index++];
+      copy.push_back(clone_child(child));
+      continue;
+    }
+
+    auto &source = frame.source->data.dict->data;
+    auto &copy = frame.copy->data.dict->data;
+    if (frame.entry == source.end()) {
+      frame.copy->data.dict->resolved = true;
+      frames.pop_back();
+      continue;
+    }
+    auto &entry = *frame.entry++;
+    copy[entry.first] = clone_child(entry.second);
+  }
+  return root;
+}
 
-  // Copy the data
-  new_cell->locator = this->locator;
+cell_ptr cell_c::clone_value(env_c &env) {
+  // Allocate a new cell
+  cell_ptr new_cell = allocate_boxed_cell(this->type);
 
   switch (this->type) {
   case cell_type_e::NIL:
@@ -187,15 +760,15 @@ cell_ptr cell_c::clone(env_c &env) {
     break;
   }
   case cell_type_e::SYMBOL: {
-    auto referenced_symbol = env.get(this->as_symbol());
+    auto referenced_symbol = env.get(this->as_symbol_id());
     if (referenced_symbol == nullptr) {
-      throw cell_access_exception_c("Unknown variable", this->locator);
+      throw cell_access_exception_c("Unknown variable", this->locator());
     }
     new_cell = referenced_symbol->clone(env);
     break;
   }
   case cell_type_e::STRING:
-    new_cell->update_string(this->to_string());
+    new_cell->share_string(*this);
     break;
   case cell_type_e::FUNCTION: {
 
@@ -222,25 +795,9 @@ cell_ptr cell_c::clone(env_c &env) {
     }
     break;
   }
-  case cell_type_e::LIST: {
-    auto &linf = this->as_list_info();
-    auto &other = new_cell->as_list_info();
-    other.type = linf.type;
-    for (auto &cell : linf.list) {
-      other.list.push_back(cell->clone(env));
-    }
-    break;
-  }
   case cell_type_e::ENVIRONMENT: {
-    throw cell_access_exception_c("Cannot clone an environment", this->locator);
-    break;
-  }
-  case cell_type_e::DICT: {
-    auto &dinf = this->as_dict();
-    auto &other = new_cell->as_dict();
-    for (auto &pair : dinf) {
-      other[pair.first] = pair.second->clone(env);
-    }
+    throw cell_access_exception_c("Cannot clone an environment",
+                                  this->locator());
     break;
   }
   case cell_type_e::ABERRANT: {
@@ -251,133 +808,372 @@ cell_ptr cell_c::clone(env_c &env) {
   return new_cell;
 }
 
+namespace {
+
+//! \brief A lent payload whose elements are being checked
+struct reference_frame_s {
+  list_info_s *list;
+  dict_info_s *dict;
+  std::size_t index{0};
+  cell_dict_t::iterator entry{};
+};
+
+// A cell referenced from outside of its payload (a variable bound by
+// iter, a lambda argument) could be updated in place later on, which
+// must not be seen through a copy that shares the payload.
+//
+// A payload that has never been accessed for writing has not handed
+// out any of its elements, so only lent payloads need to be walked.
+// Those found clean are no longer lent. The walk uses an explicit
+// stack so that deep nesting can not exhaust the C++ stack
+bool has_outstanding_references(list_info_s *list, dict_info_s *dict) {
+  std::vector<reference_frame_s> frames;
+  auto enter = [&](list_info_s *list_payload, dict_info_s *dict_payload) {
+    if (list_payload ? list_payload->lent : dict_payload->lent) {
+      frames.push_back({list_payload, dict_payload});
+      if (dict_payload) {
+        frames.back().entry = dict_payload->data.begin();
+      }
+    }
+  };
+
+  enter(list, dict);
+  while (!frames.empty()) {
+    auto &frame = frames.back();
+    const cell_ptr *child{nullptr};
+    if (frame.list && frame.index < frame.list->list.size()) {
+      child = &frame.list->list[frame.index++];
+    } else if (frame.dict && frame.entry != frame.dict->data.end()) {
+      child = &(frame.entry++)->second;
+    }
+
+    if (!child) {
+      if (frame.list) {
+        frame.list->lent = false;
+      } else {
+        frame.dict->lent = false;
+      }
+      frames.pop_back();
+      continue;
+    }
+
+    if (!*child || child->is_immediate()) {
+      continue;
+    }
+    auto *target = child->get();
+    if (target->ref_count() > 1) {
+      return true;
+    }
+    if (target->type == cell_type_e::LIST) {
+      enter(target->data.list, nullptr);
+    } else if (target->type == cell_type_e::DICT) {
+      enter(nullptr, target->data.dict);
+    }
+  }
+  return false;
+}
+} // namespace
+
+cell_ptr cell_c::begin_clone(env_c &env,
+                             std::vector<clone_frame_s> &frames) {
+  if (this->type == cell_type_e::LIST) {
+    auto *payload = this->data.list;
+
+    cell_ptr new_cell{nullptr};
+    // A frozen payload is never shared, its owner count must not change
+    if (!is_frozen() && payload->resolved &&
+        !has_outstanding_references(payload, nullptr)) {
+      new_cell = allocate_boxed_cell(cell_type_e::NIL);
+      new_cell->retype(cell_type_e::LIST);
+      new_cell->data.list = payload;
+      payload->owners++;
+    } else {
+      list_info_s copy(payload->type);
+      copy.list.reserve(payload->list.size());
+      new_cell = allocate_boxed_cell(std::move(copy));
+      frames.push_back({this, new_cell.get()});
+    }
+
+    // Code keeps its location so errors in cloned instructions
+    // (macros, spawn) can still be reported
+    if (flags_ & FLAG_HAS_LOCATOR) {
+      new_cell->set_locator(packed_locator());
+    }
+    return new_cell;
+  }
+
+  if (this->type == cell_type_e::DICT) {
+    auto *payload = this->data.dict;
+
+    // See above
+    if (!is_frozen() && payload->resolved &&
+        !has_outstanding_references(nullptr, payload)) {
+      cell_ptr new_cell = allocate_boxed_cell(cell_type_e::NIL);
+      new_cell->retype(cell_type_e::DICT);
+      new_cell->data.dict = payload;
+      payload->owners++;
+      return new_cell;
+    }
+
+    cell_ptr new_cell = allocate_boxed_cell(cell_type_e::DICT);
+    frames.push_back({this, new_cell.get(), 0, payload->data.cbegin()});
+    return new_cell;
+  }
+
+  return clone_value(env);
+}
+
+void cell_c::unshare_list() {
+  auto *shared = this->data.list;
+  auto *copy = new list_info_s(shared->type);
+  copy->list.reserve(shared->list.size());
+
+  // Shared payloads are resolved, so nothing is looked up in the env
+  env_c unused_env;
+  for (auto &cell : shared->list) {
+    copy->list.push_back(cell.clone(unused_env));
+  }
+  copy->resolved = true;
+
+  release_payload(shared);
+  this->data.list = copy;
+}
+
+void cell_c::unshare_dict() {
+  auto *shared = this->data.dict;
+  auto *copy = new dict_info_s();
+
+  env_c unused_env;
+  for (auto &pair : shared->data) {
+    copy->data[pair.first] = pair.second.clone(unused_env);
+  }
+  copy->resolved = true;
+
+  release_payload(shared);
+  this->data.dict = copy;
+}
+
+namespace {
+//! \brief A list or dict being written by to_string
+struct string_frame_s {
+  const cell_list_t *list;
+  const cell_dict_t *dict;
+  char close;
+  bool flatten_complex;
+  std::size_t index{0};
+  cell_dict_t::const_iterator entry{};
+};
+} // namespace
+
 std::string cell_c::to_string(bool quote_strings, bool flatten_complex) {
+  std::string out;
+
+  // Nested lists and dicts are written with an explicit stack into
+  // the one buffer, so the cost is linear in the size of the output
+  // and deep structures can not exhaust the C++ stack
+  std::vector<string_frame_s> frames;
+  auto write = [&](cell_c *cell, bool flatten) {
+    // Aliases are written as what they refer to
+    while (cell->type == cell_type_e::ALIAS) {
+      auto &target = cell->data.alias->cell;
+      if (!target) {
+        out += "nil";
+        return;
+      }
+      if (target.is_immediate()) {
+        out += target.to_string(quote_strings, flatten);
+        return;
+      }
+      cell = target.get();
+    }
+
+    if (cell->type == cell_type_e::LIST) {
+      auto &info = cell->read_list_info();
+      // Most elements are short, reserve ahead for a few bytes each
+      out.reserve(out.size() + 2 + info.list.size() * 4);
+      switch (info.type) {
+      case list_types_e::INSTRUCTION:
+        out += '(';
+        frames.push_back({&info.list, nullptr, ')', flatten});
+        break;
+      case list_types_e::DATA:
+        out += '[';
+        frames.push_back({&info.list, nullptr, ']', flatten});
+        break;
+      case list_types_e::ACCESS:
+        out += '{';
+        frames.push_back({&info.list, nullptr, '}', flatten});
+        break;
+      }
+      return;
+    }
+
+    if (cell->type == cell_type_e::DICT) {
+      auto &dict = cell->read_dict();
+      out.reserve(out.size() + 2 + dict.size() * 8);
+      out += '{';
+      // Dict values are written in full
+      frames.push_back({nullptr, &dict, '}', false});
+      frames.back().entry = dict.cbegin();
+      return;
+    }
+
+    cell->write_value(out, quote_strings, flatten);
+  };
+
+  auto write_child = [&](const cell_ptr &child, bool flatten) {
+    if (!child) {
+      out += "nil";
+      return;
+    }
+    if (child.is_immediate()) {
+      out += child.to_string(quote_strings, flatten);
+      return;
+    }
+    write(child.get(), flatten);
+  };
+
+  write(this, flatten_complex);
+  while (!frames.empty()) {
+    // Not used once a child is written, that may push a frame and
+    // move this one
+    auto &frame = frames.back();
+    auto flatten = frame.flatten_complex;
+
+    if (frame.list) {
+      if (frame.index == frame.list->size()) {
+        out += frame.close;
+        frames.pop_back();
+        continue;
+      }
+      if (frame.index) {
+        out += ' ';
+      }
+      auto &child = (*frame.list)[frame.index++];
+      write_child(child, flatten);
+      continue;
+    }
+
+    if (frame.entry == frame.dict->cend()) {
+      out += frame.close;
+      frames.pop_back();
+      continue;
+    }
+    if (frame.entry != frame.dict->cbegin()) {
+      out += ' ';
+    }
+    auto &entry = *frame.entry++;
+    out += entry.first;
+    out += ':';
+    write_child(entry.second, flatten);
+  }
+  return out;
+}
+
+void cell_c::write_value(std::string &out, bool quote_strings,
+                         bool flatten_complex) {
   switch (this->type) {
   case cell_type_e::NIL:
-    return "nil";
+    out += "nil";
+    return;
   case cell_type_e::I8:
-    return std::to_string(this->data.i8);
+    out += std::to_string(this->data.i8);
+    return;
   case cell_type_e::I16:
-    return std::to_string(this->data.i16);
+    out += std::to_string(this->data.i16);
+    return;
   case cell_type_e::I32:
-    return std::to_string(this->data.i32);
+    out += std::to_string(this->data.i32);
+    return;
   case cell_type_e::I64:
-    return std::to_string(this->data.i64);
+    out += std::to_string(this->data.i64);
+    return;
   case cell_type_e::U8:
-    return std::to_string(this->data.u8);
+    out += std::to_string(this->data.u8);
+    return;
   case cell_type_e::U16:
-    return std::to_string(this->data.u16);
+    out += std::to_string(this->data.u16);
+    return;
   case cell_type_e::U32:
-    return std::to_string(this->data.u32);
+    out += std::to_string(this->data.u32);
+    return;
   case cell_type_e::U64:
-    return std::to_string(this->data.u64);
+    out += std::to_string(this->data.u64);
+    return;
   case cell_type_e::F32:
-    return std::to_string(this->data.f32);
+    out += std::to_string(this->data.f32);
+    return;
   case cell_type_e::F64:
-    return std::to_string(this->data.f64);
+    out += std::to_string(this->data.f64);
+    return;
   case cell_type_e::CHAR:
     if (quote_strings) {
-      return "'" + std::string(1, this->data.ch) + "'";
+      out += '\'';
+      out += this->data.ch;
+      out += '\'';
+      return;
     }
-    return std::string(1, this->data.ch);
+    out += this->data.ch;
+    return;
   case cell_type_e::PTR:
-    return std::to_string((uint64_t)this->data.ptr);
+    out += std::to_string((uint64_t)this->data.ptr);
+    return;
   case cell_type_e::SYMBOL:
-    return this->as_string();
+    out += this->as_string_view();
+    return;
   case cell_type_e::STRING:
     if (quote_strings) {
-      return "\"" + this->as_string() + "\"";
+      auto view = this->as_string_view();
+      out.reserve(out.size() + view.size() + 2);
+      out += '"';
+      out += view;
+      out += '"';
+      return;
     }
-    return this->as_string();
+    out += this->as_string_view();
+    return;
   case cell_type_e::ABERRANT: {
     aberrant_cell_if *cell = this->as_aberrant();
-    if (!cell)
-      return "nil";
-    else {
-      // We prefix the string so external mods
-      // cant inject code into the interpreter
-      // by returning a string that can be evaluated
-      // using eval
-      return "Aberrant cell: " + cell->represent_as_string();
+    if (!cell) {
+      out += "nil";
+      return;
     }
+    // We prefix the string so external mods
+    // cant inject code into the interpreter
+    // by returning a string that can be evaluated
+    // using eval
+    out += "Aberrant cell: ";
+    out += cell->represent_as_string();
+    return;
   }
   case cell_type_e::FUNCTION: {
     auto &fn = this->as_function_info();
     if (flatten_complex) {
-      return fn.name;
+      out += fn.name;
+      return;
     }
-    std::string result = "<function:";
-    result += fn.name;
-    result += ", type:";
-    result += function_type_to_string(fn.type);
-    result += ">";
-    return result;
+    out += "<function:";
+    out += fn.name;
+    out += ", type:";
+    out += function_type_to_string(fn.type);
+    out += ">";
+    return;
   }
   case cell_type_e::ENVIRONMENT: {
     auto &env = this->as_environment_info();
     if (flatten_complex) {
-      return env.name;
+      out += env.name;
+      return;
     }
-    std::string result = "<environment:";
-    result += env.name;
-    result += ">";
-    return result;
-  }
-  case cell_type_e::DICT: {
-    auto &dict = this->as_dict();
-    std::string result = "{";
-    for (auto &pair : dict) {
-      result += pair.first + ":" + pair.second->to_string(quote_strings) + " ";
-    }
-    if (result.size() > 1)
-      result.pop_back();
-    result += "}";
-    return result;
-  }
-  case cell_type_e::ALIAS: {
-    auto alias = this->get_alias();
-    return alias->to_string(quote_strings, flatten_complex);
-  }
-  case cell_type_e::LIST: {
-    std::string result;
-    auto &list_info = this->as_list_info();
-
-    switch (list_info.type) {
-    case list_types_e::INSTRUCTION: {
-      result += "(";
-      for (auto cell : list_info.list) {
-        result += cell->to_string(quote_strings, flatten_complex) + " ";
-      }
-      if (result.size() > 1)
-        result.pop_back();
-      result += ")";
-      break;
-    }
-    case list_types_e::DATA: {
-      result += "[";
-      for (auto cell : list_info.list) {
-        result += cell->to_string(quote_strings, flatten_complex) + " ";
-      }
-      if (result.size() > 1)
-        result.pop_back();
-      result += "]";
-      break;
-    }
-    case list_types_e::ACCESS: {
-      result += "{";
-      for (auto cell : list_info.list) {
-        result += cell->to_string(quote_strings, flatten_complex) + " ";
-      }
-      if (result.size() > 1)
-        result.pop_back();
-      result += "}";
-      break;
-    }
-    }
-    return result;
+    out += "<environment:";
+    out += env.name;
+    out += ">";
+    return;
   }
+  default:
+    break;
   }
-  throw cell_access_exception_c("Unknown cell type", this->locator);
+  throw cell_access_exception_c("Unknown cell type", this->locator());
 }
 
 } // namespace nibi
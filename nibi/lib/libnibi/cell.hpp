@@ -1,9 +1,15 @@
 #pragma once
 
 #include "libnibi/RLL/rll_wrapper.hpp"
+#include "libnibi/allocator.hpp"
+#include "libnibi/build_config.hpp"
+#include "libnibi/heap.hpp"
+#include "libnibi/small_vector.hpp"
 #include "libnibi/source.hpp"
+#include "libnibi/symbols.hpp"
 #include "ref.hpp"
 #include <any>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <cstring>
@@ -12,21 +18,28 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
-
-#define CELL_LIST_USE_STD_VECTOR 1
-
-#if CELL_LIST_USE_STD_VECTOR
 #include <vector>
-#else
-#include <deque>
-#endif
 
 namespace nibi {
 
-#if CELL_LIST_USE_STD_VECTOR
-static constexpr std::size_t CELL_VEC_RESERVE_SIZE = 1;
-#endif
+//! \brief Number of cells a list holds before it needs
+//!        a separate allocation for its elements
+static constexpr std::size_t CELL_LIST_INLINE_CAPACITY = 4;
+
+//! \brief Longest STRING that is stored inside the cell
+//!        itself rather than in a separate allocation
+static constexpr std::size_t CELL_SMALL_STRING_CAPACITY = 7;
+
+//! \brief Upper bound on the size of a cell, checked at compile time
+static constexpr std::size_t CELL_MAX_SIZE = 16;
+
+//! \brief Range of integers that are given a shared, immortal cell
+//!        when an immediate is accessed through a cell pointer.
+//!        This covers true (1) and false (0)
+static constexpr int64_t CELL_SHARED_INTEGER_MIN = -128;
+static constexpr int64_t CELL_SHARED_INTEGER_MAX = 1023;
 
 static constexpr uint8_t CELL_TYPE_MIN_NUMERIC = 0x01;
 static constexpr uint8_t CELL_TYPE_MIN_INTEGER = CELL_TYPE_MIN_NUMERIC;
@@ -107,36 +120,227 @@ class env_c;
 class interpreter_c;
 class cell_processor_if;
 class cell_c;
+class cycle_collector_c;
+
+//! \brief A reference counted handle to a cell that can also hold
+//!        I64, F64, CHAR, and NIL values inline (NaN-boxed) so that
+//!        scalar temporaries never touch the allocator or a refcount
+//! \note  The 64 bit word is laid out by its top 16 bits:
+//!          0x0000          pointer to a heap cell (or null)
+//!          0x0001          misc immediate, cell type in bits 40..47
+//!                          and the payload (CHAR) in the low byte
+//!          0xFFFF          48 bit signed integer
+//!          anything else   double, stored as its bits + DOUBLE_OFFSET
+//!        Values that do not fit (wide integers, some NaN payloads) are
+//!        stored in a heap cell as before.
+//! \note  Cells are mutable boxes in nibi (`set` updates in place), so
+//!        going through `->`, `*`, or `get()` moves an immediate into a
+//!        heap cell first and the handle keeps pointing at it. Nil and
+//!        small integers are moved into shared immortal cells instead,
+//!        so anything that needs identity (environments, list slots,
+//!        the target of `set`) must get it through `box()` on its own
+//!        handle rather than a copy.
+class tagged_cell_ptr_c {
+public:
+  tagged_cell_ptr_c() {}
+  tagged_cell_ptr_c(std::nullptr_t) {}
+  tagged_cell_ptr_c(cell_c *object);
+  tagged_cell_ptr_c(const tagged_cell_ptr_c &rhs);
+  tagged_cell_ptr_c(tagged_cell_ptr_c &&rhs) : bits_(rhs.bits_) {
+    rhs.bits_ = 0;
+  }
+  ~tagged_cell_ptr_c() { release(); }
+
+  const tagged_cell_ptr_c &operator=(const tagged_cell_ptr_c &rhs);
+  const tagged_cell_ptr_c &operator=(tagged_cell_ptr_c &&rhs);
+
+  //! \brief Create an integer, inline when it fits in 48 bits
+  static tagged_cell_ptr_c from_integer(const int64_t value);
+
+  //! \brief Create a double, inline unless it is an unusual NaN
+  static tagged_cell_ptr_c from_double(const double value);
+
+  //! \brief Create an inline char
+  static tagged_cell_ptr_c from_char(const char value);
+
+  //! \brief Create an inline nil
+  static tagged_cell_ptr_c nil();
+
+  //! \brief Access the heap cell, boxing an immediate first
+  cell_c &operator*() const { return *get(); }
+  cell_c *operator->() const { return get(); }
+  cell_c *get() const {
+    if (is_immediate()) {
+      materialize(true);
+    }
+    return reinterpret_cast<cell_c *>(bits_);
+  }
+  cell_c *ptr() const { return get(); }
+
+  bool operator==(const tagged_cell_ptr_c &rhs) const {
+    return bits_ == rhs.bits_;
+  }
+  bool operator!=(const tagged_cell_ptr_c &rhs) const {
+    return bits_ != rhs.bits_;
+  }
+  operator bool() const { return bits_ != 0; }
+
+  //! \brief Check if the value is held inline rather than in a heap cell
+  bool is_immediate() const { return (bits_ >> TAG_SHIFT) != POINTER_TAG; }
+
+  //! \brief Ensure the value lives in a heap cell of its own that
+  //!        can be updated in place
+  //! \note  This updates the handle it is called on (not a copy)
+  //!        so use it on the slot that must keep identity. A shared
+  //!        immortal cell is copied
+  const tagged_cell_ptr_c &box() const;
+
+  //! \brief Make the value and everything reachable from it immutable
+  //!        and immortal, see cell_c::freeze
+  //! \note  The value is boxed first, so this updates the handle it
+  //!        is called on
+  const tagged_cell_ptr_c &freeze() const;
+
+  // The following mirror the cell_c accessors of the same name
+  // but read immediates without boxing them
+
+  cell_type_e type() const;
+  bool is_integer() const;
+  bool is_float() const;
+  bool is_numeric() const;
+  int64_t to_integer() const;
+  int64_t as_integer() const;
+  double to_double() const;
+  double as_double() const;
+  char as_char() const;
+  std::string to_string(bool quote_strings = false,
+                        bool flatten_complex = false) const;
+
+  //! \brief Deep copy the value
+  //! \note  Immediates are values, so they are their own clone
+  tagged_cell_ptr_c clone(env_c &env) const;
+
+private:
+  static constexpr uint64_t TAG_SHIFT = 48;
+  static constexpr uint64_t POINTER_TAG = 0x0000;
+  static constexpr uint64_t MISC_TAG = 0x0001;
+  static constexpr uint64_t INTEGER_TAG = 0xFFFF;
+  static constexpr uint64_t MISC_TYPE_SHIFT = 40;
+  static constexpr uint64_t PAYLOAD_MASK = (uint64_t(1) << TAG_SHIFT) - 1;
+  static constexpr uint64_t DOUBLE_OFFSET = uint64_t(1) << 49;
+  static constexpr uint64_t MAX_DOUBLE_BITS = 0xFFFC000000000000;
+  static constexpr int64_t MIN_INLINE_INTEGER = -(int64_t(1) << 47);
+  static constexpr int64_t MAX_INLINE_INTEGER = (int64_t(1) << 47) - 1;
+
+  uint64_t tag() const { return bits_ >> TAG_SHIFT; }
+  bool is_pointer() const { return bits_ && tag() == POINTER_TAG; }
+  int64_t integer_bits() const {
+    return static_cast<int64_t>(bits_ << 16) >> 16;
+  }
+  double double_bits() const {
+    double value;
+    uint64_t raw = bits_ - DOUBLE_OFFSET;
+    std::memcpy(&value, &raw, sizeof(value));
+    return value;
+  }
+  static tagged_cell_ptr_c from_bits(const uint64_t bits) {
+    tagged_cell_ptr_c result;
+    result.bits_ = bits;
+    return result;
+  }
+
+  void release();
+
+  //! \brief Move the immediate into a heap cell
+  //! \param shared Use an immortal cell for nil and small integers
+  void materialize(const bool shared) const;
+
+  //! \brief Replace a shared immortal cell with a copy
+  void unshare() const;
+
+  mutable uint64_t bits_{0};
+};
 
 //! \brief A cell pointer type
-using cell_ptr = ref_counted_ptr_c<cell_c>;
+using cell_ptr = tagged_cell_ptr_c;
 
-//! \brief A list of cells
+//! \brief A borrowed cell, one that is read through a handle owned
+//!        elsewhere so that no reference is taken or released
+//! \note  Anything that keeps the cell must copy it into a cell_ptr
+using cell_ref_t = const cell_ptr &;
 
-#if CELL_LIST_USE_STD_VECTOR
-using cell_list_t = std::vector<cell_ptr>;
-#else
-using cell_list_t = std::deque<cell_ptr>;
-#endif
+//! \brief A list of cells
+using cell_list_t =
+    small_vector_c<cell_ptr, CELL_LIST_INLINE_CAPACITY,
+                   heap::counted_storage_s<cell_type_e::LIST>>;
 
 //! \brief A function that takes a list of cells and an environment
 using cell_fn_t =
     std::function<cell_ptr(cell_processor_if &ci, cell_list_t &, env_c &)>;
 
 //! \brief A dictionary type
-using cell_dict_t = std::unordered_map<std::string, cell_ptr>;
+using cell_dict_t = std::unordered_map<
+    std::string, cell_ptr, std::hash<std::string>, std::equal_to<std::string>,
+    heap::counted_allocator_s<std::pair<const std::string, cell_ptr>,
+                              cell_type_e::DICT>>;
+
+//! \brief Bookkeeping for LIST and DICT payloads, which are shared
+//!        between cells by clone and copied when one of them writes
+//! \note  Copying a payload struct starts a new, unshared payload
+struct shared_payload_s {
+  //! \brief Number of cells using the payload
+  uint32_t owners{1};
+
+  //! \brief Set when the payload was produced by clone, so it holds
+  //!        values and no symbols or aliases that would be resolved
+  //!        against an environment when cloned
+  bool resolved{false};
+
+  //! \brief Set when the payload has been accessed for writing, since
+  //!        elements may have been handed out by reference
+  bool lent{false};
+
+  shared_payload_s() = default;
+  shared_payload_s(const shared_payload_s &) {}
+  shared_payload_s &operator=(const shared_payload_s &) { return *this; }
+};
 
-struct dict_info_s {
+struct dict_info_s : shared_payload_s,
+                     allocator::pooled_s<allocator::pool_e::DICT_INFO> {
   cell_dict_t data;
   dict_info_s() = default;
   dict_info_s(const dict_info_s &other) : data(other.data){};
   dict_info_s(cell_dict_t other) : data(std::move(other)){};
 };
 
+namespace vm {
+struct chunk_s;
+}
+
+namespace closure {
+struct program_s;
+}
+
+//! \brief The variables an environment keeps in slots rather than by
+//!        name, a slot for each in order (see env_c)
+using slot_layout_t = std::vector<symbol_id_t>;
+
 //! \brief Lambda information that can be encoded into a cell
 struct lambda_info_s {
-  std::vector<std::string> arg_names;
+  std::vector<symbol_id_t> arg_ids;
   cell_ptr body{nullptr};
+
+  //! \brief The slots of the environment each call runs in, laid out
+  //!        when the lambda is defined, see interpreter/resolver
+  slot_layout_t frame_layout;
+
+  //! \brief The body compiled by the first call that ran it as
+  //!        bytecode, see interpreter/vm
+  std::shared_ptr<vm::chunk_s> bytecode{nullptr};
+
+  //! \brief The body built into closures by the first call that ran
+  //!        it so, see interpreter/closure
+  std::shared_ptr<closure::program_s> closure{nullptr};
 };
 
 //! \brief Function wrapper that holds the function
@@ -147,7 +351,8 @@ struct lambda_info_s {
 //!        but do not own it, while MACROS own the environment
 //!        to hold onto construction this->data. While two pointers
 //!        or a further wrapper could be used, this is lighter
-struct function_info_s {
+struct function_info_s
+    : allocator::pooled_s<allocator::pool_e::FUNCTION_INFO> {
   std::string name;
   cell_fn_t fn;
   function_type_e type;
@@ -159,20 +364,60 @@ struct function_info_s {
       : name(name), fn(fn), type(type), operating_env(env) {}
 };
 
+//! \brief A monomorphic inline cache of where a call site found the
+//!        function it calls, see env_c::find(id, cache)
+struct binding_cache_s {
+  symbol_id_t id{0};           // The variable cached
+  const env_c *owner{nullptr}; // The environment it was found in
+  uint64_t version{0};         // The version of that environment then
+  cell_ptr *handle{nullptr};   // Where it is stored there
+};
+
+//! \brief Whether an `if` or `loop` needs an environment of its own,
+//!        see resolver::needs_scope
+struct scope_cache_s {
+  uint32_t generation{0}; // Of the macro names known then, 0 if unknown
+  bool needed{true};
+};
+
 //! \brief List wrapper that holds list meta data
-struct list_info_s {
+struct list_info_s : shared_payload_s,
+                     allocator::pooled_s<allocator::pool_e::LIST_INFO> {
   list_types_e type;
   cell_list_t list;
+  binding_cache_s cache; // Of the function an instruction calls
+  mutable scope_cache_s scope;
   list_info_s(list_types_e type, cell_list_t list)
       : type(type), list(std::move(list)) {}
 
-  list_info_s(list_types_e type) : type(type) {
-#if CELL_LIST_USE_STD_VECTOR
-    list.reserve(CELL_VEC_RESERVE_SIZE);
-#endif
+  list_info_s(list_types_e type) : type(type) {}
+};
+
+//! \brief Characters of heap STRINGs, followed by a terminator
+//! \note  A string made by appending to another shares its buffer,
+//!        writing past the end of it in place when no other string
+//!        has, see cell_c::append_string. Bytes below `used` are not
+//!        changed while the buffer is shared, so each string reads
+//!        its own prefix of them
+struct string_buffer_s {
+  uint32_t owners{1};      // Strings reading the buffer
+  std::size_t used{0};     // Bytes written, the longest string's size
+  std::size_t capacity{0}; // Bytes the buffer can hold
+
+  char *chars() { return reinterpret_cast<char *>(this + 1); }
+  const char *chars() const {
+    return reinterpret_cast<const char *>(this + 1);
   }
 };
 
+//! \brief A heap STRING, the first `size` bytes of a buffer
+struct string_info_s : allocator::pooled_s<allocator::pool_e::STRING_INFO> {
+  string_buffer_s *buffer;
+  std::size_t size;
+  string_info_s(string_buffer_s *buffer, std::size_t size)
+      : buffer(buffer), size(size) {}
+};
+
 // Temporary wrapper to distnguish strings from symbols
 // in the cell constructor
 struct symbol_s {
@@ -180,14 +425,19 @@ struct symbol_s {
 };
 
 // Temporary wrapper to distinguish aliases
-struct alias_s {
+struct alias_s : allocator::pooled_s<allocator::pool_e::ALIAS> {
   cell_ptr cell;
+  alias_s(cell_ptr cell) : cell(std::move(cell)) {}
 };
 
 //! \brief Environment information that can be encoded into a cell
-struct environment_info_s {
+struct environment_info_s
+    : allocator::pooled_s<allocator::pool_e::ENVIRONMENT_INFO> {
   std::string name;
   std::shared_ptr<env_c> env{nullptr};
+  environment_info_s() = default;
+  environment_info_s(std::string name, std::shared_ptr<env_c> env)
+      : name(std::move(name)), env(std::move(env)) {}
 };
 
 //! \brief An exception that is thrown when a cell is accessed
@@ -252,17 +502,48 @@ private:
   std::size_t tag_{0};
 };
 
-#pragma pack(push, 1)
-
 //! \brief A cell
-class cell_c : public ref_counted_c {
+//! \note  Cells are intentionally small (see CELL_MAX_SIZE) and have no
+//!        vtable. The reference count and type share the first word and
+//!        the data occupies the second. Source locations are not stored
+//!        in the cell, see locator()
+class cell_c {
+private:
+#if NIBI_ATOMIC_REFCOUNT
+  mutable std::atomic<uint32_t> ref_count_{0};
+#else
+  mutable uint32_t ref_count_{0};
+#endif
+
 public:
   cell_type_e type{cell_type_e::NIL};
-  locator_ptr locator{nullptr};
 
+private:
+  static constexpr uint8_t FLAG_HAS_LOCATOR = 1 << 0;
+  static constexpr uint8_t FLAG_HEAP_STRING = 1 << 1;
+  static constexpr uint8_t FLAG_IMMORTAL = 1 << 2;
+  static constexpr uint8_t FLAG_FROZEN = 1 << 5;
+
+  // Trial deletion colors used by the cycle collector (see collector.hpp)
+  static constexpr uint8_t COLOR_SHIFT = 3;
+  static constexpr uint8_t COLOR_MASK = 3 << COLOR_SHIFT;
+  static constexpr uint8_t COLOR_BLACK = 0 << COLOR_SHIFT;  // In use
+  static constexpr uint8_t COLOR_GRAY = 1 << COLOR_SHIFT;   // Being traced
+  static constexpr uint8_t COLOR_WHITE = 2 << COLOR_SHIFT;  // Garbage
+  static constexpr uint8_t COLOR_PURPLE = 3 << COLOR_SHIFT; // Possible root
+
+  uint8_t flags_{0};
+
+  // Position + 1 of the cell in the collector's root buffer, 0 when
+  // it is not buffered. This fills what would otherwise be padding
+  uint16_t root_slot_{0};
+
+  friend class cycle_collector_c;
+
+public:
   union {
     void *ptr;
-    char *cstr;
+    string_info_s *str;
     char ch;
     int8_t i8;
     int16_t i16;
@@ -280,44 +561,154 @@ public:
     alias_s *alias;
     dict_info_s *dict;
     list_info_s *list;
+    symbol_id_t symbol;
+
+    // STRING contents that fit in the cell. `remaining`
+    // is the unused capacity, so it doubles as the terminator when
+    // the string is full. When FLAG_HEAP_STRING is set `str`
+    // points to a heap allocation instead
+    struct {
+      char chars[CELL_SMALL_STRING_CAPACITY];
+      uint8_t remaining;
+    } small_str;
   } data{0};
 
-  cell_c(int8_t data) : type(cell_type_e::I8) { this->data.i8 = data; }
-  cell_c(int16_t data) : type(cell_type_e::I16) { this->data.i16 = data; }
-  cell_c(int32_t data) : type(cell_type_e::I32) { this->data.i32 = data; }
-  cell_c(int64_t data) : type(cell_type_e::I64) { this->data.i64 = data; }
-  cell_c(uint8_t data) : type(cell_type_e::U8) { this->data.u8 = data; }
-  cell_c(uint16_t data) : type(cell_type_e::U16) { this->data.u16 = data; }
-  cell_c(uint32_t data) : type(cell_type_e::U32) { this->data.u32 = data; }
-  cell_c(uint64_t data) : type(cell_type_e::U64) { this->data.u64 = data; }
-  cell_c(float data) : type(cell_type_e::F32) { this->data.f32 = data; }
-  cell_c(double data) : type(cell_type_e::F64) { this->data.f64 = data; }
-  cell_c(char data) : type(cell_type_e::CHAR) { this->data.ch = data; }
-  cell_c(std::string data) : type(cell_type_e::STRING) { update_string(data); }
-  cell_c(symbol_s data) : type(cell_type_e::SYMBOL) {
-    update_string(data.data);
-  }
-  cell_c(alias_s alias) : type(cell_type_e::ALIAS) {
+  cell_c(int8_t data) : type(counted(cell_type_e::I8)) { this->data.i8 = data; }
+  cell_c(int16_t data) : type(counted(cell_type_e::I16)) {
+    this->data.i16 = data;
+  }
+  cell_c(int32_t data) : type(counted(cell_type_e::I32)) {
+    this->data.i32 = data;
+  }
+  cell_c(int64_t data) : type(counted(cell_type_e::I64)) {
+    this->data.i64 = data;
+  }
+  cell_c(uint8_t data) : type(counted(cell_type_e::U8)) {
+    this->data.u8 = data;
+  }
+  cell_c(uint16_t data) : type(counted(cell_type_e::U16)) {
+    this->data.u16 = data;
+  }
+  cell_c(uint32_t data) : type(counted(cell_type_e::U32)) {
+    this->data.u32 = data;
+  }
+  cell_c(uint64_t data) : type(counted(cell_type_e::U64)) {
+    this->data.u64 = data;
+  }
+  cell_c(float data) : type(counted(cell_type_e::F32)) {
+    this->data.f32 = data;
+  }
+  cell_c(double data) : type(counted(cell_type_e::F64)) {
+    this->data.f64 = data;
+  }
+  cell_c(char data) : type(counted(cell_type_e::CHAR)) { this->data.ch = data; }
+  cell_c(std::string data) : type(counted(cell_type_e::STRING)) {
+    assign_string(data);
+  }
+  cell_c(symbol_s data) : type(counted(cell_type_e::SYMBOL)) {
+    this->data.symbol = symbols::intern(data.data);
+  }
+  cell_c(alias_s alias) : type(counted(cell_type_e::ALIAS)) {
     this->data.alias = new alias_s(alias);
   }
 
-  cell_c(list_info_s list) : type(cell_type_e::LIST) {
+  cell_c(list_info_s list) : type(counted(cell_type_e::LIST)) {
     this->data.list = new list_info_s(list);
   }
-  cell_c(aberrant_cell_if *acif) : type(cell_type_e::ABERRANT) {
+  cell_c(aberrant_cell_if *acif) : type(counted(cell_type_e::ABERRANT)) {
     this->data.aberrant = acif;
   }
-  cell_c(function_info_s fn) : type(cell_type_e::FUNCTION) {
+  cell_c(function_info_s fn) : type(counted(cell_type_e::FUNCTION)) {
     this->data.fn = new function_info_s(fn);
   }
-  cell_c(environment_info_s env) : type(cell_type_e::ENVIRONMENT) {
+  cell_c(environment_info_s env) : type(counted(cell_type_e::ENVIRONMENT)) {
     this->data.env = new environment_info_s(env);
   }
-  cell_c(cell_dict_t dict) : type(cell_type_e::DICT) {
+  cell_c(cell_dict_t dict) : type(counted(cell_type_e::DICT)) {
     this->data.dict = new dict_info_s(dict);
   }
 
-  virtual ~cell_c();
+  ~cell_c();
+
+  //! \note  Immortal cells are never counted, they may be
+  //!        shared between threads
+  //! \note  With NIBI_ATOMIC_REFCOUNT the counts are atomic so
+  //!        handles may be copied and dropped from any thread. Nothing
+  //!        else is made thread safe, cells that are read from more
+  //!        than one thread should be frozen
+  void acquire() const {
+    if (!(flags_ & FLAG_IMMORTAL)) {
+#if NIBI_ATOMIC_REFCOUNT
+      ref_count_.fetch_add(1, std::memory_order_relaxed);
+#else
+      ref_count_++;
+#endif
+    }
+  }
+  uint32_t release() const {
+    if (flags_ & FLAG_IMMORTAL) {
+      return 1;
+    }
+#if NIBI_ATOMIC_REFCOUNT
+    return ref_count_.fetch_sub(1, std::memory_order_acq_rel) - 1;
+#else
+    return --ref_count_;
+#endif
+  }
+
+  //! \brief Check if the cell can hold references that lead back to
+  //!        itself. Only these are considered by the cycle collector
+  bool may_be_cyclic() const {
+    switch (type) {
+    case cell_type_e::LIST:
+    case cell_type_e::FUNCTION:
+    case cell_type_e::ENVIRONMENT:
+    case cell_type_e::DICT:
+    case cell_type_e::ALIAS:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  //! \brief Note that the reference count was lowered but the cell
+  //!        lives on, so it may now only be held by a cycle
+  void mark_possible_root() {
+    flags_ = (flags_ & ~COLOR_MASK) | COLOR_PURPLE;
+    if (!root_slot_) {
+      add_possible_root();
+    }
+  }
+
+  //! \brief Check if the cell is shared and never released
+  bool is_immortal() const { return flags_ & FLAG_IMMORTAL; }
+
+  //! \brief Make the cell immortal. It will never be released
+  //!        and must not be updated in place from then on
+  void make_immortal() { flags_ |= FLAG_IMMORTAL; }
+
+  //! \brief Check if the cell has been frozen
+  //! \note  Frozen cells are immortal
+  bool is_frozen() const { return flags_ & FLAG_FROZEN; }
+
+  //! \brief Freeze the cell and every cell reachable from it
+  //! \note  Frozen cells are never released or updated, anything that
+  //!        would modify one throws. As nothing about them changes they
+  //!        can be read from any thread. Reachable immediates and
+  //!        shared cells are given cells of their own first so reading
+  //!        a frozen value never writes to it
+  //! \throws cell_access_exception_c if anything reachable can not be
+  //!         frozen (environments, lambdas, macros and aberrant cells).
+  //!         Nothing is frozen in that case
+  void freeze();
+
+  //! \brief Get the number of handles referencing the cell
+  uint32_t ref_count() const { return ref_count_; }
+
+  //! \brief Cells are served by the slab allocator
+  //! \note See allocator.hpp
+  static void *operator new(std::size_t size);
+  static void operator delete(void *ptr, std::size_t size);
 
   cell_c() = delete;
   cell_c(const cell_c &other) = delete;
@@ -338,8 +729,28 @@ public:
   //! \brief Deep copy the cell
   cell_ptr clone(env_c &env);
 
+  //! \brief Get the source location the cell was parsed from
+  //! \returns The locator, or nullptr if the cell was not given one
+  //! \note  Locations are kept packed in a side table keyed on the
+  //!        cell and a locator is made for each call, so this is
+  //!        meant for reporting errors, not for hot paths
+  locator_ptr locator() const;
+
+  //! \brief Get the packed source location the cell was parsed from
+  //! \returns The location, or 0 if the cell was not given one
+  //! \note  Use to copy a location between cells without resolving it
+  packed_locator_s packed_locator() const;
+
+  //! \brief Record the source location of the cell
+  //! \param locator The location, nullptr removes any existing one
+  void set_locator(const locator_ptr &locator);
+
+  //! \brief Record the source location of the cell
+  //! \param locator The location, 0 removes any existing one
+  void set_locator(const packed_locator_s locator);
+
   //! \brief Create a cell with a given type
-  cell_c(cell_type_e type) : type(type) {
+  cell_c(cell_type_e type) : type(counted(type)) {
     // Initialize the data based on given type
     switch (type) {
     case cell_type_e::NIL:
@@ -370,8 +781,10 @@ public:
       this->data.ptr = nullptr;
       break;
     case cell_type_e::STRING:
+      assign_string({});
+      break;
     case cell_type_e::SYMBOL:
-      this->data.cstr = nullptr;
+      this->data.symbol = symbols::EMPTY_SYMBOL_ID;
       break;
     case cell_type_e::LIST:
       this->data.list = new list_info_s(list_types_e::DATA);
@@ -383,60 +796,88 @@ public:
       this->data.alias = nullptr;
       break;
     case cell_type_e::DICT:
-      this->data.dict = nullptr;
+      this->data.dict = new dict_info_s();
       break;
     }
   }
 
   void update_from(cell_c &other, env_c &env) {
 
-    // Perform any cleanup of this cell required before updating to new data
-
-    if (this->type == cell_type_e::ENVIRONMENT) {
-      throw cell_access_exception_c(
-          "Reallocating a Nibi Envrionment is an illegal operation",
-          this->locator);
+    if (&other == this) {
+      return;
     }
 
-    if (this->type == cell_type_e::STRING && this->data.cstr) {
-      delete[] this->data.cstr;
+    // Clone before anything is released, `other` may be built from
+    // this cell's own contents (set x [x])
+    cell_ptr copy{nullptr};
+    if (other.type != cell_type_e::STRING &&
+        other.type != cell_type_e::FUNCTION) {
+      copy = other.clone(env);
     }
 
-    if (this->type == cell_type_e::FUNCTION && this->data.fn) {
-      delete this->data.fn;
-    }
-
-    if (this->type == cell_type_e::LIST && this->data.list) {
-      delete this->data.list;
-    }
+    // Perform any cleanup of this cell required before updating to new data
+    release_for_update();
 
     // Set this cell's new type
 
-    this->type = other.type;
+    retype(other.type);
 
     // Handle specific copies
 
     if (other.type == cell_type_e::STRING) {
-      auto size = strlen(other.data.cstr);
-      this->data.cstr = new char[size + 1];
-      strncpy(this->data.cstr, other.data.cstr, size);
-      this->data.cstr[size] = '\0';
+      share_string(other);
       return;
     }
 
     if (other.type == cell_type_e::FUNCTION && other.data.fn) {
-      this->data.fn = new function_info_s(*other.data.fn);
+      copy_function_info(other);
       return;
     }
 
+    // Lists and dicts take the clone's payload, which is
+    // usually shared with `other` rather than copied
+
     if (other.type == cell_type_e::LIST && other.data.list) {
-      this->data.list = new list_info_s(*(other.clone(env)->data.list));
+      this->data.list = copy->data.list;
+      this->data.list->owners++;
+      return;
+    }
+
+    if (other.type == cell_type_e::DICT && other.data.dict) {
+      this->data.dict = copy->data.dict;
+      this->data.dict->owners++;
       return;
     }
 
     // Handle simple copies
 
-    this->data = other.clone(env)->data;
+    this->data = copy->data;
+  }
+
+  //! \brief Update the cell from a handle that may hold an immediate
+  void update_from(const cell_ptr &other, env_c &env) {
+    if (!other.is_immediate()) {
+      update_from(*other, env);
+      return;
+    }
+
+    release_for_update();
+
+    retype(other.type());
+    switch (this->type) {
+    case cell_type_e::I64:
+      this->data.i64 = other.as_integer();
+      break;
+    case cell_type_e::F64:
+      this->data.f64 = other.as_double();
+      break;
+    case cell_type_e::CHAR:
+      this->data.ch = other.as_char();
+      break;
+    default:
+      this->data.ptr = nullptr;
+      break;
+    }
   }
 
   int64_t to_integer() {
@@ -449,7 +890,7 @@ public:
   int64_t &as_integer() {
     if (!is_integer()) {
       throw cell_access_exception_c(
-          "Cell is not an integer: " + this->to_string(), this->locator);
+          "Cell is not an integer: " + this->to_string(), this->locator());
     }
     return data.i64;
   }
@@ -465,53 +906,92 @@ public:
     if (static_cast<uint8_t>(type) < CELL_TYPE_MIN_FLOAT ||
         static_cast<uint8_t>(type) > CELL_TYPE_MAX_FLOAT) {
       throw cell_access_exception_c(
-          "Cell is not a floating point: " + this->to_string(), this->locator);
+          "Cell is not a floating point: " + this->to_string(),
+          this->locator());
     }
     return data.f64;
   }
 
-  std::string as_string() {
-    if (this->type != cell_type_e::STRING &&
-        this->type != cell_type_e::SYMBOL) {
-      throw cell_access_exception_c("Cell is not a string", this->locator);
+  std::string as_string() { return std::string(as_string_view()); }
+
+  //! \brief Read a STRING or SYMBOL without copying it
+  //! \note  For strings the view is invalidated when the cell
+  //!        is updated or released. Symbol names live forever
+  std::string_view as_string_view() const {
+    if (this->type == cell_type_e::SYMBOL) {
+      return symbols::name_of(this->data.symbol);
+    }
+    if (this->type != cell_type_e::STRING) {
+      throw cell_access_exception_c("Cell is not a string", this->locator());
     }
-    if (!this->data.cstr)
-      return "";
-    return this->data.cstr;
+    if (has_heap_string()) {
+      return {this->data.str->buffer->chars(), this->data.str->size};
+    }
+    return {this->data.small_str.chars,
+            CELL_SMALL_STRING_CAPACITY - this->data.small_str.remaining};
   }
 
   char *as_c_string() {
     if (this->type != cell_type_e::STRING &&
         this->type != cell_type_e::SYMBOL) {
       throw cell_access_exception_c(
-          "Cell does not contain a string, or a symbol", this->locator);
+          "Cell does not contain a string, or a symbol", this->locator());
+    }
+    if (this->type == cell_type_e::SYMBOL) {
+      return const_cast<char *>(symbols::name_of(this->data.symbol).c_str());
     }
-    return this->data.cstr;
+    if (has_heap_string()) {
+      // Another string may have written past this one, or could
+      // see writes made through the pointer, so take a copy
+      return own_string(this->data.str->size);
+    }
+    return this->data.small_str.chars;
   }
 
-  std::string as_symbol() {
+  const std::string &as_symbol() const {
     if (this->type != cell_type_e::SYMBOL) {
-      throw cell_access_exception_c("Cell is not a symbol", this->locator);
+      throw cell_access_exception_c("Cell is not a symbol", this->locator());
     }
-    if (!this->data.cstr)
-      return "";
-    return this->data.cstr;
+    return symbols::name_of(this->data.symbol);
   }
 
-  cell_list_t to_list() { return this->as_list(); }
+  //! \brief Get the interned id of a symbol
+  symbol_id_t as_symbol_id() const {
+    if (this->type != cell_type_e::SYMBOL) {
+      throw cell_access_exception_c("Cell is not a symbol", this->locator());
+    }
+    return this->data.symbol;
+  }
+
+  cell_list_t to_list() const { return this->read_list(); }
+
+  //! \brief Access a list for writing
+  //! \note  A payload shared with other cells is copied first
+  cell_list_t &as_list() { return as_list_info().list; }
 
-  cell_list_t &as_list() {
+  list_info_s to_list_info() const { return this->read_list_info(); }
+
+  //! \brief Access a list for writing
+  //! \note  A payload shared with other cells is copied first
+  list_info_s &as_list_info() {
     if (type != cell_type_e::LIST) {
-      throw cell_access_exception_c("Cell is not a list", this->locator);
+      throw cell_access_exception_c("Cell is not a list", this->locator());
+    }
+    ensure_mutable();
+    if (data.list->owners > 1) {
+      unshare_list();
     }
-    return as_list_info().list;
+    data.list->lent = true;
+    return *data.list;
   }
 
-  list_info_s to_list_info() { return this->as_list_info(); }
+  //! \brief Read a list without copying a shared payload
+  const cell_list_t &read_list() const { return read_list_info().list; }
 
-  list_info_s &as_list_info() {
+  //! \brief Read a list without copying a shared payload
+  const list_info_s &read_list_info() const {
     if (type != cell_type_e::LIST) {
-      throw cell_access_exception_c("Cell is not a list", this->locator);
+      throw cell_access_exception_c("Cell is not a list", this->locator());
     }
     return *data.list;
   }
@@ -519,14 +999,14 @@ public:
   aberrant_cell_if *as_aberrant() const {
     if (type != cell_type_e::ABERRANT) {
       throw cell_access_exception_c("Cell is not an aberrant cell",
-                                    this->locator);
+                                    this->locator());
     }
     return data.aberrant;
   }
 
   function_info_s &as_function_info() {
     if (this->type != cell_type_e::FUNCTION) {
-      throw cell_access_exception_c("Cell is not a function", this->locator);
+      throw cell_access_exception_c("Cell is not a function", this->locator());
     }
     return *(this->data.fn);
   }
@@ -534,7 +1014,7 @@ public:
   environment_info_s &as_environment_info() {
     if (this->type != cell_type_e::ENVIRONMENT) {
       throw cell_access_exception_c("Cell is not an environment",
-                                    this->locator);
+                                    this->locator());
     }
     return *(this->data.env);
   }
@@ -542,43 +1022,73 @@ public:
   void *as_pointer() const {
     if (type != cell_type_e::PTR) {
       throw cell_access_exception_c("Cell does not contain a pointer",
-                                    this->locator);
+                                    this->locator());
     }
     return data.ptr;
   }
 
+  //! \brief Access a dict for writing
+  //! \note  A payload shared with other cells is copied first
   cell_dict_t &as_dict() {
     if (this->type != cell_type_e::DICT) {
-      throw cell_access_exception_c("Cell is not a dict", this->locator);
+      throw cell_access_exception_c("Cell is not a dict", this->locator());
+    }
+    ensure_mutable();
+    if (this->data.dict->owners > 1) {
+      unshare_dict();
+    }
+    this->data.dict->lent = true;
+    return this->data.dict->data;
+  }
+
+  //! \brief Read a dict without copying a shared payload
+  const cell_dict_t &read_dict() const {
+    if (this->type != cell_type_e::DICT) {
+      throw cell_access_exception_c("Cell is not a dict", this->locator());
     }
     return this->data.dict->data;
   }
 
-  void update_string(const std::string data) {
+  void update_string(const std::string_view data) {
     if (this->type != cell_type_e::STRING &&
         this->type != cell_type_e::SYMBOL) {
       throw cell_access_exception_c("Cell does not contain a string to update",
-                                    this->locator);
+                                    this->locator());
     }
-    if (this->data.cstr) {
-      delete[] this->data.cstr;
+    ensure_mutable();
+    if (this->type == cell_type_e::SYMBOL) {
+      this->data.symbol = symbols::intern(data);
+      return;
     }
-
-    this->data.cstr = new char[data.size() + 1];
-    strncpy(this->data.cstr, data.data(), data.size());
-    this->data.cstr[data.size()] = '\0';
+    release_string();
+    assign_string(data);
   }
 
+  //! \brief Add to the end of a STRING
+  //! \note  Amortized constant time in the size of the string. A
+  //!        string that shares its buffer is extended in place if
+  //!        it is the longest of those sharing it, so repeatedly
+  //!        appending to the result of an append copies nothing.
+  //!        `value` must not point into this cell
+  void append_string(const std::string_view value);
+
+  //! \brief Replace the character of a STRING at `index` with `value`
+  //! \note  A single character is written in place when the storage
+  //!        is not shared. `value` must not point into this string
+  //! \throws cell_access_exception_c if the index is out of bounds
+  void replace_string_at(const std::size_t index,
+                         const std::string_view value);
+
   char as_char() const {
     if (this->type != cell_type_e::CHAR) {
-      throw cell_access_exception_c("Cell is not a char", this->locator);
+      throw cell_access_exception_c("Cell is not a char", this->locator());
     }
     return this->data.ch;
   }
 
   cell_ptr get_alias() const {
     if (this->type != cell_type_e::ALIAS) {
-      throw cell_access_exception_c("Cell is not an alias", this->locator);
+      throw cell_access_exception_c("Cell is not an alias", this->locator());
     }
     return this->data.alias->cell;
   }
@@ -600,15 +1110,364 @@ public:
     return static_cast<uint8_t>(type) >= CELL_TYPE_MIN_NUMERIC &&
            static_cast<uint8_t>(type) <= CELL_TYPE_MAX_NUMERIC;
   }
+
+  //! \brief Free the heap storage of a STRING, if any
+  //! \note  The cell must be given new contents with assign_string
+  void release_string();
+
+private:
+  bool has_heap_string() const { return flags_ & FLAG_HEAP_STRING; }
+
+  // Count the cell against its type as it is constructed, see heap.hpp
+  static cell_type_e counted(const cell_type_e type) {
+    heap::add_cell(type);
+    return type;
+  }
+
+  // Change the type of a live cell, keeping the heap counts right
+  void retype(const cell_type_e to) {
+    if (to != type) {
+      heap::retype_cell(type, to);
+      type = to;
+    }
+  }
+
+  void ensure_mutable() const {
+    if (flags_ & FLAG_FROZEN) {
+      throw cell_access_exception_c("Frozen cells can not be modified",
+                                    this->locator());
+    }
+  }
+
+  //! \brief Make the heap buffer of a STRING its own, with room for
+  //!        at least `capacity` bytes. The contents are kept
+  //! \returns The characters, terminated after the contents
+  char *own_string(const std::size_t capacity);
+
+  //! \brief Read the contents of another STRING, sharing its buffer
+  //! \note  Any previous heap storage must already be released
+  void share_string(const cell_c &other);
+
+  //! \brief Store the given contents, inline if they fit
+  //! \note  Any previous heap storage must already be released
+  void assign_string(const std::string_view value);
+
+  // Free whatever this cell owns before it is overwritten by update_from
+  void release_for_update() {
+    ensure_mutable();
+
+    if (is_immortal()) {
+      throw cell_access_exception_c(
+          "Updating a shared cell in place is an illegal operation",
+          this->locator());
+    }
+
+    if (this->type == cell_type_e::ENVIRONMENT) {
+      throw cell_access_exception_c(
+          "Reallocating a Nibi Envrionment is an illegal operation",
+          this->locator());
+    }
+
+    if (this->type == cell_type_e::STRING) {
+      release_string();
+    }
+
+    if (this->type == cell_type_e::FUNCTION && this->data.fn) {
+      release_function();
+    }
+
+    if (this->type == cell_type_e::LIST && this->data.list) {
+      release_payload(this->data.list);
+    }
+
+    if (this->type == cell_type_e::DICT && this->data.dict) {
+      release_payload(this->data.dict);
+    }
+  }
+
+  //! \brief Drop this cell's use of a LIST or DICT payload
+  template <typename T> static void release_payload(T *payload) {
+    if (--payload->owners == 0) {
+      defer_children(*payload);
+      delete payload;
+    }
+  }
+
+  //! \brief Free the function info, and the environment of a faux
+  //!        function which it owns
+  void release_function();
+
+  //! \brief Hand the children of something being freed that would in
+  //!        turn free their own children to the collector's release
+  //!        queue, so large structures are not destroyed recursively
+  static void defer_children(list_info_s &payload);
+  static void defer_children(dict_info_s &payload);
+  static void defer_children(env_c &env);
+
+  //! \brief Give this cell its own copy of another cell's function
+  //! \note  Faux functions own their environment, so it is copied too
+  void copy_function_info(cell_c &other);
+
+  //! \brief Hand the cell to the cycle collector's root buffer
+  void add_possible_root();
+
+  //! \brief Replace a shared payload with a copy owned by this cell
+  void unshare_list();
+  void unshare_dict();
+
+  //! \brief Copy a cell that is not a list or dict
+  cell_ptr clone_value(env_c &env);
+
+  //! \brief Start copying a cell for clone
+  //! \returns The copy. A list or dict that can not share its payload
+  //!          is returned empty, with a frame pushed to fill it in
+  struct clone_frame_s;
+  cell_ptr begin_clone(env_c &env, std::vector<clone_frame_s> &frames);
+
+  //! \brief Write a cell that is not a list or dict for to_string
+  void write_value(std::string &out, bool quote_strings,
+                   bool flatten_complex);
 };
 
-#pragma pack(pop)
+static_assert(sizeof(cell_c) <= CELL_MAX_SIZE, "Cell exceeds CELL_MAX_SIZE");
+
+// ----------------------------------------------------------------
+//  tagged_cell_ptr_c members that need the full cell_c definition
+// ----------------------------------------------------------------
+
+inline tagged_cell_ptr_c::tagged_cell_ptr_c(cell_c *object)
+    : bits_(reinterpret_cast<uint64_t>(object)) {
+  if (object) {
+    object->acquire();
+  }
+}
+
+inline tagged_cell_ptr_c::tagged_cell_ptr_c(const tagged_cell_ptr_c &rhs)
+    : bits_(rhs.bits_) {
+  if (is_pointer()) {
+    reinterpret_cast<cell_c *>(bits_)->acquire();
+  }
+}
+
+inline const tagged_cell_ptr_c &
+tagged_cell_ptr_c::operator=(const tagged_cell_ptr_c &rhs) {
+  if (rhs.is_pointer()) {
+    reinterpret_cast<cell_c *>(rhs.bits_)->acquire();
+  }
+  release();
+  bits_ = rhs.bits_;
+  return *this;
+}
+
+inline const tagged_cell_ptr_c &
+tagged_cell_ptr_c::operator=(tagged_cell_ptr_c &&rhs) {
+  if (this != &rhs) {
+    release();
+    bits_ = rhs.bits_;
+    rhs.bits_ = 0;
+  }
+  return *this;
+}
+
+inline const tagged_cell_ptr_c &tagged_cell_ptr_c::box() const {
+  if (is_immediate()) {
+    materialize(false);
+  } else if (bits_) {
+    // Frozen cells are immortal too but are never updated, so they
+    // keep their identity
+    auto *cell = reinterpret_cast<cell_c *>(bits_);
+    if (cell->is_immortal() && !cell->is_frozen()) {
+      unshare();
+    }
+  }
+  return *this;
+}
+
+inline void tagged_cell_ptr_c::release() {
+  if (is_pointer()) {
+    auto *cell = reinterpret_cast<cell_c *>(bits_);
+    if (cell->is_immortal()) {
+      return;
+    }
+    if (cell->release() == 0) {
+      delete cell;
+    } else if (cell->may_be_cyclic()) {
+      cell->mark_possible_root();
+    }
+  }
+}
+
+inline tagged_cell_ptr_c tagged_cell_ptr_c::from_integer(const int64_t value) {
+  if (value < MIN_INLINE_INTEGER || value > MAX_INLINE_INTEGER) {
+    return new cell_c(value);
+  }
+  return from_bits((INTEGER_TAG << TAG_SHIFT) |
+                   (static_cast<uint64_t>(value) & PAYLOAD_MASK));
+}
+
+inline tagged_cell_ptr_c tagged_cell_ptr_c::from_double(const double value) {
+  uint64_t raw;
+  std::memcpy(&raw, &value, sizeof(raw));
+  if (raw >= MAX_DOUBLE_BITS) {
+    return new cell_c(value);
+  }
+  return from_bits(raw + DOUBLE_OFFSET);
+}
+
+inline tagged_cell_ptr_c tagged_cell_ptr_c::from_char(const char value) {
+  return from_bits(
+      (MISC_TAG << TAG_SHIFT) |
+      (static_cast<uint64_t>(cell_type_e::CHAR) << MISC_TYPE_SHIFT) |
+      static_cast<uint8_t>(value));
+}
+
+inline tagged_cell_ptr_c tagged_cell_ptr_c::nil() {
+  return from_bits(
+      (MISC_TAG << TAG_SHIFT) |
+      (static_cast<uint64_t>(cell_type_e::NIL) << MISC_TYPE_SHIFT));
+}
+
+inline cell_type_e tagged_cell_ptr_c::type() const {
+  switch (tag()) {
+  case POINTER_TAG:
+    return reinterpret_cast<cell_c *>(bits_)->type;
+  case MISC_TAG:
+    return static_cast<cell_type_e>((bits_ >> MISC_TYPE_SHIFT) & 0xFF);
+  case INTEGER_TAG:
+    return cell_type_e::I64;
+  default:
+    return cell_type_e::F64;
+  }
+}
+
+inline bool tagged_cell_ptr_c::is_integer() const {
+  switch (tag()) {
+  case POINTER_TAG:
+    return reinterpret_cast<cell_c *>(bits_)->is_integer();
+  case MISC_TAG:
+    return false;
+  case INTEGER_TAG:
+    return true;
+  default:
+    return false;
+  }
+}
+
+inline bool tagged_cell_ptr_c::is_float() const {
+  switch (tag()) {
+  case POINTER_TAG:
+    return reinterpret_cast<cell_c *>(bits_)->is_float();
+  case MISC_TAG:
+  case INTEGER_TAG:
+    return false;
+  default:
+    return true;
+  }
+}
+
+inline bool tagged_cell_ptr_c::is_numeric() const {
+  switch (tag()) {
+  case POINTER_TAG:
+    return reinterpret_cast<cell_c *>(bits_)->is_numeric();
+  case MISC_TAG:
+    return false;
+  default:
+    return true;
+  }
+}
+
+inline int64_t tagged_cell_ptr_c::as_integer() const {
+  switch (tag()) {
+  case POINTER_TAG:
+    return reinterpret_cast<cell_c *>(bits_)->as_integer();
+  case INTEGER_TAG:
+    return integer_bits();
+  default:
+    throw cell_access_exception_c("Cell is not an integer: " + to_string(),
+                                  nullptr);
+  }
+}
+
+inline int64_t tagged_cell_ptr_c::to_integer() const {
+  switch (tag()) {
+  case POINTER_TAG:
+    return reinterpret_cast<cell_c *>(bits_)->to_integer();
+  case MISC_TAG:
+    return as_integer();
+  case INTEGER_TAG:
+    return integer_bits();
+  default:
+    return (int64_t)double_bits();
+  }
+}
+
+inline double tagged_cell_ptr_c::as_double() const {
+  switch (tag()) {
+  case POINTER_TAG:
+    return reinterpret_cast<cell_c *>(bits_)->as_double();
+  case MISC_TAG:
+  case INTEGER_TAG:
+    throw cell_access_exception_c(
+        "Cell is not a floating point: " + to_string(), nullptr);
+  default:
+    return double_bits();
+  }
+}
+
+inline double tagged_cell_ptr_c::to_double() const {
+  switch (tag()) {
+  case POINTER_TAG:
+    return reinterpret_cast<cell_c *>(bits_)->to_double();
+  case MISC_TAG:
+    return as_double();
+  case INTEGER_TAG:
+    return (double)integer_bits();
+  default:
+    return double_bits();
+  }
+}
+
+inline char tagged_cell_ptr_c::as_char() const {
+  if (tag() == POINTER_TAG) {
+    return reinterpret_cast<cell_c *>(bits_)->as_char();
+  }
+  if (type() != cell_type_e::CHAR) {
+    throw cell_access_exception_c("Cell is not a char", nullptr);
+  }
+  return static_cast<char>(bits_ & 0xFF);
+}
+
+namespace detail {
+template <typename... Args> inline cell_ptr make_cell(Args... args) {
+  return new cell_c(args...);
+}
+inline cell_ptr make_cell(int64_t value) {
+  return cell_ptr::from_integer(value);
+}
+inline cell_ptr make_cell(double value) { return cell_ptr::from_double(value); }
+inline cell_ptr make_cell(char value) { return cell_ptr::from_char(value); }
+inline cell_ptr make_cell(cell_type_e type) {
+  if (type == cell_type_e::NIL) {
+    return cell_ptr::nil();
+  }
+  return new cell_c(type);
+}
+} // namespace detail
 
 //! \brief Allocate a cell
 //! \params Ctor arguments for cell
 //! \note This is used to centralize allocations of cells
 //!       so we can swap memory management models
+//! \note I64, F64, CHAR, and NIL values are returned as immediates
+//!       that are only boxed if something dereferences them
 constexpr auto allocate_cell = [](auto... args) -> nibi::cell_ptr {
+  return detail::make_cell(args...);
+};
+
+//! \brief Allocate a cell that always lives on the heap
+//! \params Ctor arguments for cell
+//! \note Use this when the result must have its own identity
+constexpr auto allocate_boxed_cell = [](auto... args) -> nibi::cell_ptr {
   return new cell_c(args...);
 };
 
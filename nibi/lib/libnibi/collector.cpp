@@ -0,0 +1,580 @@
+#include "libnibi/collector.hpp"
+
+#include "libnibi/cell.hpp"
+#include "libnibi/environment.hpp"
+
+#include <chrono>
+#include <vector>
+
+/*
+    Reference counting frees everything except cycles, and nibi makes
+    those easily: a dict that stores itself (or a lambda that ends up
+    cached in its own body) keeps its own count above zero forever.
+
+    This is the synchronous trial deletion collector of Bacon and Rajan
+    ("Concurrent Cycle Collection in Reference Counted Systems", 2001).
+    Whenever the count of a cell that can hold references is lowered
+    without reaching zero the cell is buffered as a possible root. A
+    step takes roots from the buffer and, for the subgraph below each:
+
+      mark   subtract the references held inside the subgraph (gray)
+      scan   anything still counted is referenced from outside, so it
+             and everything below it has its counts restored (black).
+             The rest is garbage (white)
+      collect  free the white cells
+
+    Each step runs to completion, so the interpreter never observes
+    the adjusted counts. Steps are kept short by the budget, which
+    limits the number of cells traced before no further roots are
+    taken. Tracing uses explicit stacks as nested lists can be deep.
+
+    Only edges that the cell owns outright are followed. A LIST or DICT
+    payload shared with another cell (see shared_payload_s) or a module
+    environment held elsewhere is not traced, which makes whatever it
+    references look externally held. That can miss a cycle but never
+    frees a live cell.
+
+    White cells are not deleted directly. Their counts are restored,
+    they are held, their payloads are cleared (which breaks the cycle
+    through the normal release path), and then they are let go.
+
+    Releasing the last reference to a container would otherwise destroy
+    everything below it right away, recursing once per level of nesting
+    and pausing for as long as it takes to free the widest list. Instead
+    a payload being freed hands any child that would cascade to the
+    release queue, and the queue is worked off a budget at a time from
+    the same safe points that run collection steps.
+*/
+
+namespace nibi {
+
+class cycle_collector_c {
+public:
+  cycle_collector_c(collector::stats_s &stats) : stats_(stats) {}
+
+  void add(cell_c *cell) {
+    roots_.push_back(cell);
+    cell->root_slot_ = roots_.size() < OVERFLOW_SLOT
+                           ? static_cast<uint16_t>(roots_.size())
+                           : OVERFLOW_SLOT;
+  }
+
+  void remove(cell_c *cell) {
+    if (cell->root_slot_ != OVERFLOW_SLOT) {
+      roots_[cell->root_slot_ - 1] = nullptr;
+    } else {
+      for (auto i = OVERFLOW_SLOT - 1; i < roots_.size(); i++) {
+        if (roots_[i] == cell) {
+          roots_[i] = nullptr;
+          break;
+        }
+      }
+    }
+    cell->root_slot_ = 0;
+  }
+
+  std::size_t pending() const { return roots_.size(); }
+
+  std::size_t step() {
+    stats_.steps++;
+
+    // Take roots until the budget is spent. Anything that is not purple
+    // was already reached from an earlier root in this step
+    std::size_t traced = 0;
+    batch_.clear();
+    while (!roots_.empty() && traced < budget_) {
+      auto *cell = roots_.back();
+      roots_.pop_back();
+      if (!cell) {
+        continue;
+      }
+      cell->root_slot_ = 0;
+      if (color_of(cell) == cell_c::COLOR_PURPLE) {
+        traced += mark_gray(cell);
+        batch_.push_back(cell);
+      }
+    }
+    stats_.traced_cells += traced;
+
+    for (auto *cell : batch_) {
+      scan(cell);
+    }
+
+    garbage_.clear();
+    for (auto *cell : batch_) {
+      collect_white(cell);
+    }
+
+    return free_garbage();
+  }
+
+  std::size_t budget_{collector::DEFAULT_STEP_BUDGET};
+  std::size_t threshold_{collector::DEFAULT_ROOT_THRESHOLD};
+
+private:
+  // Roots past this slot are found by a search when they are removed
+  static constexpr uint16_t OVERFLOW_SLOT = 0xFFFF;
+
+  static uint8_t color_of(const cell_c *cell) {
+    return cell->flags_ & cell_c::COLOR_MASK;
+  }
+
+  static void paint(cell_c *cell, const uint8_t color) {
+    cell->flags_ = (cell->flags_ & ~cell_c::COLOR_MASK) | color;
+  }
+
+  //! \brief Call `fn` with every cell the given cell owns a
+  //!        reference to that could lead back to it
+  template <typename Fn> static void for_each_child(cell_c *cell, Fn &&fn) {
+    auto visit = [&fn](const cell_ptr &child) {
+      if (!child || child.is_immediate()) {
+        return;
+      }
+      // Immortal cells are not counted, so they can not be garbage
+      // and do not hold anything that could be
+      auto *target = child.get();
+      if (target->may_be_cyclic() && !target->is_immortal()) {
+        fn(target);
+      }
+    };
+
+    auto visit_env = [&visit](env_c *env) {
+      for (auto &entry : env->get_map()) {
+        visit(entry.second);
+      }
+    };
+
+    switch (cell->type) {
+    case cell_type_e::LIST:
+      if (cell->data.list && cell->data.list->owners == 1) {
+        for (auto &child : cell->data.list->list) {
+          visit(child);
+        }
+      }
+      break;
+    case cell_type_e::DICT:
+      if (cell->data.dict && cell->data.dict->owners == 1) {
+        for (auto &entry : cell->data.dict->data) {
+          visit(entry.second);
+        }
+      }
+      break;
+    case cell_type_e::FUNCTION: {
+      auto *info = cell->data.fn;
+      if (!info) {
+        break;
+      }
+      if (info->lambda.has_value()) {
+        visit(info->lambda->body);
+      }
+      // Only faux functions own their environment
+      if (info->type == function_type_e::FAUX && info->operating_env) {
+        visit_env(info->operating_env);
+      }
+      break;
+    }
+    case cell_type_e::ENVIRONMENT:
+      if (cell->data.env && cell->data.env->env.use_count() == 1) {
+        visit_env(cell->data.env->env.get());
+      }
+      break;
+    case cell_type_e::ALIAS:
+      if (cell->data.alias) {
+        visit(cell->data.alias->cell);
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  //! \brief Drop every reference for_each_child would visit
+  static void clear_children(cell_c *cell) {
+    switch (cell->type) {
+    case cell_type_e::LIST:
+      if (cell->data.list && cell->data.list->owners == 1) {
+        cell->data.list->list.clear();
+      }
+      break;
+    case cell_type_e::DICT:
+      if (cell->data.dict && cell->data.dict->owners == 1) {
+        cell->data.dict->data.clear();
+      }
+      break;
+    case cell_type_e::FUNCTION: {
+      auto *info = cell->data.fn;
+      if (!info) {
+        break;
+      }
+      if (info->lambda.has_value()) {
+        info->lambda->body = nullptr;
+      }
+      if (info->type == function_type_e::FAUX && info->operating_env) {
+        info->operating_env->get_map().clear();
+      }
+      break;
+    }
+    case cell_type_e::ENVIRONMENT:
+      if (cell->data.env && cell->data.env->env.use_count() == 1) {
+        cell->data.env->env->get_map().clear();
+      }
+      break;
+    case cell_type_e::ALIAS:
+      if (cell->data.alias) {
+        cell->data.alias->cell = nullptr;
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  //! \brief Rough size of a cell and what it owns, for reporting
+  static std::size_t estimate_size(const cell_c *cell) {
+    static constexpr std::size_t NODE_OVERHEAD = 4 * sizeof(void *);
+
+    auto env_size = [](env_c *env) {
+      return sizeof(env_c) +
+             env->get_map().size() *
+                 (sizeof(env_c::env_map_t::value_type) + NODE_OVERHEAD);
+    };
+
+    std::size_t size = sizeof(cell_c);
+    switch (cell->type) {
+    case cell_type_e::LIST:
+      if (cell->data.list && cell->data.list->owners == 1) {
+        size += sizeof(list_info_s) +
+                cell->data.list->list.capacity() * sizeof(cell_ptr);
+      }
+      break;
+    case cell_type_e::DICT:
+      if (cell->data.dict && cell->data.dict->owners == 1) {
+        size += sizeof(dict_info_s) +
+                cell->data.dict->data.size() *
+                    (sizeof(cell_dict_t::value_type) + NODE_OVERHEAD);
+      }
+      break;
+    case cell_type_e::FUNCTION:
+      if (cell->data.fn) {
+        size += sizeof(function_info_s);
+        if (cell->data.fn->type == function_type_e::FAUX &&
+            cell->data.fn->operating_env) {
+          size += env_size(cell->data.fn->operating_env);
+        }
+      }
+      break;
+    case cell_type_e::ENVIRONMENT:
+      if (cell->data.env) {
+        size += sizeof(environment_info_s);
+        if (cell->data.env->env.use_count() == 1) {
+          size += env_size(cell->data.env->env.get());
+        }
+      }
+      break;
+    case cell_type_e::ALIAS:
+      if (cell->data.alias) {
+        size += sizeof(alias_s);
+      }
+      break;
+    default:
+      break;
+    }
+    return size;
+  }
+
+  //! \brief Remove the references held within the subgraph of a root
+  //! \returns The number of cells traced
+  std::size_t mark_gray(cell_c *root) {
+    std::size_t traced = 0;
+    paint(root, cell_c::COLOR_GRAY);
+    stack_.push_back(root);
+    while (!stack_.empty()) {
+      auto *cell = stack_.back();
+      stack_.pop_back();
+      traced++;
+      for_each_child(cell, [this](cell_c *child) {
+        child->ref_count_--;
+        if (color_of(child) != cell_c::COLOR_GRAY) {
+          paint(child, cell_c::COLOR_GRAY);
+          stack_.push_back(child);
+        }
+      });
+    }
+    return traced;
+  }
+
+  //! \brief Split a traced subgraph into live (black) and garbage (white)
+  void scan(cell_c *root) {
+    stack_.push_back(root);
+    while (!stack_.empty()) {
+      auto *cell = stack_.back();
+      stack_.pop_back();
+      if (color_of(cell) != cell_c::COLOR_GRAY) {
+        continue;
+      }
+      if (cell->ref_count_ > 0) {
+        scan_black(cell);
+        continue;
+      }
+      paint(cell, cell_c::COLOR_WHITE);
+      for_each_child(cell, [this](cell_c *child) { stack_.push_back(child); });
+    }
+  }
+
+  //! \brief Restore the counts below a cell that is referenced externally
+  void scan_black(cell_c *root) {
+    paint(root, cell_c::COLOR_BLACK);
+    black_stack_.push_back(root);
+    while (!black_stack_.empty()) {
+      auto *cell = black_stack_.back();
+      black_stack_.pop_back();
+      for_each_child(cell, [this](cell_c *child) {
+        child->ref_count_++;
+        if (color_of(child) != cell_c::COLOR_BLACK) {
+          paint(child, cell_c::COLOR_BLACK);
+          black_stack_.push_back(child);
+        }
+      });
+    }
+  }
+
+  //! \brief Gather the white cells reachable from a root
+  void collect_white(cell_c *root) {
+    if (color_of(root) != cell_c::COLOR_WHITE) {
+      return;
+    }
+    paint(root, cell_c::COLOR_BLACK);
+    stack_.push_back(root);
+    while (!stack_.empty()) {
+      auto *cell = stack_.back();
+      stack_.pop_back();
+      garbage_.push_back(cell);
+      for_each_child(cell, [this](cell_c *child) {
+        if (color_of(child) == cell_c::COLOR_WHITE) {
+          paint(child, cell_c::COLOR_BLACK);
+          stack_.push_back(child);
+        }
+      });
+    }
+  }
+
+  //! \brief Break the garbage cycles and let the cells be released
+  std::size_t free_garbage() {
+    if (garbage_.empty()) {
+      return 0;
+    }
+
+    // Give back the counts taken by mark_gray so that every count
+    // matches the references that actually exist again
+    std::size_t bytes = 0;
+    for (auto *cell : garbage_) {
+      for_each_child(cell, [](cell_c *child) { child->ref_count_++; });
+      bytes += estimate_size(cell);
+    }
+
+    // Hold everything while the cycles are cut so no cell is
+    // destroyed while another garbage cell still points at it
+    std::vector<cell_ptr> held(garbage_.begin(), garbage_.end());
+    stats_.collected_cells += garbage_.size();
+    stats_.collected_bytes += bytes;
+    garbage_.clear();
+
+    for (auto &cell : held) {
+      clear_children(cell.get());
+    }
+    return bytes;
+  }
+
+  std::vector<cell_c *> roots_;
+  std::vector<cell_c *> batch_;
+  std::vector<cell_c *> stack_;
+  std::vector<cell_c *> black_stack_;
+  std::vector<cell_c *> garbage_;
+  collector::stats_s &stats_;
+};
+
+//! \brief Cells whose release was deferred so that freeing a large
+//!        structure does not happen all at once
+class release_queue_c {
+public:
+  release_queue_c(collector::stats_s &stats) : stats_(stats) {}
+
+  void push(cell_ptr &cell) {
+    queue_.push_back(std::move(cell));
+    stats_.deferred_cells++;
+    if (queue_.size() > stats_.max_queue_depth) {
+      stats_.max_queue_depth = queue_.size();
+    }
+  }
+
+  //! \brief Release up to `budget` cells
+  //! \note  Releasing a cell may queue its own children, which are
+  //!        taken next so the queue stays shallow for deep structures
+  std::size_t drain(const std::size_t budget) {
+    auto outermost = !draining_;
+    draining_ = true;
+    std::size_t released = 0;
+    while (!queue_.empty() && released < budget) {
+      auto cell = std::move(queue_.back());
+      queue_.pop_back();
+      cell = nullptr;
+      released++;
+    }
+    if (outermost) {
+      draining_ = false;
+    }
+    return released;
+  }
+
+  std::size_t depth() const { return queue_.size(); }
+
+  //! \brief Check if a drain is under way further up the stack
+  bool is_draining() const { return draining_; }
+
+  std::size_t budget_{collector::DEFAULT_DRAIN_BUDGET};
+
+private:
+  std::vector<cell_ptr> queue_;
+  collector::stats_s &stats_;
+  bool draining_{false};
+};
+
+//! \brief Memory management state of a single thread
+struct collector_state_s {
+  collector::stats_s stats;
+  cycle_collector_c cycles{stats};
+  release_queue_c releases{stats};
+
+  // Set once the thread has exited, nothing drains the queue from a
+  // safe point after that so releases drain it as they are made
+  bool retired{false};
+};
+
+namespace collector {
+
+namespace {
+
+// Kept as a pointer so the state is never destroyed. Cells may be
+// released during thread and static destruction
+thread_local collector_state_s *thread_state{nullptr};
+
+collector_state_s &get_state() {
+  if (!thread_state) {
+    thread_state = new collector_state_s();
+  }
+  return *thread_state;
+}
+
+cycle_collector_c &get_collector() { return get_state().cycles; }
+
+//! \brief Releases whatever is left in the thread's queue when it exits
+//!        so the destructors of queued cells still run
+struct release_queue_guard_s {
+  bool armed{false};
+  ~release_queue_guard_s() {
+    if (!armed) {
+      return;
+    }
+    auto &state = get_state();
+    state.retired = true;
+    state.releases.drain(SIZE_MAX);
+  }
+};
+
+thread_local release_queue_guard_s release_queue_guard;
+
+} // namespace
+
+void add_possible_root(cell_c *cell) { get_collector().add(cell); }
+
+void remove_possible_root(cell_c *cell) { get_collector().remove(cell); }
+
+bool is_step_due() {
+  auto &collector = get_collector();
+  return collector.pending() >= collector.threshold_;
+}
+
+std::size_t step() { return get_collector().step(); }
+
+std::size_t collect() {
+  auto &collector = get_collector();
+  std::size_t bytes = 0;
+  while (collector.pending()) {
+    bytes += collector.step();
+  }
+  return bytes;
+}
+
+void set_step_budget(const std::size_t budget) {
+  get_collector().budget_ = budget ? budget : 1;
+}
+
+std::size_t get_step_budget() { return get_collector().budget_; }
+
+void set_root_threshold(const std::size_t threshold) {
+  get_collector().threshold_ = threshold;
+}
+
+std::size_t get_root_threshold() { return get_collector().threshold_; }
+
+std::size_t get_pending_roots() { return get_collector().pending(); }
+
+void defer_release(cell_ptr &cell) {
+  auto &state = get_state();
+  state.releases.push(cell);
+  if (!state.retired) {
+    release_queue_guard.armed = true;
+    return;
+  }
+
+  // Once the thread has exited the outermost release drains the queue,
+  // any it causes are queued behind it so deep structures are still
+  // not released recursively
+  if (!state.releases.is_draining()) {
+    state.releases.drain(SIZE_MAX);
+  }
+}
+
+std::size_t drain(const std::size_t budget) {
+  return get_state().releases.drain(budget);
+}
+
+void drain_all() { get_state().releases.drain(SIZE_MAX); }
+
+void set_drain_budget(const std::size_t budget) {
+  get_state().releases.budget_ = budget ? budget : 1;
+}
+
+std::size_t get_drain_budget() { return get_state().releases.budget_; }
+
+std::size_t get_queue_depth() { return get_state().releases.depth(); }
+
+void run_safe_point() {
+  auto &state = get_state();
+  auto step_due = state.cycles.pending() >= state.cycles.threshold_;
+  if (!step_due && !state.releases.depth()) {
+    return;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  state.releases.drain(state.releases.budget_);
+  if (step_due) {
+    state.cycles.step();
+  }
+
+  uint64_t pause = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  state.stats.pauses++;
+  state.stats.last_pause_ns = pause;
+  state.stats.total_pause_ns += pause;
+  if (pause > state.stats.max_pause_ns) {
+    state.stats.max_pause_ns = pause;
+  }
+}
+
+stats_s get_stats() { return get_state().stats; }
+
+} // namespace collector
+} // namespace nibi
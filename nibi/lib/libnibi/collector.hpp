@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace nibi {
+
+class cell_c;
+class tagged_cell_ptr_c;
+
+namespace collector {
+
+//! \brief Default number of cells a single collection step may trace
+//!        before it stops taking new roots
+static constexpr std::size_t DEFAULT_STEP_BUDGET = 4096;
+
+//! \brief Default number of possible roots that must be buffered
+//!        before a step is considered due
+static constexpr std::size_t DEFAULT_ROOT_THRESHOLD = 8192;
+
+//! \brief Default number of deferred releases performed per safe point
+static constexpr std::size_t DEFAULT_DRAIN_BUDGET = 4096;
+
+//! \brief Totals kept by the collector of the calling thread
+struct stats_s {
+  std::size_t steps{0};           // Collection steps taken
+  std::size_t traced_cells{0};    // Cells visited by trial deletion
+  std::size_t collected_cells{0}; // Cells freed as part of a cycle
+  std::size_t collected_bytes{0}; // Estimated bytes of the freed cells
+                                  // and their payloads
+  std::size_t deferred_cells{0};  // Releases handed to the queue
+  std::size_t max_queue_depth{0}; // Deepest the release queue has been
+  std::size_t pauses{0};          // Safe points that had work to do
+  uint64_t last_pause_ns{0};      // Time spent in the latest of those
+  uint64_t max_pause_ns{0};       // Time spent in the longest of those
+  uint64_t total_pause_ns{0};     // Time spent in all of them
+};
+
+//! \brief Record that a cell which may be part of a cycle had its
+//!        reference count lowered to a non-zero value
+//! \note  Called by the cell itself, see cell_c::mark_possible_root
+extern void add_possible_root(cell_c *cell);
+
+//! \brief Forget a buffered cell that is being destroyed
+extern void remove_possible_root(cell_c *cell);
+
+//! \brief Check if enough possible roots have been buffered
+//!        for a step to be worth taking
+extern bool is_step_due();
+
+//! \brief Run trial deletion over buffered roots until the step
+//!        budget is spent, freeing any garbage cycles found
+//! \returns The estimated number of bytes freed
+//! \note  Only call this where every live cell is held by a counted
+//!        reference, i.e. not while a cell is being destroyed or
+//!        updated. The interpreter does so from process_cell
+extern std::size_t step();
+
+//! \brief Run steps until no possible roots remain
+//! \returns The estimated number of bytes freed
+extern std::size_t collect();
+
+//! \brief Set the number of cells a step may trace
+//! \note  The budget is checked between roots, so a single
+//!        large structure is always traced to completion
+extern void set_step_budget(const std::size_t budget);
+
+//! \brief Get the number of cells a step may trace
+extern std::size_t get_step_budget();
+
+//! \brief Set the number of buffered roots at which a step is due
+extern void set_root_threshold(const std::size_t threshold);
+
+//! \brief Get the number of buffered roots at which a step is due
+extern std::size_t get_root_threshold();
+
+//! \brief Get the number of possible roots waiting to be traced
+extern std::size_t get_pending_roots();
+
+//! \brief Release a cell later instead of now
+//! \param cell The handle to release, it is left empty
+//! \note  Used when freeing a container so its children are not
+//!        destroyed recursively. The queue is drained from safe points
+//!        and when the thread exits
+extern void defer_release(tagged_cell_ptr_c &cell);
+
+//! \brief Release up to `budget` deferred cells
+//! \returns The number of cells released
+extern std::size_t drain(const std::size_t budget);
+
+//! \brief Release every deferred cell, including any queued while
+//!        doing so
+extern void drain_all();
+
+//! \brief Set the number of deferred cells released per safe point
+extern void set_drain_budget(const std::size_t budget);
+
+//! \brief Get the number of deferred cells released per safe point
+extern std::size_t get_drain_budget();
+
+//! \brief Get the number of cells waiting in the release queue
+extern std::size_t get_queue_depth();
+
+//! \brief Do whatever memory work is due, within the budgets
+//! \note  This drains the release queue and takes a collection step
+//!        if one is due. The time taken is recorded as a pause.
+//!        Called by the interpreter, see the notes on `step`
+extern void run_safe_point();
+
+//! \brief Get the totals kept for the calling thread
+extern stats_s get_stats();
+
+} // namespace collector
+} // namespace nibi
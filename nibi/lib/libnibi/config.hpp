@@ -10,5 +10,8 @@ static constexpr const char *NIBI_MODULE_TEST_DIR = "tests";
 static constexpr const char *NIBI_APP_ENTRY_FILE_NAME = "main.nibi";
 static constexpr const char *NIBI_SYSTEM_CONFIG_FILE_NAME = "config.nibi";
 static constexpr uint32_t NIBI_MODULE_ABERRANT_ID_SIZE = 32;
+static constexpr uint32_t NIBI_SAFE_POINT_INTERVAL = 1024;
+static constexpr uint32_t NIBI_MAX_CALL_DEPTH = 1000;
+static constexpr uint32_t NIBI_STACK_RESERVE = 256 * 1024;
 } // namespace config
 } // namespace nibi
@@ -5,65 +5,172 @@ env_c::~env_c() {}
 
 env_c::env_c(env_c *parent_env) : parent_env_(parent_env) {}
 
-env_c *env_c::get_env(const std::string &name) {
+env_c::env_c(env_c *parent_env, const slot_layout_t &layout)
+    : parent_env_(parent_env), layout_(&layout),
+      slots_(layout.size(), cell_ptr{}) {}
 
-  if (cell_map_.find(name) != cell_map_.end()) {
+env_c *env_c::get_env(const symbol_id_t id) {
+
+  if (cell_map_.find(id) != cell_map_.end()) {
+    return this;
+  }
+
+  if (auto *slot = slot_of(id); slot && *slot) {
     return this;
   }
 
   if (parent_env_) {
-    return parent_env_->get_env(name);
+    return parent_env_->get_env(id);
   }
 
   return nullptr;
 }
 
-cell_ptr env_c::get(const std::string &name) {
-  auto it = cell_map_.find(name);
+env_c *env_c::get_env(const std::string_view name) {
+  auto id = symbols::find(name);
+  if (!id.has_value()) {
+    return nullptr;
+  }
+  return get_env(*id);
+}
+
+cell_ptr env_c::get(const symbol_id_t id) {
+  auto it = cell_map_.find(id);
   if (it != cell_map_.end()) {
+    // Immediates are boxed in place so the caller and the
+    // environment share the same cell for `set` to update
+    it->second.box();
     return it->second;
   }
 
+  if (auto *slot = slot_of(id); slot && *slot) {
+    slot->box();
+    return *slot;
+  }
+
   if (parent_env_) {
-    return parent_env_->get(name);
+    return parent_env_->get(id);
   }
 
   return nullptr;
 }
 
-bool env_c::do_set(const std::string &name, const cell_ptr &cell) {
+const cell_ptr *env_c::find(const symbol_id_t id) const {
+  for (auto *current = this; current; current = current->parent_env_) {
+    auto it = current->cell_map_.find(id);
+    if (it != current->cell_map_.end()) {
+      return &it->second;
+    }
+    if (auto *slot = current->slot_of(id); slot && *slot) {
+      return slot;
+    }
+  }
+  return nullptr;
+}
+
+cell_ptr env_c::get(const std::string_view name) {
+  auto id = symbols::find(name);
+  if (!id.has_value()) {
+    return nullptr;
+  }
+  return get(*id);
+}
+
+bool env_c::do_set(const symbol_id_t id, const cell_ptr &cell) {
 
-  auto it = cell_map_.find(name);
+  auto it = cell_map_.find(id);
   if (it != cell_map_.end()) {
     it->second = cell;
+    touch();
+    return true;
+  }
+
+  if (auto *slot = slot_of(id); slot && *slot) {
+    *slot = cell;
+    touch();
     return true;
   }
 
   if (parent_env_) {
-    return parent_env_->do_set(name, cell);
+    return parent_env_->do_set(id, cell);
   }
 
   return false;
 }
 
-void env_c::set(const std::string &name, const cell_ptr &cell) {
-  if (!do_set(name, cell)) {
-    cell_map_[name] = cell;
+void env_c::set(const symbol_id_t id, const cell_ptr &cell) {
+  if (!do_set(id, cell)) {
+    define(id, cell);
   }
 }
 
-bool env_c::drop(const std::string &name) {
+void env_c::define(const symbol_id_t id, const cell_ptr &cell) {
+  touch();
+  if (auto *slot = slot_of(id)) {
+    *slot = cell;
+    return;
+  }
+  cell_map_[id] = cell;
+}
+
+void env_c::set(const std::string_view name, const cell_ptr &cell) {
+  set(symbols::intern(name), cell);
+}
 
-  auto it = cell_map_.find(name);
+bool env_c::drop(const symbol_id_t id) {
+
+  auto it = cell_map_.find(id);
   if (it != cell_map_.end()) {
     cell_map_.erase(it);
+    touch();
+    return true;
+  }
+
+  if (auto *slot = slot_of(id); slot && *slot) {
+    *slot = nullptr;
+    touch();
     return true;
   }
 
   if (parent_env_) {
-    return parent_env_->drop(name);
+    return parent_env_->drop(id);
   }
 
   return false;
 }
+
+void env_c::capture() {
+  for (auto *current = this; current && !current->captured_;
+       current = current->parent_env_) {
+    current->captured_ = true;
+  }
+}
+
+bool env_c::is_captured_below(const env_c &outer) const {
+  for (auto *current = this; current && current != &outer;
+       current = current->parent_env_) {
+    if (current->captured_) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void env_c::reset(env_c *parent_env, const slot_layout_t &layout) {
+  parent_env_ = parent_env;
+  cell_map_.clear();
+  loaded_modules_.clear();
+  layout_ = &layout;
+  slots_.clear();
+  slots_.resize(layout.size());
+  touch();
+}
+
+bool env_c::drop(const std::string_view name) {
+  auto id = symbols::find(name);
+  if (!id.has_value()) {
+    return false;
+  }
+  return drop(*id);
+}
 } // namespace nibi
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "cell.hpp"
+#include "small_vector.hpp"
+#include "symbols.hpp"
 
 #include <set>
 #include <string>
+#include <string_view>
 
 #include <map>
 
@@ -11,6 +14,13 @@ namespace nibi {
 
 //! \brief The environment object that will be used to store
 //!        and manage the cells that are used in different scopes
+//! \note  An environment can be given a layout of variables that it
+//!        keeps in slots instead of its map, which compiled code reads
+//!        by (depth, slot) without searching by name. Everything else
+//!        finds them by name as it would any other variable
+//! \note  Each environment has a version, which changes whenever it
+//!        binds, sets or drops a variable, for inline caches to check
+//!        that what they found in it still holds
 class env_c {
 public:
   // The current implementation has been perfomance tested
@@ -23,7 +33,10 @@ public:
   // followed by phmap::parallel_node_hash_map
   // and then std::unordered_map
   //
-  using env_map_t = std::map<std::string, cell_ptr>;
+  // Entries are keyed on interned symbol ids (see symbols.hpp)
+  // so lookups compare integers rather than strings
+  //
+  using env_map_t = std::map<symbol_id_t, cell_ptr>;
 
   env_c() = default;
   ~env_c();
@@ -33,37 +46,117 @@ public:
   //!        upper level scopes
   env_c(env_c *parent_env);
 
+  //! \brief Create an environment that keeps the variables of a
+  //!        layout in slots
+  //! \param parent_env The parent environment to use for searching
+  //!        upper level scopes
+  //! \param layout The variables to keep in slots, in slot order
+  //! \note  The layout must outlive the environment
+  env_c(env_c *parent_env, const slot_layout_t &layout);
+
   //! \brief Get the env that a cell is in
-  //! \param name The name of the cell
+  //! \param id The symbol id of the cell
   //! \return The env if it exists in this environment or
   //!         a parent environment. otherwise, nullptr
-  env_c *get_env(const std::string &name);
+  env_c *get_env(const symbol_id_t id);
 
-  //! \brief Get a cell from the environment
+  //! \brief Get the env that a cell is in
   //! \param name The name of the cell
+  env_c *get_env(const std::string_view name);
+
+  //! \brief Get a cell from the environment
+  //! \param id The symbol id of the cell
   //! \return The cell if it exists in this environment or
   //!         a parent environment. otherwise, nullptr
   //! \note Use this function to get a cell from the environment
   //!       that needs to be updated if we want to ensure it exists
   //!       in the environment or in the parent
-  cell_ptr get(const std::string &name);
+  cell_ptr get(const symbol_id_t id);
 
-  //! \brief Set a cell in the environment
+  //! \brief Get a cell from the environment by name
   //! \param name The name of the cell
+  cell_ptr get(const std::string_view name);
+
+  //! \brief Find the handle a cell is stored in, without taking
+  //!        a reference to it or boxing it
+  //! \param id The symbol id of the cell
+  //! \return The handle if it exists in this environment or
+  //!         a parent environment. otherwise, nullptr
+  //! \note The handle is valid until the cell is dropped
+  const cell_ptr *find(const symbol_id_t id) const;
+
+  //! \brief Find the handle of a variable by its address, giving
+  //!        what find(id) gives
+  //! \param id The symbol id of the variable
+  //! \param depth The number of parents up the variable is kept
+  //! \param slot The slot it is kept in there
+  //! \note  The layouts of the environments on the way up must not
+  //!        hold the variable. Variables bound by name on the way up,
+  //!        or an empty slot, fall back to find(id)
+  inline const cell_ptr *find(const symbol_id_t id, const uint16_t depth,
+                              const uint16_t slot) const;
+
+  //! \brief Get a variable by its address, giving what get(id) gives
+  //! \see find(id, depth, slot)
+  inline cell_ptr get(const symbol_id_t id, const uint16_t depth,
+                      const uint16_t slot);
+
+  //! \brief Set a cell in the environment
+  //! \param id The symbol id of the cell
   //! \param cell The cell to set
-  void set(const std::string &name, const cell_ptr &cell);
+  void set(const symbol_id_t id, const cell_ptr &cell);
+
+  //! \brief Set a variable by its address, as set(id, cell) does
+  //! \see find(id, depth, slot)
+  inline void set(const symbol_id_t id, const uint16_t depth,
+                  const uint16_t slot, const cell_ptr &cell);
+
+  //! \brief Find the handle a variable is stored in through the
+  //!        inline cache of a call site, giving what find(id) gives
+  //! \param id The symbol id of the variable
+  //! \param cache Where the site found the variable last, which is
+  //!        updated when it is found anywhere else
+  //! \note  The environment the variable was found in is not
+  //!        searched again while its version is unchanged, but the
+  //!        ones on the way to it are, in case they now hide it
+  inline cell_ptr *find(const symbol_id_t id, binding_cache_s &cache);
+
+  //! \brief Bind a cell in this environment, without looking for the
+  //!        variable in parent environments
+  //! \param id The symbol id of the cell
+  //! \param cell The cell to bind
+  void define(const symbol_id_t id, const cell_ptr &cell);
+
+  //! \brief Get a slot of the environment
+  //! \param index The index of the slot in the layout
+  //! \note  Writing the slot does not change the version, it is
+  //!        meant for binding arguments before the environment is used
+  cell_ptr &slot(const uint16_t index) { return slots_[index]; }
+
+  //! \brief Set a cell in the environment by name
+  //! \param name The name of the cell, interned if required
+  //! \param cell The cell to set
+  void set(const std::string_view name, const cell_ptr &cell);
 
   //! \brief Drop a cell from the environment, or parent environment(s)
-  //! \param name The name of the cell
+  //! \param id The symbol id of the cell
   //! \returns True if the cell was dropped, false if item not found
   //! \post The cell will be erased from the environment and marked for deletion
-  bool drop(const std::string &name);
+  bool drop(const symbol_id_t id);
+
+  //! \brief Drop a cell from the environment by name
+  //! \param name The name of the cell
+  bool drop(const std::string_view name);
 
   //! \brief Get the map of cells in the environment
   //! \return The map of cells in the environment
   //! \note This is meant for quick cell creation and
-  //!       retrieval for specific environments
-  env_map_t &get_map() { return cell_map_; }
+  //!       retrieval for specific environments. The version changes
+  //!       as the map may be written through the result
+  env_map_t &get_map() {
+    touch();
+    return cell_map_;
+  }
 
   //! \brief Indicate that a module has been loaded
   //! \param module_name The name of the module
@@ -71,6 +164,26 @@ public:
     loaded_modules_.insert(module_name);
   }
 
+  //! \brief Mark the environment as one that functions defined in it
+  //!        refer to, as do the environments it is nested in
+  //! \note  Such a function may outlive the call the environment
+  //!        belongs to, so the environment must not be reused
+  void capture();
+
+  //! \brief Check if functions defined in the environment, or in one
+  //!        nested in it, refer to it
+  bool is_captured() const { return captured_; }
+
+  //! \brief Check if this environment, or one it is nested in on the
+  //!        way up to `outer`, is captured
+  //! \param outer An environment this one is nested in
+  bool is_captured_below(const env_c &outer) const;
+
+  //! \brief Empty the environment to use it again, as if it had been
+  //!        created with a parent and a layout
+  //! \note  The environment must not be captured
+  void reset(env_c *parent_env, const slot_layout_t &layout);
+
   //! \brief Check if a module has been loaded
   //! \param module_name The name of the module
   //! \return True if the module has been loaded, false otherwise
@@ -87,10 +200,134 @@ public:
   }
 
 private:
+  // Slots most layouts fit in without an allocation
+  static constexpr std::size_t INLINE_SLOTS = 4;
+
+  // Versions are taken from a single clock and never reused, not even
+  // by a copy of an environment or one that takes the place of another
+  struct version_s {
+    inline static uint64_t clock{0};
+    uint64_t value{++clock};
+
+    version_s() = default;
+    version_s(const version_s &) {}
+    version_s &operator=(const version_s &) {
+      value = ++clock;
+      return *this;
+    }
+  };
+
   env_c *parent_env_{nullptr};
   env_map_t cell_map_;
   std::set<std::string> loaded_modules_;
+  const slot_layout_t *layout_{nullptr};
+  small_vector_c<cell_ptr, INLINE_SLOTS> slots_;
+  version_s version_;
+  bool captured_{false};
+
+  void touch() { version_.value = ++version_s::clock; }
+
+  inline bool do_set(const symbol_id_t id, const cell_ptr &cell);
 
-  inline bool do_set(const std::string &name, const cell_ptr &cell);
+  // Get the slot of a variable, nullptr if it is not in the layout
+  inline cell_ptr *slot_of(const symbol_id_t id);
+  inline const cell_ptr *slot_of(const symbol_id_t id) const;
+
+  // Get the handle a variable is stored in if it is bound in this
+  // environment, without looking in parent environments
+  inline cell_ptr *handle_of(const symbol_id_t id);
+
+  // Get the environment `depth` parents up, nullptr if a variable
+  // bound by name on the way could hide the one looked for
+  inline env_c *frame_at(uint16_t depth) const;
 };
+
+env_c *env_c::frame_at(uint16_t depth) const {
+  auto *frame = const_cast<env_c *>(this);
+  for (; depth; depth--) {
+    if (!frame->cell_map_.empty()) {
+      return nullptr;
+    }
+    frame = frame->parent_env_;
+  }
+  return frame;
+}
+
+const cell_ptr *env_c::find(const symbol_id_t id, const uint16_t depth,
+                            const uint16_t slot) const {
+  if (auto *frame = frame_at(depth)) {
+    if (auto &value = frame->slots_[slot]) {
+      return &value;
+    }
+  }
+  return find(id);
+}
+
+cell_ptr env_c::get(const symbol_id_t id, const uint16_t depth,
+                    const uint16_t slot) {
+  if (auto *frame = frame_at(depth)) {
+    if (auto &value = frame->slots_[slot]) {
+      value.box();
+      return value;
+    }
+  }
+  return get(id);
+}
+
+void env_c::set(const symbol_id_t id, const uint16_t depth,
+                const uint16_t slot, const cell_ptr &cell) {
+  if (auto *frame = frame_at(depth)) {
+    if (auto &value = frame->slots_[slot]) {
+      value = cell;
+      frame->touch();
+      return;
+    }
+  }
+  set(id, cell);
+}
+
+cell_ptr *env_c::slot_of(const symbol_id_t id) {
+  if (!layout_) {
+    return nullptr;
+  }
+  for (std::size_t i = 0; i < layout_->size(); i++) {
+    if ((*layout_)[i] == id) {
+      return &slots_[i];
+    }
+  }
+  return nullptr;
+}
+
+const cell_ptr *env_c::slot_of(const symbol_id_t id) const {
+  return const_cast<env_c *>(this)->slot_of(id);
+}
+
+cell_ptr *env_c::handle_of(const symbol_id_t id) {
+  auto it = cell_map_.find(id);
+  if (it != cell_map_.end()) {
+    return &it->second;
+  }
+  if (auto *slot = slot_of(id); slot && *slot) {
+    return slot;
+  }
+  return nullptr;
+}
+
+cell_ptr *env_c::find(const symbol_id_t id, binding_cache_s &cache) {
+  if (cache.id != id) {
+    cache = {id};
+  }
+  for (auto *current = this; current; current = current->parent_env_) {
+    if (current == cache.owner && current->version_.value == cache.version) {
+      return cache.handle;
+    }
+    if (auto *handle = current->handle_of(id)) {
+      cache.owner = current;
+      cache.version = current->version_.value;
+      cache.handle = handle;
+      return handle;
+    }
+  }
+  return nullptr;
+}
 } // namespace nibi
@@ -17,6 +17,12 @@ public:
   error_c(locator_ptr locator, const std::string message)
       : locator_(locator), message_(message) {}
 
+  //! \brief Create an error.
+  //! \param locator The packed location.
+  //! \param message The error message.
+  error_c(const packed_locator_s locator, const std::string message)
+      : locator_(source_manager_c::resolve(locator)), message_(message) {}
+
   //! \brief Check if the error has a locator interface.
   bool has_locator() const { return locator_ != nullptr; }
 
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace nibi {
+
+//! \brief The ways an interpreter can execute the bodies of lambdas
+//! \note  Top level instructions, `eval` and macros are always walked
+//!        as parsed. Every tier gives the same results
+enum class execution_tier_e : uint8_t {
+  TREE,     // Walk the parsed cells on every call
+  BYTECODE, // Compile to bytecode on the first call, see interpreter/vm
+  CLOSURE,  // Build into closures on the first call, see interpreter/closure
+};
+
+//! \brief Get a tier by its name, as given on the command line
+//! \returns nullopt if no tier has the name
+inline std::optional<execution_tier_e>
+execution_tier_from_string(const std::string_view name) {
+  if (name == "tree") {
+    return execution_tier_e::TREE;
+  }
+  if (name == "bytecode") {
+    return execution_tier_e::BYTECODE;
+  }
+  if (name == "closure") {
+    return execution_tier_e::CLOSURE;
+  }
+  return std::nullopt;
+}
+
+} // namespace nibi
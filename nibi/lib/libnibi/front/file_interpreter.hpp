@@ -63,6 +63,18 @@ public:
     intake_.end_of_file();
   }
 
+  void set_memory_budget(std::size_t bytes) override {
+    interpreter_.set_memory_budget(bytes);
+  }
+
+  void set_max_call_depth(std::size_t depth) override {
+    interpreter_.set_max_call_depth(depth);
+  }
+
+  void set_execution_tier(execution_tier_e tier) override {
+    interpreter_.set_execution_tier(tier);
+  }
+
 private:
   error_callback_f error_callback_;
   env_c environment_;
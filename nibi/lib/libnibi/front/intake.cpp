@@ -11,7 +11,7 @@ namespace nibi {
 
 namespace {
 
-token_c generate_type_token(token_e token, locator_ptr locator) {
+token_c generate_type_token(token_e token, packed_locator_s locator) {
 
   switch (token) {
   case token_e::NIL:
@@ -116,7 +116,7 @@ void intake_c::read_line(std::string_view line,
 
 void intake_c::evaluate(std::string_view data,
                         std::shared_ptr<source_origin_c> origin,
-                        locator_ptr location) {
+                        packed_locator_s location) {
   process_line(data, origin, location);
   check_for_complete_expression();
 }
@@ -140,17 +140,18 @@ inline bool check_buffer(std::string &buffer, char c) {
 
 bool intake_c::process_line(std::string_view data,
                             std::shared_ptr<source_origin_c> origin,
-                            locator_ptr loc_override) {
+                            packed_locator_s loc_override) {
 
   for (std::size_t col = 0; col < data.size(); col++) {
-    auto locator =
-        (loc_override)
-            ? origin->get_locator(tracker_.line_count,
-                                  loc_override->get_column() + 1 + col)
-            : origin->get_locator(tracker_.line_count, col);
     if (std::isspace(data[col])) {
       continue;
     }
+    // Made once per token, the loops below consume the rest of it
+    auto locator =
+        (loc_override)
+            ? origin->pack(tracker_.line_count,
+                           loc_override.column() + 1 + col)
+            : origin->pack(tracker_.line_count, col);
     switch (data[col]) {
     case '#': {
       return true;
@@ -370,10 +371,6 @@ cell_ptr intake_c::parser_c::instruction_list() {
 
   cell_list_t list;
 
-#if CELL_LIST_USE_STD_VECTOR
-  list.reserve(CELL_VEC_RESERVE_SIZE);
-#endif
-
   switch (current_token()) {
   case token_e::SYMBOL:
     list.emplace_back(symbol());
@@ -399,7 +396,7 @@ cell_ptr intake_c::parser_c::instruction_list() {
   auto instruction =
       allocate_cell(list_info_s{list_types_e::INSTRUCTION, std::move(list)});
 
-  instruction->locator = instruction_start_locator;
+  instruction->set_locator(instruction_start_locator);
   return std::move(instruction);
 }
 
@@ -414,17 +411,13 @@ cell_ptr intake_c::parser_c::access_list() {
 
   cell_list_t list;
 
-#if CELL_LIST_USE_STD_VECTOR
-  list.reserve(CELL_VEC_RESERVE_SIZE);
-#endif
-
   NIBI_PARSER_SCAN_LIST(token_e::L_BRACE, token_e::R_BRACE, symbol);
 
   next();
 
   auto nlist =
       allocate_cell(list_info_s{list_types_e::ACCESS, std::move(list)});
-  nlist->locator = locator;
+  nlist->set_locator(locator);
   return std::move(nlist);
 }
 
@@ -439,16 +432,12 @@ cell_ptr intake_c::parser_c::data_list() {
 
   cell_list_t list;
 
-#if CELL_LIST_USE_STD_VECTOR
-  list.reserve(CELL_VEC_RESERVE_SIZE);
-#endif
-
   NIBI_PARSER_SCAN_LIST(token_e::L_BRACKET, token_e::R_BRACKET, element);
 
   next();
 
   auto nlist = allocate_cell(list_info_s{list_types_e::DATA, std::move(list)});
-  nlist->locator = locator;
+  nlist->set_locator(locator);
   return std::move(nlist);
 }
 
@@ -527,7 +516,7 @@ cell_ptr intake_c::parser_c::symbol() {
 
   if (router_location == symbol_router_.end()) {
     auto cell = allocate_cell(symbol_s{symbol_raw});
-    cell->locator = current_location();
+    cell->set_locator(current_location());
 
     next();
 
@@ -535,7 +524,7 @@ cell_ptr intake_c::parser_c::symbol() {
   }
 
   auto cell = allocate_cell(router_location->second);
-  cell->locator = current_location();
+  cell->set_locator(current_location());
 
   next();
 
@@ -575,8 +564,10 @@ cell_ptr intake_c::parser_c::integer() {
     return nullptr;
   }
 
+  // Literal values are immediates, which have no identity to key a
+  // location on. Errors involving them are reported at the call being
+  // run, see interpreter_c::locate
   auto cell = allocate_cell((int64_t)value_actual);
-  cell->locator = current_location();
 
   next();
 
@@ -590,7 +581,6 @@ cell_ptr intake_c::parser_c::boolean() {
   }
 
   auto cell = allocate_cell((int64_t)(current_token() == token_e::TRUE));
-  cell->locator = current_location();
 
   next();
 
@@ -616,7 +606,6 @@ cell_ptr intake_c::parser_c::real() {
   }
 
   auto cell = allocate_cell((double)value_actual);
-  cell->locator = current_location();
 
   next();
 
@@ -629,7 +618,7 @@ cell_ptr intake_c::parser_c::string() {
   }
 
   auto cell = allocate_cell(current_data());
-  cell->locator = current_location();
+  cell->set_locator(current_location());
 
   next();
 
@@ -655,7 +644,6 @@ cell_ptr intake_c::parser_c::cchar() {
   }
 
   auto cell = allocate_cell((char)data_as_char);
-  cell->locator = current_location();
 
   next();
 
@@ -668,7 +656,6 @@ cell_ptr intake_c::parser_c::nil() {
   }
 
   auto cell = allocate_cell(cell_type_e::NIL);
-  cell->locator = current_location();
 
   next();
 
@@ -42,7 +42,7 @@ public:
   //! \param origin Source origin
   //! \param location Location of the line source
   void evaluate(std::string_view line, std::shared_ptr<source_origin_c> origin,
-                locator_ptr location);
+                packed_locator_s location);
 
   //! \brief Indicate the end of a file
   void end_of_file();
@@ -84,7 +84,9 @@ private:
       return (*tokens_)[index_].get_token();
     }
 
-    locator_ptr current_location() { return (*tokens_)[index_].get_locator(); }
+    packed_locator_s current_location() {
+      return (*tokens_)[index_].get_locator();
+    }
     std::string current_data() { return (*tokens_)[index_].get_data(); }
 
   private:
@@ -113,9 +115,9 @@ private:
   };
 
   struct tracker_s {
-    std::stack<locator_ptr> instruction_stack_;
-    std::stack<locator_ptr> data_stack_;
-    std::stack<locator_ptr> access_stack_;
+    std::stack<packed_locator_s> instruction_stack_;
+    std::stack<packed_locator_s> data_stack_;
+    std::stack<packed_locator_s> access_stack_;
     std::size_t line_count{0};
   };
 
@@ -131,7 +133,7 @@ private:
 
   bool process_line(std::string_view line,
                     std::shared_ptr<source_origin_c> origin,
-                    locator_ptr loc_override = nullptr);
+                    packed_locator_s loc_override = {});
 
   void process_token(token_c token);
 };
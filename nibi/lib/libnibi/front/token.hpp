@@ -28,25 +28,26 @@ enum class token_e {
 class token_c {
 public:
   //! \brief Create a token.
-  //! \param locator The locator interface.
+  //! \param locator The location of the token.
   //! \param token The token value.
-  token_c(locator_ptr locator, const token_e token)
+  token_c(const packed_locator_s locator, const token_e token)
       : locator_(locator), token_(token) {}
   //! \brief Create a token.
-  //! \param locator The locator interface.
+  //! \param locator The location of the token.
   //! \param token The token value.
   //! \param data The data associated with the token.
-  token_c(locator_ptr locator, const token_e token, const std::string &data)
+  token_c(const packed_locator_s locator, const token_e token,
+          const std::string &data)
       : locator_(locator), token_(token), data_(data) {}
   //! \brief Get the token value.
   const token_e get_token() const { return token_; }
-  //! \brief Get the locator interface.
-  const locator_ptr get_locator() const { return locator_; }
+  //! \brief Get the location of the token.
+  const packed_locator_s get_locator() const { return locator_; }
   //! \brief Get the data associated with the token.
   const std::string get_data() const { return data_; }
 
 private:
-  locator_ptr locator_{nullptr};
+  packed_locator_s locator_;
   token_e token_{token_e::NIL};
   std::string data_{""};
 };
@@ -0,0 +1,104 @@
+#include "libnibi/heap.hpp"
+#include "libnibi/alloc_profiler.hpp"
+#include "libnibi/cell.hpp"
+#include "libnibi/interpreter/interpreter.hpp"
+
+#include <array>
+#include <string>
+
+namespace nibi {
+namespace heap {
+
+namespace {
+
+// Cell types are sparse, so counts are indexed by the raw value
+static constexpr std::size_t NUM_TYPE_SLOTS = 256;
+
+struct counters_s {
+  stats_s totals;
+  std::size_t limit{0};
+  std::array<type_stats_s, NUM_TYPE_SLOTS> types;
+};
+
+// Plain data so it stays readable while the thread (or the
+// program) is shutting down
+thread_local counters_s counters;
+
+inline type_stats_s &slot(const cell_type_e type) {
+  return counters.types[static_cast<uint8_t>(type)];
+}
+
+[[noreturn]] void throw_over_limit(const std::size_t bytes) {
+  throw interpreter_c::exception_c(
+      "Memory budget exceeded: " + std::to_string(bytes) +
+      " more bytes requested with " +
+      std::to_string(counters.totals.live_bytes) + " of " +
+      std::to_string(counters.limit) + " in use");
+}
+
+inline void check(const std::size_t bytes) {
+  if (counters.limit &&
+      (bytes > counters.limit ||
+       counters.totals.live_bytes > counters.limit - bytes)) {
+    throw_over_limit(bytes);
+  }
+}
+
+inline void grow(const std::size_t bytes) {
+  check(bytes);
+  auto &totals = counters.totals;
+  totals.live_bytes += bytes;
+  if (totals.live_bytes > totals.peak_bytes) {
+    totals.peak_bytes = totals.live_bytes;
+  }
+}
+
+} // namespace
+
+void take_cell(const std::size_t bytes) {
+  grow(bytes);
+  counters.totals.allocations++;
+  if (alloc_profiler::is_enabled()) {
+    alloc_profiler::record(bytes, true);
+  }
+}
+
+void give_cell(const std::size_t bytes) {
+  counters.totals.frees++;
+  counters.totals.live_bytes -= bytes;
+}
+
+void add_cell(const cell_type_e type) { slot(type).live_cells++; }
+
+void remove_cell(const cell_type_e type) { slot(type).live_cells--; }
+
+void retype_cell(const cell_type_e from, const cell_type_e to) {
+  slot(from).live_cells--;
+  slot(to).live_cells++;
+}
+
+void add_payload(const cell_type_e type, const std::size_t bytes) {
+  grow(bytes);
+  slot(type).payload_bytes += bytes;
+  if (alloc_profiler::is_enabled()) {
+    alloc_profiler::record(bytes, false);
+  }
+}
+
+void remove_payload(const cell_type_e type, const std::size_t bytes) {
+  slot(type).payload_bytes -= bytes;
+  counters.totals.live_bytes -= bytes;
+}
+
+void ensure_available(const std::size_t bytes) { check(bytes); }
+
+void set_limit(const std::size_t limit) { counters.limit = limit; }
+
+std::size_t get_limit() { return counters.limit; }
+
+stats_s get_stats() { return counters.totals; }
+
+type_stats_s get_type_stats(const cell_type_e type) { return slot(type); }
+
+} // namespace heap
+} // namespace nibi
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/*
+    Live heap accounting. Every cell is counted against its type from
+    construction to destruction, as are the bytes it owns outside of
+    itself (its payload): heap strings, list element storage, dict
+    tables and the payload records of lists, dicts, functions, aliases
+    and environments. The contents of environments are not counted.
+
+    Counts are kept per thread in plain integers, so keeping them costs
+    an increment or two per cell and can be left on. Like the allocator
+    counts, memory released by a thread other than the one that took it
+    is counted by each, so a thread's live figures are only meaningful
+    while its cells stay on that thread.
+
+    A thread may also be given a limit on its live bytes. Anything
+    counted that would take it over the limit throws before the memory
+    is taken, so a runaway script fails with an error it can catch
+    rather than exhausting the host. Interpreters set the limit while
+    they run, only ever tightening one already set on the thread, see
+    interpreter_c::set_memory_budget.
+*/
+
+namespace nibi {
+
+enum class cell_type_e : uint8_t;
+
+namespace heap {
+
+//! \brief Live counts of a single cell type
+struct type_stats_s {
+  std::size_t live_cells{0};    // Cells of the type that exist
+  std::size_t payload_bytes{0}; // Bytes those cells own outside of
+                                // themselves. Shared payloads are
+                                // counted once
+};
+
+//! \brief Totals across all cell types
+struct stats_s {
+  std::size_t allocations{0}; // Cells created
+  std::size_t frees{0};       // Cells destroyed
+  std::size_t live_bytes{0};  // Bytes held by live cells and payloads
+  std::size_t peak_bytes{0};  // Highest live_bytes has been
+};
+
+//! \brief Count the bytes of a cell about to be allocated
+//! \throws interpreter_c::exception_c if they would pass the limit
+extern void take_cell(const std::size_t bytes);
+
+//! \brief Count the bytes of a cell that was freed
+extern void give_cell(const std::size_t bytes);
+
+//! \brief Count a cell against its type as it is constructed
+extern void add_cell(const cell_type_e type);
+
+//! \brief Stop counting a cell against its type as it is destroyed
+extern void remove_cell(const cell_type_e type);
+
+//! \brief Move a live cell from one type to another
+extern void retype_cell(const cell_type_e from, const cell_type_e to);
+
+//! \brief Count payload bytes about to be taken for a cell of the
+//!        given type
+//! \throws interpreter_c::exception_c if they would pass the limit
+extern void add_payload(const cell_type_e type, const std::size_t bytes);
+
+//! \brief Count payload bytes given back by a cell of the given type
+extern void remove_payload(const cell_type_e type, const std::size_t bytes);
+
+//! \brief Check that `bytes` more could be counted without passing
+//!        the limit, for work that builds its result before it is
+//!        given to a cell
+//! \throws interpreter_c::exception_c if they could not
+extern void ensure_available(const std::size_t bytes);
+
+//! \brief Set the most live bytes the calling thread may hold
+//! \param limit The limit, 0 removes it
+//! \note  Bytes already held are not checked until more are taken
+extern void set_limit(const std::size_t limit);
+
+//! \brief Get the limit of the calling thread, 0 if there is none
+extern std::size_t get_limit();
+
+//! \brief Get the totals of the calling thread
+extern stats_s get_stats();
+
+//! \brief Get the live counts of a type for the calling thread
+extern type_stats_s get_type_stats(const cell_type_e type);
+
+//! \brief Counts the storage of a container as payload of `Type`
+//! \note  Used for the tables of dicts, whose nodes are allocated
+//!        by the standard library
+template <typename T, cell_type_e Type> struct counted_allocator_s {
+  using value_type = T;
+
+  template <typename U> struct rebind {
+    using other = counted_allocator_s<U, Type>;
+  };
+
+  counted_allocator_s() = default;
+  template <typename U>
+  counted_allocator_s(const counted_allocator_s<U, Type> &) {}
+
+  T *allocate(const std::size_t count) {
+    add_payload(Type, count * sizeof(T));
+    return std::allocator<T>().allocate(count);
+  }
+
+  void deallocate(T *ptr, const std::size_t count) {
+    remove_payload(Type, count * sizeof(T));
+    std::allocator<T>().deallocate(ptr, count);
+  }
+
+  template <typename U>
+  bool operator==(const counted_allocator_s<U, Type> &) const {
+    return true;
+  }
+};
+
+//! \brief Counts the heap storage of a small_vector_c as payload
+//!        of `Type`, see small_vector_c
+template <cell_type_e Type> struct counted_storage_s {
+  static void allocated(const std::size_t bytes) { add_payload(Type, bytes); }
+  static void released(const std::size_t bytes) {
+    remove_payload(Type, bytes);
+  }
+};
+
+} // namespace heap
+} // namespace nibi
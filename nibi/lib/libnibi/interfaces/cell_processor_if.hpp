@@ -16,9 +16,49 @@ public:
   //! \param process_data_cell If true, a data list [] will be iterated and each
   //! item processed
   //! \return The result of executing the instruction
-  virtual cell_ptr process_cell(cell_ptr instruction, env_c &env,
+  virtual cell_ptr process_cell(cell_ref_t instruction, env_c &env,
                                 const bool process_data_cell = false) = 0;
 
+  //! \brief Execute a single instruction without taking a reference
+  //!        to the result unless one has to be created
+  //! \param instruction The instruction to execute
+  //! \param env The environment that will be used during execution
+  //! \param storage Holds the result if it had to be computed
+  //! \return The result. Values and symbols are read in place
+  //! \note The result is only valid until the next instruction is
+  //!       executed, as that may change or drop what it refers to
+  virtual cell_ref_t borrow_cell(cell_ref_t instruction, env_c &env,
+                                 cell_ptr &storage) = 0;
+
+  //! \brief Run the body of a lambda
+  //! \param lambda The lambda being called
+  //! \param env The environment holding its arguments
+  //! \return The result of the body
+  //! \note The caller resets any yield afterwards. The body may replace
+  //!       the function it belongs to, so whatever is needed from the
+  //!       lambda has to be held before it runs
+  virtual cell_ptr process_lambda(lambda_info_s &lambda, env_c &env) {
+    cell_ptr body = lambda.body;
+    return process_cell(body, env, true);
+  }
+
+  //! \brief Check if the `if` or `loop` being run has to have an
+  //!        environment of its own, see resolver::needs_scope
+  //! \param list The list of the form, as given to its builtin
+  virtual bool needs_scope(const cell_list_t &list) { return true; }
+
+  //! \brief Limit the memory the program may take, as
+  //!        `meta::memory_budget` does
+  //! \param bytes The bytes that may be held on top of those held
+  //!        now, 0 removes the limit
+  //! \return The bytes that may still be taken, 0 if unlimited
+  //! \note  A limit the host set is only ever tightened, so asking
+  //!        for more, or for none, keeps the host's
+  virtual std::size_t limit_memory(const std::size_t bytes) { return 0; }
+
+  //! \brief Get the bytes the program may still take, 0 if unlimited
+  virtual std::size_t memory_available() { return 0; }
+
   //! \brief Check if the interpreter is yielding a value
   virtual bool is_yielding() = 0;
 
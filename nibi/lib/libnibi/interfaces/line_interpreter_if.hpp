@@ -1,5 +1,8 @@
 #pragma once
 
+#include "libnibi/execution.hpp"
+
+#include <cstddef>
 #include <string>
 
 namespace nibi {
@@ -14,6 +17,21 @@ public:
 
   //! \brief Get the result of the last line interpreted.
   virtual std::string get_result() = 0;
+
+  //! \brief Limit the memory that interpretation may take, past
+  //!        which a catchable error is raised.
+  //! \param bytes The bytes that may be held on top of those held
+  //!        now, 0 removes the limit.
+  virtual void set_memory_budget(std::size_t bytes) = 0;
+
+  //! \brief Limit how deeply function calls may nest, past which a
+  //!        catchable error is raised.
+  //! \param depth The calls that may be running at once, 0 removes
+  //!        the limit.
+  virtual void set_max_call_depth(std::size_t depth) = 0;
+
+  //! \brief Choose how the bodies of lambdas are run.
+  virtual void set_execution_tier(execution_tier_e tier) = 0;
 };
 
 } // namespace nibi
@@ -4,6 +4,7 @@
 #include "interpreter/builtins/builtins.hpp"
 #include "interpreter/interpreter.hpp"
 #include "libnibi/cell.hpp"
+#include "libnibi/heap.hpp"
 #include "libnibi/keywords.hpp"
 #include "macros.hpp"
 
@@ -13,87 +14,118 @@ namespace nibi {
 
 namespace builtins {
 
-#define PERFORM_OPERATION(___op_fn)                                            \
+// The first argument has already been borrowed by the caller, it
+// is converted before the others are evaluated
+#define PERFORM_OPERATION(___op_fn, ___first_arg)                              \
   {                                                                            \
-    auto first_arg = ci.process_cell(list[1], env);                            \
-    if (first_arg->is_integer()) {                                             \
+    if (___first_arg.is_integer()) {                                           \
       return allocate_cell(___op_fn<int64_t>(                                  \
-          first_arg->to_integer(), ci,                                         \
-          [](cell_ptr arg) -> int64_t { return arg->to_integer(); }, list,     \
+          ___first_arg.to_integer(), ci,                                       \
+          [](cell_ref_t arg) -> int64_t { return arg.to_integer(); }, list,    \
           env));                                                               \
-    } else if (first_arg->is_float()) {                                        \
+    } else if (___first_arg.is_float()) {                                      \
       return allocate_cell(___op_fn<double>(                                   \
-          first_arg->to_double(), ci,                                          \
-          [](cell_ptr arg) -> double { return arg->to_double(); }, list,       \
+          ___first_arg.to_double(), ci,                                        \
+          [](cell_ref_t arg) -> double { return arg.to_double(); }, list,      \
           env));                                                               \
     }                                                                          \
     std::string msg = "Incorrect argument type for arithmetic function: ";     \
-    msg += cell_type_to_string(first_arg->type);                               \
-    throw interpreter_c::exception_c(msg, list[0]->locator);                   \
+    msg += cell_type_to_string(___first_arg.type());                           \
+    throw interpreter_c::exception_c(msg, list[0]->locator());                 \
   }
 
 cell_ptr builtin_fn_arithmetic_add(cell_processor_if &ci, cell_list_t &list,
                                    env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::ADD, >=, 2)
 
-  auto first_item = ci.process_cell(list[1], env);
-  if (first_item->type == cell_type_e::STRING) {
-    std::string accumulate{first_item->to_string()};
-    NIBI_LIST_ITER_AND_LOAD_SKIP_N(2, { accumulate += arg->to_string(); })
-    return allocate_cell(accumulate);
+  cell_ptr first_storage;
+  auto &first_item = ci.borrow_cell(list[1], env, first_storage);
+  if (first_item.type() == cell_type_e::STRING) {
+    // The result shares the first string's buffer and is appended to
+    // in place, so building a string up with `+` is not quadratic
+    auto accumulate = first_item->clone(env);
+    NIBI_LIST_ITER_AND_LOAD_SKIP_N(2, {
+      if (arg.type() == cell_type_e::STRING) {
+        accumulate->append_string(arg->as_string_view());
+      } else {
+        accumulate->append_string(arg.to_string());
+      }
+    })
+    return accumulate;
   } else {
-    PERFORM_OPERATION(list_perform_add)
+    PERFORM_OPERATION(list_perform_add, first_item)
   }
 }
 
 cell_ptr builtin_fn_arithmetic_sub(cell_processor_if &ci, cell_list_t &list,
-                                   env_c &env){
-    NIBI_LIST_ENFORCE_SIZE(nibi::kw::SUB, >=, 2)
-        PERFORM_OPERATION(list_perform_sub)}
+                                   env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE(nibi::kw::SUB, >=, 2)
+  cell_ptr first_storage;
+  auto &first_arg = ci.borrow_cell(list[1], env, first_storage);
+  PERFORM_OPERATION(list_perform_sub, first_arg)
+}
 
 cell_ptr builtin_fn_arithmetic_div(cell_processor_if &ci, cell_list_t &list,
-                                   env_c &env){
-    NIBI_LIST_ENFORCE_SIZE(nibi::kw::SUB, >=, 2)
-        PERFORM_OPERATION(list_perform_div)}
+                                   env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE(nibi::kw::SUB, >=, 2)
+  cell_ptr first_storage;
+  auto &first_arg = ci.borrow_cell(list[1], env, first_storage);
+  PERFORM_OPERATION(list_perform_div, first_arg)
+}
 
 cell_ptr builtin_fn_arithmetic_mul(cell_processor_if &ci, cell_list_t &list,
                                    env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::MUL, >=, 2)
 
-  auto first_item = ci.process_cell(list[1], env);
-  if (first_item->type == cell_type_e::STRING) {
-    std::string accumulate{first_item->to_string()};
+  cell_ptr first_storage;
+  auto &first_item = ci.borrow_cell(list[1], env, first_storage);
+  if (first_item.type() == cell_type_e::STRING) {
+    // Taken now, the other arguments may change what is borrowed
+    const std::string repeated{first_item->to_string()};
+    std::string accumulate{repeated};
     NIBI_LIST_ITER_AND_LOAD_SKIP_N(2, {
-      int64_t times = arg->to_integer() - 1;
-      for (int64_t i = 0; i < times; i++)
-        accumulate += first_item->to_string();
+      int64_t times = arg.to_integer() - 1;
+      for (int64_t i = 0; i < times; i++) {
+        // Not counted until it is given to a cell, keep it in budget
+        heap::ensure_available(accumulate.size() + repeated.size());
+        accumulate += repeated;
+      }
     })
     return allocate_cell(accumulate);
   } else {
-    PERFORM_OPERATION(list_perform_mul)
+    PERFORM_OPERATION(list_perform_mul, first_item)
   }
 }
 
 cell_ptr builtin_fn_arithmetic_mod(cell_processor_if &ci, cell_list_t &list,
                                    env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::MOD, >=, 2)
-  auto first_arg = ci.process_cell(list[1], env);
-  if (first_arg->type == cell_type_e::F32 ||
-      first_arg->type == cell_type_e::F64) {
-    double accumulate{first_arg->to_double()};
+  cell_ptr first_storage;
+  auto &first_arg = ci.borrow_cell(list[1], env, first_storage);
+  auto first_type = first_arg.type();
+  if (first_type == cell_type_e::F32 || first_type == cell_type_e::F64) {
+    double accumulate{first_arg.to_double()};
     NIBI_LIST_ITER_AND_LOAD_SKIP_N(
-        2, { accumulate = std::fmod(accumulate, arg->to_double()); })
+        2, { accumulate = std::fmod(accumulate, arg.to_double()); })
+
+    if (first_type == cell_type_e::F64) {
+      return allocate_cell(accumulate);
+    }
 
     // Ensure we keep the same type for the data
-    auto c = allocate_cell(first_arg->type);
+    auto c = allocate_boxed_cell(first_type);
     c->data.f64 = accumulate;
     return c;
   } else {
-    int64_t accumulate{first_arg->to_integer()};
-    NIBI_LIST_ITER_AND_LOAD_SKIP_N(2, { accumulate %= arg->to_integer(); })
+    int64_t accumulate{first_arg.to_integer()};
+    NIBI_LIST_ITER_AND_LOAD_SKIP_N(2, { accumulate %= arg.to_integer(); })
+
+    if (first_type == cell_type_e::I64) {
+      return allocate_cell(accumulate);
+    }
 
     // Ensure we keep the same type for the data
-    auto c = allocate_cell(first_arg->type);
+    auto c = allocate_boxed_cell(first_type);
     c->data.i64 = accumulate;
     return c;
   }
@@ -102,7 +134,9 @@ cell_ptr builtin_fn_arithmetic_mod(cell_processor_if &ci, cell_list_t &list,
 cell_ptr builtin_fn_arithmetic_pow(cell_processor_if &ci, cell_list_t &list,
                                    env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::POW, >=, 2)
-  PERFORM_OPERATION(list_perform_pow)
+  cell_ptr first_storage;
+  auto &first_arg = ci.borrow_cell(list[1], env, first_storage);
+  PERFORM_OPERATION(list_perform_pow, first_arg)
 }
 
 } // namespace builtins
@@ -8,38 +8,38 @@ namespace nibi {
 
 template <typename T>
 static inline T list_perform_add(T base_value, cell_processor_if &ci,
-                                 std::function<T(cell_ptr)> conversion_method,
+                                 T (*conversion_method)(cell_ref_t),
                                  cell_list_t &list, env_c &env) {
   T accumulate{base_value};
   NIBI_LIST_ITER_AND_LOAD_SKIP_N(
-      2, { accumulate += conversion_method(std::move(arg)); })
+      2, { accumulate += conversion_method(arg); })
   return accumulate;
 }
 
 template <typename T>
 static inline T list_perform_sub(T base_value, cell_processor_if &ci,
-                                 std::function<T(cell_ptr)> conversion_method,
+                                 T (*conversion_method)(cell_ref_t),
                                  cell_list_t &list, env_c &env) {
   T accumulate{base_value};
 
   if (list.size() == 2) {
-    return 0 - conversion_method(ci.process_cell(list[1], env));
+    return 0 - base_value;
   }
 
   NIBI_LIST_ITER_AND_LOAD_SKIP_N(
-      2, { accumulate -= conversion_method(std::move(arg)); })
+      2, { accumulate -= conversion_method(arg); })
   return accumulate;
 }
 
 template <typename T>
 static inline T list_perform_div(T base_value, cell_processor_if &ci,
-                                 std::function<T(cell_ptr)> conversion_method,
+                                 T (*conversion_method)(cell_ref_t),
                                  cell_list_t &list, env_c &env) {
   T accumulate{base_value};
   NIBI_LIST_ITER_AND_LOAD_SKIP_N(2, {
-    auto r = conversion_method(std::move(arg));
+    auto r = conversion_method(arg);
     if (r == 0) {
-      throw interpreter_c::exception_c("Division by zero", arg->locator);
+      throw interpreter_c::exception_c("Division by zero", arg->locator());
       return accumulate;
     }
     accumulate /= r;
@@ -49,21 +49,21 @@ static inline T list_perform_div(T base_value, cell_processor_if &ci,
 
 template <typename T>
 static inline T list_perform_mul(T base_value, cell_processor_if &ci,
-                                 std::function<T(cell_ptr)> conversion_method,
+                                 T (*conversion_method)(cell_ref_t),
                                  cell_list_t &list, env_c &env) {
   T accumulate{base_value};
   NIBI_LIST_ITER_AND_LOAD_SKIP_N(
-      2, { accumulate *= conversion_method(std::move(arg)); })
+      2, { accumulate *= conversion_method(arg); })
   return accumulate;
 }
 
 template <typename T>
 static inline T list_perform_pow(T base_value, cell_processor_if &ci,
-                                 std::function<T(cell_ptr)> conversion_method,
+                                 T (*conversion_method)(cell_ref_t),
                                  cell_list_t &list, env_c &env) {
   T accumulate{base_value};
   NIBI_LIST_ITER_AND_LOAD_SKIP_N(2, {
-    accumulate = std::pow(accumulate, conversion_method(std::move(arg)));
+    accumulate = std::pow(accumulate, conversion_method(arg));
   })
   return accumulate;
 }
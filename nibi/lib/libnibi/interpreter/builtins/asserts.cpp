@@ -15,15 +15,16 @@ cell_ptr builtin_fn_assert_true(cell_processor_if &ci, cell_list_t &list,
 
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::ASSERT, >=, 2)
 
-  auto value = ci.process_cell(list[1], env);
+  cell_ptr value_storage;
+  auto &value = ci.borrow_cell(list[1], env, value_storage);
   if (!value->is_integer()) {
     throw interpreter_c::exception_c(
-        "Expected item to evaluate to integer type", list[1]->locator);
+        "Expected item to evaluate to integer type", list[1]->locator());
   }
 
   if (list.size() == 2) {
     if (value->as_integer() == 0) {
-      throw interpreter_c::exception_c("Assertion failed", list[0]->locator);
+      throw interpreter_c::exception_c("Assertion failed", list[0]->locator());
     }
     return allocate_cell(cell_type_e::NIL);
   }
@@ -31,12 +32,13 @@ cell_ptr builtin_fn_assert_true(cell_processor_if &ci, cell_list_t &list,
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::ASSERT, ==, 3)
 
   if (value->as_integer() == 0) {
-    auto message = ci.process_cell(list[2], env);
+    cell_ptr message_storage;
+    auto &message = ci.borrow_cell(list[2], env, message_storage);
     if (message->type != cell_type_e::STRING) {
       throw interpreter_c::exception_c(
-          "Expected string value for assertion message", message->locator);
+          "Expected string value for assertion message", message->locator());
     }
-    throw interpreter_c::exception_c(message->as_string(), list[0]->locator);
+    throw interpreter_c::exception_c(message->as_string(), list[0]->locator());
   }
 
   return allocate_cell(cell_type_e::NIL);
@@ -13,47 +13,53 @@ namespace builtins {
 cell_ptr builtin_fn_bitwise_lsh(cell_processor_if &ci, cell_list_t &list,
                                 env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::BW_LSH, ==, 3)
-  auto lhs = ci.process_cell(list[1], env)->to_integer();
-  auto rhs = ci.process_cell(list[2], env)->to_integer();
+  cell_ptr held;
+  auto lhs = ci.borrow_cell(list[1], env, held).to_integer();
+  auto rhs = ci.borrow_cell(list[2], env, held).to_integer();
   return allocate_cell((int64_t)(lhs << rhs));
 }
 
 cell_ptr builtin_fn_bitwise_rsh(cell_processor_if &ci, cell_list_t &list,
                                 env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::BW_RSH, ==, 3)
-  auto lhs = ci.process_cell(list[1], env)->to_integer();
-  auto rhs = ci.process_cell(list[2], env)->to_integer();
+  cell_ptr held;
+  auto lhs = ci.borrow_cell(list[1], env, held).to_integer();
+  auto rhs = ci.borrow_cell(list[2], env, held).to_integer();
   return allocate_cell((int64_t)(lhs >> rhs));
 }
 
 cell_ptr builtin_fn_bitwise_and(cell_processor_if &ci, cell_list_t &list,
                                 env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::BW_AND, ==, 3)
-  auto lhs = ci.process_cell(list[1], env)->to_integer();
-  auto rhs = ci.process_cell(list[2], env)->to_integer();
+  cell_ptr held;
+  auto lhs = ci.borrow_cell(list[1], env, held).to_integer();
+  auto rhs = ci.borrow_cell(list[2], env, held).to_integer();
   return allocate_cell((int64_t)(lhs & rhs));
 }
 
 cell_ptr builtin_fn_bitwise_or(cell_processor_if &ci, cell_list_t &list,
                                env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::BW_OR, ==, 3)
-  auto lhs = ci.process_cell(list[1], env)->to_integer();
-  auto rhs = ci.process_cell(list[2], env)->to_integer();
+  cell_ptr held;
+  auto lhs = ci.borrow_cell(list[1], env, held).to_integer();
+  auto rhs = ci.borrow_cell(list[2], env, held).to_integer();
   return allocate_cell((int64_t)(lhs | rhs));
 }
 
 cell_ptr builtin_fn_bitwise_xor(cell_processor_if &ci, cell_list_t &list,
                                 env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::BW_XOR, ==, 3)
-  auto lhs = ci.process_cell(list[1], env)->to_integer();
-  auto rhs = ci.process_cell(list[2], env)->to_integer();
+  cell_ptr held;
+  auto lhs = ci.borrow_cell(list[1], env, held).to_integer();
+  auto rhs = ci.borrow_cell(list[2], env, held).to_integer();
   return allocate_cell((int64_t)(lhs ^ rhs));
 }
 
 cell_ptr builtin_fn_bitwise_not(cell_processor_if &ci, cell_list_t &list,
                                 env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::BW_NOT, ==, 2)
-  auto lhs = ci.process_cell(list[1], env)->to_integer();
+  cell_ptr held;
+  auto lhs = ci.borrow_cell(list[1], env, held).to_integer();
   return allocate_cell((int64_t)(~lhs));
 }
 
@@ -150,6 +150,9 @@ static function_info_s builtin_common_if_inf = {
 static function_info_s builtin_common_clone_inf = {
     nibi::kw::CLONE, builtin_fn_common_clone,
     function_type_e::BUILTIN_CPP_FUNCTION};
+static function_info_s builtin_common_freeze_inf = {
+    nibi::kw::FREEZE, builtin_fn_common_freeze,
+    function_type_e::BUILTIN_CPP_FUNCTION};
 static function_info_s builtin_common_import_inf = {
     nibi::kw::IMPORT, builtin_fn_common_import,
     function_type_e::BUILTIN_CPP_FUNCTION};
@@ -298,6 +301,7 @@ static function_router_t keyword_map = {
     {nibi::kw::LOOP, builtin_common_loop_inf},
     {nibi::kw::IF, builtin_common_if_inf},
     {nibi::kw::CLONE, builtin_common_clone_inf},
+    {nibi::kw::FREEZE, builtin_common_freeze_inf},
     {nibi::kw::IMPORT, builtin_common_import_inf},
     {nibi::kw::USE, builtin_common_use_inf},
     {nibi::kw::EXIT, builtin_common_exit_inf},
@@ -23,6 +23,21 @@ function_router_t &get_builtin_symbols_map();
 extern cell_ptr execute_suspected_lambda(cell_processor_if &ci,
                                          cell_list_t &list, env_c &env);
 
+//! \brief Evaluate the arguments a lambda is called with, checking
+//!        that there are as many as it takes
+//! \param list The list containing the lambda function and args
+//! \param env The environment the arguments are evaluated in
+//! \param arguments The list the evaluated arguments are added to
+extern void evaluate_lambda_arguments(cell_processor_if &ci,
+                                      const lambda_info_s &lambda,
+                                      cell_list_t &list, env_c &env,
+                                      cell_list_t &arguments);
+
+//! \brief Bind evaluated arguments in the environment of a lambda call,
+//!        moving them out of the list
+extern void bind_lambda_arguments(const lambda_info_s &lambda,
+                                  cell_list_t &arguments, env_c &lambda_env);
+
 // Environment modification functions
 
 extern cell_ptr builtin_fn_env_alias(cell_processor_if &ci, cell_list_t &list,
@@ -68,6 +83,8 @@ extern cell_ptr builtin_fn_list_pop_back(cell_processor_if &ci,
 
 extern cell_ptr builtin_fn_common_clone(cell_processor_if &ci,
                                         cell_list_t &list, env_c &env);
+extern cell_ptr builtin_fn_common_freeze(cell_processor_if &ci,
+                                         cell_list_t &list, env_c &env);
 extern cell_ptr builtin_fn_common_len(cell_processor_if &ci, cell_list_t &list,
                                       env_c &env);
 extern cell_ptr builtin_fn_common_yield(cell_processor_if &ci,
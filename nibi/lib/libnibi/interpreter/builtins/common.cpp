@@ -1,12 +1,15 @@
 
 #include "interpreter/builtins/builtins.hpp"
 #include "interpreter/interpreter.hpp"
+#include "interpreter/resolver.hpp"
 #include "libnibi/cell.hpp"
 #include "libnibi/front/file_interpreter.hpp"
 #include "libnibi/keywords.hpp"
 #include "macros.hpp"
 #include "platform.hpp"
 
+#include <optional>
+
 namespace nibi {
 namespace builtins {
 
@@ -18,22 +21,32 @@ cell_ptr builtin_fn_common_clone(cell_processor_if &ci, cell_list_t &list,
   auto it = list.begin();
   std::advance(it, 1);
 
-  auto loaded_cell = ci.process_cell(*it, env);
+  cell_ptr held;
+  return ci.borrow_cell(*it, env, held).clone(env);
+}
+
+cell_ptr builtin_fn_common_freeze(cell_processor_if &ci, cell_list_t &list,
+                                  env_c &env) {
+
+  NIBI_LIST_ENFORCE_SIZE(nibi::kw::FREEZE, ==, 2)
 
-  return loaded_cell->clone(env);
+  // Borrowed so that a variable is frozen where it is stored
+  cell_ptr held;
+  return ci.borrow_cell(list[1], env, held).freeze();
 }
 
 cell_ptr builtin_fn_common_len(cell_processor_if &ci, cell_list_t &list,
                                env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::LEN, ==, 2)
 
-  auto target_list = ci.process_cell(list[1], env);
+  cell_ptr held;
+  auto &target_list = ci.borrow_cell(list[1], env, held);
 
   if (target_list->type != cell_type_e::LIST) {
     return allocate_cell((int64_t)(target_list->to_string(false, true).size()));
   }
 
-  auto &list_info = target_list->as_list_info();
+  auto &list_info = target_list->read_list_info();
   return allocate_cell((int64_t)list_info.list.size());
 }
 
@@ -42,8 +55,8 @@ cell_ptr builtin_fn_common_exchange(cell_processor_if &ci, cell_list_t &list,
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::EXCHANGE, ==, 3)
   auto target = ci.process_cell(list[1], env);
   auto source = ci.process_cell(list[2], env);
-  auto result = target->clone(env);
-  target->update_from(*source, env);
+  auto result = target.clone(env);
+  target.box()->update_from(source, env);
   return result;
 }
 
@@ -57,7 +70,8 @@ cell_ptr builtin_fn_common_yield(cell_processor_if &ci, cell_list_t &list,
 
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::YIELD, ==, 2)
 
-  auto target = ci.process_cell(list[1], env)->clone(env);
+  cell_ptr held;
+  auto target = ci.borrow_cell(list[1], env, held).clone(env);
   ci.set_yield_value(target);
   return target;
 }
@@ -70,26 +84,27 @@ cell_ptr builtin_fn_common_loop(cell_processor_if &ci, cell_list_t &list,
   auto it = list.begin();
   std::advance(it, 1);
 
-  auto pre_condition = (*it);
+  auto &pre_condition = (*it);
   std::advance(it, 1);
 
-  auto condition = (*it);
+  auto &condition = (*it);
   std::advance(it, 1);
 
-  auto post_condition = (*it);
+  auto &post_condition = (*it);
   std::advance(it, 1);
 
-  auto body = (*it);
+  auto &body = (*it);
 
-  auto loop_env = env_c(&env);
+  // One environment is kept for every iteration, if the loop needs one
+  std::optional<env_c> scope;
+  auto &loop_env = ci.needs_scope(list) ? scope.emplace(&env) : env;
 
   ci.process_cell(pre_condition, loop_env);
 
   cell_ptr result = allocate_cell(cell_type_e::NIL);
+  cell_ptr held;
   while (true) {
-    auto condition_result = ci.process_cell(condition, loop_env);
-
-    if (condition_result->to_integer() <= 0) {
+    if (ci.borrow_cell(condition, loop_env, held).to_integer() <= 0) {
       return result;
     }
 
@@ -112,16 +127,18 @@ cell_ptr builtin_fn_common_if(cell_processor_if &ci, cell_list_t &list,
   auto it = list.begin();
   std::advance(it, 1);
 
-  auto condition = (*it);
+  auto &condition = (*it);
   std::advance(it, 1);
 
-  auto true_condition = (*it);
+  auto &true_condition = (*it);
 
-  auto if_env = env_c(&env);
+  // What the branches bind is dropped with the `if`, which only needs
+  // an environment of its own if they can bind anything
+  std::optional<env_c> scope;
+  auto &if_env = ci.needs_scope(list) ? scope.emplace(&env) : env;
 
-  auto condition_result = ci.process_cell(condition, if_env);
-
-  if (condition_result->as_integer() > 0) {
+  cell_ptr held;
+  if (ci.borrow_cell(condition, if_env, held).as_integer() > 0) {
     return ci.process_cell(true_condition, if_env, true);
   }
 
@@ -153,7 +170,7 @@ cell_ptr builtin_fn_common_import(cell_processor_if &ci, cell_list_t &list,
     // the file can be searched relative to the location of the file being
     // executed at the moment
     auto from =
-        std::filesystem::path((*list.begin())->locator->get_source_name());
+        std::filesystem::path((*list.begin())->locator()->get_source_name());
 
     // Retrieve the file name to import
     auto target = std::filesystem::path((*it)->as_string());
@@ -164,7 +181,7 @@ cell_ptr builtin_fn_common_import(cell_processor_if &ci, cell_list_t &list,
     if (!item.has_value()) {
       throw interpreter_c::exception_c("Could not locate file for import: " +
                                            target.string(),
-                                       (*it)->locator);
+                                       (*it)->locator());
     }
 
     // Check that the item hasn't already been imported
@@ -197,7 +214,8 @@ cell_ptr builtin_fn_common_exit(cell_processor_if &ci, cell_list_t &list,
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::EXIT, ==, 2)
   auto it = list.begin();
   std::advance(it, 1);
-  std::exit(ci.process_cell((*it), env)->as_integer());
+  cell_ptr held;
+  std::exit(ci.borrow_cell((*it), env, held).as_integer());
 }
 
 cell_ptr builtin_fn_common_quote(cell_processor_if &ci, cell_list_t &list,
@@ -216,10 +234,13 @@ cell_ptr builtin_fn_common_eval(cell_processor_if &ci, cell_list_t &list,
 
   auto sm = ci.get_source_manager();
 
-  auto so = sm.get_source(list[0]->locator->get_source_name());
+  auto so = sm.get_source(list[0]->locator()->get_source_name());
 
   interpreter_c eval_ci(env, sm);
 
+  cell_ptr held;
+  auto &source = ci.borrow_cell((*it), env, held);
+
   intake_c(
       eval_ci,
       [&](error_c error) {
@@ -227,7 +248,7 @@ cell_ptr builtin_fn_common_eval(cell_processor_if &ci, cell_list_t &list,
         throw interpreter_c::exception_c("Eval error");
       },
       sm, builtins::get_builtin_symbols_map())
-      .evaluate(ci.process_cell((*it), env)->as_string(), so, list[0]->locator);
+      .evaluate(source->as_string(), so, list[0]->packed_locator());
 
   return eval_ci.get_last_result();
 }
@@ -239,7 +260,7 @@ cell_ptr builtin_fn_common_nop(cell_processor_if &ci, cell_list_t &list,
 
 cell_ptr assemble_macro(cell_processor_if &ci, cell_list_t &list, env_c &env) {
 
-  auto definition = env.get(list[0]->as_symbol());
+  auto definition = env.get(list[0]->as_symbol_id());
   auto macro_env = definition->as_function_info().operating_env;
   auto macro_params = macro_env->get("$params")->as_list_info();
   auto macro_body = macro_env->get("$body")->as_string();
@@ -249,7 +270,7 @@ cell_ptr assemble_macro(cell_processor_if &ci, cell_list_t &list, env_c &env) {
         std::string("Macro `") + list[0]->as_symbol() + "` expected " +
             std::to_string(macro_params.list.size()) + " parameters, but " +
             std::to_string(list.size() - 1) + " were given",
-        list[0]->locator);
+        list[0]->locator());
   }
 
   for (std::size_t i = 0; i < macro_params.list.size(); i++) {
@@ -303,7 +324,8 @@ cell_ptr builtin_fn_common_macro(cell_processor_if &ci, cell_list_t &list,
 
   auto macro_name = list[1]->as_symbol();
 
-  NIBI_VALIDATE_VAR_NAME(macro_name, list[1]->locator);
+  NIBI_VALIDATE_VAR_NAME(macro_name, list[1]->locator());
+  resolver::note_macro(list[1]->as_symbol_id());
 
   // Expect param list even it its empty
 
@@ -312,7 +334,7 @@ cell_ptr builtin_fn_common_macro(cell_processor_if &ci, cell_list_t &list,
   if (params.type != list_types_e::DATA) {
     throw interpreter_c::exception_c(
         "Macro parameters are expected to be a data list '[]'",
-        list[2]->locator);
+        list[2]->locator());
   }
 
   function_info_s macro_assembler_fn("assemble_macro", assemble_macro,
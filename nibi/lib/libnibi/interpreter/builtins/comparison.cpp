@@ -12,45 +12,34 @@ namespace nibi {
 #define PERFORM_OP_ALLOW_STRING(___op)                                         \
   {                                                                            \
     if (lhs.is_integer()) {                                                    \
-      auto r =                                                                 \
-          allocate_cell((int64_t)(lhs.as_integer() ___op rhs.to_integer()));   \
-      r->locator = locator;                                                    \
-      return std::move(r);                                                     \
+      return allocate_cell(                                                    \
+          (int64_t)(lhs.as_integer() ___op rhs.to_integer()));                 \
     } else if (lhs.is_float()) {                                               \
-      auto r =                                                                 \
-          allocate_cell((int64_t)(lhs.as_double() ___op rhs.to_double()));     \
-      r->locator = locator;                                                    \
-      return std::move(r);                                                     \
-    } else if (lhs.type == cell_type_e::STRING) {                              \
-      auto r =                                                                 \
-          allocate_cell((int64_t)(lhs.as_string() ___op rhs.to_string()));     \
-      r->locator = locator;                                                    \
-      return std::move(r);                                                     \
+      return allocate_cell((int64_t)(lhs.as_double() ___op rhs.to_double()));  \
+    } else if (lhs.type() == cell_type_e::STRING) {                            \
+      if (rhs.type() == cell_type_e::STRING) {                                 \
+        return allocate_cell(                                                  \
+            (int64_t)(lhs->as_string_view() ___op rhs->as_string_view()));     \
+      }                                                                        \
+      return allocate_cell(                                                    \
+          (int64_t)(lhs->as_string_view() ___op rhs.to_string()));             \
     } else {                                                                   \
-      auto r =                                                                 \
-          allocate_cell((int64_t)(lhs.to_string() ___op rhs.to_string()));     \
-      r->locator = locator;                                                    \
-      return std::move(r);                                                     \
+      return allocate_cell((int64_t)(lhs.to_string() ___op rhs.to_string()));  \
     }                                                                          \
   }
 
 #define PERFORM_OP_NO_STRING(___op)                                            \
   {                                                                            \
     if (lhs.is_integer()) {                                                    \
-      auto r =                                                                 \
-          allocate_cell((int64_t)(lhs.as_integer() ___op rhs.to_integer()));   \
-      r->locator = locator;                                                    \
-      return std::move(r);                                                     \
+      return allocate_cell(                                                    \
+          (int64_t)(lhs.as_integer() ___op rhs.to_integer()));                 \
     } else if (lhs.is_float()) {                                               \
-      auto r =                                                                 \
-          allocate_cell((int64_t)(lhs.as_double() ___op rhs.to_double()));     \
-      r->locator = locator;                                                    \
-      return std::move(r);                                                     \
+      return allocate_cell((int64_t)(lhs.as_double() ___op rhs.to_double()));  \
     } else {                                                                   \
       throw interpreter_c::exception_c(                                        \
           "Expected numeric value, got " +                                     \
-              std::string(cell_type_to_string(lhs.type)),                      \
-          lhs.locator);                                                        \
+              std::string(cell_type_to_string(lhs.type())),                    \
+          lhs->locator());                                                     \
     }                                                                          \
   }
 
@@ -68,24 +57,23 @@ enum class op_e {
   OR,
 };
 
-cell_ptr perform_op(locator_ptr locator, op_e op, cell_c &lhs, cell_c &rhs,
+cell_ptr perform_op(op_e op, const cell_ptr &lhs, const cell_ptr &rhs,
                     bool enforce_numeric = true) {
   if (enforce_numeric) {
     if (!lhs.is_numeric()) {
       throw interpreter_c::exception_c(
           "Expected numeric value, got " +
-              std::string(cell_type_to_string(lhs.type)),
-          lhs.locator);
+              std::string(cell_type_to_string(lhs.type())),
+          lhs->locator());
     }
     if (!rhs.is_numeric()) {
       throw interpreter_c::exception_c(
           "Expected numeric value, got " +
-              std::string(cell_type_to_string(rhs.type)),
-          rhs.locator);
+              std::string(cell_type_to_string(rhs.type())),
+          rhs->locator());
     }
   }
 
-  cell_type_e target_type = lhs.type;
   switch (op) {
   case op_e::EQ:
     PERFORM_OP_ALLOW_STRING(==)
@@ -105,65 +93,67 @@ cell_ptr perform_op(locator_ptr locator, op_e op, cell_c &lhs, cell_c &rhs,
     PERFORM_OP_NO_STRING(||)
   }
 
-  throw interpreter_c::exception_c("Unknown comparison operator", lhs.locator);
+  throw interpreter_c::exception_c("Unknown comparison operator",
+                                   lhs->locator());
+}
+
+cell_ptr compare(op_e op, cell_processor_if &ci, cell_list_t &list,
+                 env_c &env, bool enforce_numeric = true) {
+  cell_ptr lhs_storage;
+  cell_ptr rhs_storage;
+
+  // Both sides are borrowed, but if the right hand side has to run
+  // it may change what the left refers to, so the left is kept
+  const cell_ptr *lhs = &ci.borrow_cell(list[1], env, lhs_storage);
+  if (lhs != &lhs_storage && list[2].type() == cell_type_e::LIST) {
+    lhs_storage = *lhs;
+    lhs = &lhs_storage;
+  }
+
+  auto &rhs = ci.borrow_cell(list[2], env, rhs_storage);
+  return perform_op(op, *lhs, rhs, enforce_numeric);
 }
 } // namespace
 
 cell_ptr builtin_fn_comparison_eq(cell_processor_if &ci, cell_list_t &list,
                                   env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::EQ, ==, 3)
-  return std::move(perform_op(list.front()->locator, op_e::EQ,
-                              *ci.process_cell(list[1], env),
-                              *ci.process_cell(list[2], env), false));
+  return compare(op_e::EQ, ci, list, env, false);
 }
 cell_ptr builtin_fn_comparison_neq(cell_processor_if &ci, cell_list_t &list,
                                    env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::NEQ, ==, 3)
-  return std::move(perform_op(list.front()->locator, op_e::NEQ,
-                              *ci.process_cell(list[1], env),
-                              *ci.process_cell(list[2], env), false));
+  return compare(op_e::NEQ, ci, list, env, false);
 }
 cell_ptr builtin_fn_comparison_lt(cell_processor_if &ci, cell_list_t &list,
                                   env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::LT, ==, 3)
-  return std::move(perform_op(list.front()->locator, op_e::LT,
-                              *ci.process_cell(list[1], env),
-                              *ci.process_cell(list[2], env)));
+  return compare(op_e::LT, ci, list, env);
 }
 cell_ptr builtin_fn_comparison_gt(cell_processor_if &ci, cell_list_t &list,
                                   env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::GT, ==, 3)
-  return std::move(perform_op(list.front()->locator, op_e::GT,
-                              *ci.process_cell(list[1], env),
-                              *ci.process_cell(list[2], env)));
+  return compare(op_e::GT, ci, list, env);
 }
 cell_ptr builtin_fn_comparison_lte(cell_processor_if &ci, cell_list_t &list,
                                    env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::LTE, ==, 3)
-  return std::move(perform_op(list.front()->locator, op_e::LTE,
-                              *ci.process_cell(list[1], env),
-                              *ci.process_cell(list[2], env)));
+  return compare(op_e::LTE, ci, list, env);
 }
 cell_ptr builtin_fn_comparison_gte(cell_processor_if &ci, cell_list_t &list,
                                    env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::GTE, ==, 3)
-  return std::move(perform_op(list.front()->locator, op_e::GTE,
-                              *ci.process_cell(list[1], env),
-                              *ci.process_cell(list[2], env)));
+  return compare(op_e::GTE, ci, list, env);
 }
 cell_ptr builtin_fn_comparison_and(cell_processor_if &ci, cell_list_t &list,
                                    env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::AND, ==, 3)
-  return std::move(perform_op(list.front()->locator, op_e::AND,
-                              *ci.process_cell(list[1], env),
-                              *ci.process_cell(list[2], env)));
+  return compare(op_e::AND, ci, list, env);
 }
 cell_ptr builtin_fn_comparison_or(cell_processor_if &ci, cell_list_t &list,
                                   env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::OR, ==, 3)
-  return std::move(perform_op(list.front()->locator, op_e::OR,
-                              *ci.process_cell(list[1], env),
-                              *ci.process_cell(list[2], env)));
+  return compare(op_e::OR, ci, list, env);
 }
 
 cell_ptr builtin_fn_comparison_not(cell_processor_if &ci, cell_list_t &list,
@@ -172,10 +162,8 @@ cell_ptr builtin_fn_comparison_not(cell_processor_if &ci, cell_list_t &list,
   auto it = list.begin();
   std::advance(it, 1);
   auto item_to_negate = ci.process_cell(*it, env, true);
-  auto value = item_to_negate->to_integer();
-  auto result = allocate_cell((int64_t)(!value));
-  result->locator = list[0]->locator;
-  return std::move(result);
+  auto value = item_to_negate.to_integer();
+  return allocate_cell((int64_t)(!value));
 }
 
 } // namespace builtins
@@ -13,41 +13,49 @@ namespace nibi {
 namespace builtins {
 
 #define NIBI_CONVERSION_TO_TYPE(type, conversion_method)                       \
-  auto value = ci.process_cell(list[1], env);                                  \
+  cell_ptr value_storage;                                                      \
+  auto &value = ci.borrow_cell(list[1], env, value_storage);                   \
+  auto text = value->to_string();                                              \
   try {                                                                        \
-    type result = conversion_method(value->to_string());                       \
+    type result = conversion_method(text);                                     \
     return allocate_cell((type)result);                                        \
   } catch (std::invalid_argument & e) {                                        \
     throw interpreter_c::exception_c(                                          \
-        std::string("Invalid argument for conversion: ") + value->to_string(), \
-        value->locator);                                                       \
+        std::string("Invalid argument for conversion: ") + text,               \
+        value->locator());                                                     \
   } catch (std::out_of_range & e) {                                            \
     throw interpreter_c::exception_c(                                          \
-        std::string("Out of range argument for conversion: ") +                \
-            value->to_string(),                                                \
-        value->locator);                                                       \
+        std::string("Out of range argument for conversion: ") + text,          \
+        value->locator());                                                     \
   } catch (...) {                                                              \
     throw interpreter_c::exception_c(                                          \
-        std::string("Unknown error in conversion: ") + value->to_string(),     \
-        value->locator);                                                       \
+        std::string("Unknown error in conversion: ") + text,                   \
+        value->locator());                                                     \
   }                                                                            \
   return allocate_cell((type)0);
 
 cell_ptr builtin_fn_cvt_to_string(cell_processor_if &ci, cell_list_t &list,
                                   env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::STR, ==, 2)
-  return allocate_cell(ci.process_cell(list[1], env)->to_string());
+  cell_ptr held;
+  return allocate_cell(ci.borrow_cell(list[1], env, held)->to_string());
 }
 
 cell_ptr builtin_fn_cvt_to_string_lit(cell_processor_if &ci, cell_list_t &list,
                                       env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::STR_LIT, ==, 2)
 
-  auto linf = ci.process_cell(list[1], env)->as_list_info();
+  cell_ptr held;
+  auto &target = ci.borrow_cell(list[1], env, held);
+  auto &linf = target->read_list_info();
 
   std::string str;
-  for (auto i : linf.list) {
-    str += i->to_string(false, true);
+  for (auto &i : linf.list) {
+    if (i.type() == cell_type_e::STRING || i.type() == cell_type_e::SYMBOL) {
+      str += i->as_string_view();
+      continue;
+    }
+    str += i.to_string(false, true);
   }
   return allocate_cell(str);
 }
@@ -116,24 +124,20 @@ cell_ptr builtin_fn_cvt_to_char(cell_processor_if &ci, cell_list_t &list,
                                 env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::CHAR, ==, 2)
 
-  auto value = ci.process_cell(list[1], env);
-
-  auto result = allocate_cell('\0');
+  cell_ptr held;
+  auto &value = ci.borrow_cell(list[1], env, held);
 
-  if (value->is_integer()) {
-    auto i = value->to_integer();
-    result->data.ch = static_cast<char>(i);
-    result->locator = list[0]->locator;
-    return result;
+  if (value.is_integer()) {
+    return allocate_cell(static_cast<char>(value.to_integer()));
   }
 
-  if (value->type != cell_type_e::STRING) {
+  if (value.type() != cell_type_e::STRING) {
     throw interpreter_c::exception_c(
         "Can not convert non-integer and non-string cell to char",
-        list[0]->locator);
+        list[0]->locator());
   }
 
-  auto str = value->to_string();
+  auto str = value->as_string_view();
   if (str.empty()) {
     return allocate_cell('\0');
   }
@@ -146,7 +150,7 @@ cell_ptr builtin_fn_cvt_to_char(cell_processor_if &ci, cell_list_t &list,
 
   if (str.size() > 1) {
     throw interpreter_c::exception_c(
-        "String too large to convert into a single char", list[1]->locator);
+        "String too large to convert into a single char", list[1]->locator());
   }
 
   return allocate_cell(str[0]);
@@ -189,8 +193,18 @@ cell_ptr builtin_fn_cvt_to_split(cell_processor_if &ci, cell_list_t &list,
   }
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::SPLIT, ==, 2)
 
-  auto as_string = value->to_string();
+  // Strings are split in place, anything else by its string form
+  std::string converted;
+  std::string_view as_string;
+  if (value.type() == cell_type_e::STRING) {
+    as_string = value->as_string_view();
+  } else {
+    converted = value.to_string();
+    as_string = converted;
+  }
+
   cell_list_t data_list;
+  data_list.reserve(as_string.size());
 
   for (auto ch : as_string) {
     data_list.push_back(allocate_cell(std::string(1, ch)));
@@ -2,6 +2,7 @@
 
 #include "interpreter/builtins/builtins.hpp"
 #include "interpreter/interpreter.hpp"
+#include "interpreter/resolver.hpp"
 #include "libnibi/cell.hpp"
 #include "libnibi/keywords.hpp"
 #include "macros.hpp"
@@ -16,21 +17,20 @@ cell_ptr builtin_fn_env_alias(cell_processor_if &ci, cell_list_t &list,
 
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::ALIAS, ==, 3)
 
-  auto alias_target = ci.process_cell(list[1], env);
+  auto alias_target = ci.process_cell(list[1], env).box();
   auto target_variable_name = list[2]->as_c_string();
 
-  NIBI_VALIDATE_VAR_NAME(target_variable_name, list[2]->locator);
+  NIBI_VALIDATE_VAR_NAME(target_variable_name, list[2]->locator());
 
   if (list[1]->type == cell_type_e::SYMBOL) {
-    auto source_variable_name = list[1]->as_c_string();
-    if (::strcmp(source_variable_name, target_variable_name) == 0) {
+    if (list[1]->as_string_view() == target_variable_name) {
       throw interpreter_c::exception_c("Cannot alias a variable to itself",
-                                       list[1]->locator);
+                                       list[1]->locator());
     }
   }
 
   auto cell = allocate_cell(alias_s{alias_target});
-  cell->locator = alias_target->locator;
+  cell->set_locator(alias_target->packed_locator());
 
   env.set(target_variable_name, cell);
 
@@ -42,23 +42,21 @@ cell_ptr builtin_fn_env_str_set_at(cell_processor_if &ci, cell_list_t &list,
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::STR_SET_AT, ==, 4)
 
   auto target_cell = ci.process_cell(list[1], env);
-  auto target = target_cell->as_string();
+  auto target = target_cell->as_string_view();
 
-  auto index = ci.process_cell(list[2], env)->as_integer();
-  auto value = ci.process_cell(list[3], env)->to_string();
+  cell_ptr held;
+  auto index = ci.borrow_cell(list[2], env, held).as_integer();
+  auto value = ci.borrow_cell(list[3], env, held)->to_string();
 
   while (index < 0) {
     index = target.size() + index;
   }
 
   if (index >= target.size()) {
-    throw interpreter_c::exception_c("Index out of bounds", list[2]->locator);
+    throw interpreter_c::exception_c("Index out of bounds", list[2]->locator());
   }
 
-  std::string result =
-      target.substr(0, index) + value + target.substr(index + 1);
-
-  target_cell->update_from(*allocate_cell(result), env);
+  target_cell->replace_string_at(index, value);
 
   return target_cell;
 }
@@ -73,22 +71,21 @@ cell_ptr builtin_fn_env_assignment(cell_processor_if &ci, cell_list_t &list,
 
   if ((*it)->type != cell_type_e::SYMBOL) {
     throw interpreter_c::exception_c(
-        "Expected symbol as first argument to assign", (*it)->locator);
+        "Expected symbol as first argument to assign", (*it)->locator());
   }
 
   auto target_variable_name = (*it)->as_c_string();
 
-  NIBI_VALIDATE_VAR_NAME(target_variable_name, (*it)->locator);
-
-  auto target_assignment_value = ci.process_cell(list[2], env);
-  // ci.process_cell(ci.process_cell(list[2], env), env);
+  NIBI_VALIDATE_VAR_NAME(target_variable_name, (*it)->locator());
 
   // Explicitly clone the value as we might be reading from
   // an instruction that will be mutated later
 
-  target_assignment_value = target_assignment_value->clone(env);
+  cell_ptr held;
+  auto target_assignment_value =
+      ci.borrow_cell(list[2], env, held).clone(env);
 
-  env.set(target_variable_name, target_assignment_value);
+  env.set((*it)->as_symbol_id(), target_assignment_value);
 
   // Return a pointer to the new cell so assignments can be chained
   return target_assignment_value;
@@ -102,11 +99,15 @@ cell_ptr builtin_fn_env_set(cell_processor_if &ci, cell_list_t &list,
   auto target_assignment_cell = ci.process_cell(list[1], env);
   // ci.process_cell(ci.process_cell(list[1], env), env);
 
-  auto target_assignment_value = ci.process_cell(list[2], env);
-  // ci.process_cell(ci.process_cell(list[2], env), env);
+  // Anything looked up by name is already its own cell, but a
+  // temporary may be a shared one that has to be copied first
+  target_assignment_cell.box();
+
+  cell_ptr held;
+  auto &target_assignment_value = ci.borrow_cell(list[2], env, held);
 
   // Then update that cell directly
-  target_assignment_cell->update_from(*target_assignment_value, env);
+  target_assignment_cell->update_from(target_assignment_value, env);
 
   return target_assignment_cell;
 }
@@ -116,10 +117,10 @@ cell_ptr builtin_fn_env_drop(cell_processor_if &ci, cell_list_t &list,
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::DROP, >=, 2)
 
   for (auto it = std::next(list.begin()); it != list.end(); ++it) {
-    if (!env.drop((*it)->as_symbol())) {
+    if (!env.drop((*it)->as_symbol_id())) {
       throw interpreter_c::exception_c("Could not find symbol with name :" +
                                            (*it)->as_symbol(),
-                                       (*it)->locator);
+                                       (*it)->locator());
     }
   }
   return allocate_cell((int64_t)0);
@@ -131,35 +132,38 @@ cell_ptr assemble_anonymous_function(cell_processor_if &ci, cell_list_t &list,
 
   std::advance(it, 1);
 
-  auto &function_argument_list = (*it)->as_list_info();
+  auto &function_argument_list = (*it)->read_list_info();
 
   if (function_argument_list.type != list_types_e::DATA) {
     throw interpreter_c::exception_c(
-        "Expected data list `[]` for function arguments", (*it)->locator);
+        "Expected data list `[]` for function arguments", (*it)->locator());
   }
 
   lambda_info_s lambda_info;
 
-  lambda_info.arg_names.reserve(function_argument_list.list.size());
+  lambda_info.arg_ids.reserve(function_argument_list.list.size());
 
   for (auto &&arg : function_argument_list.list) {
-    lambda_info.arg_names.push_back(arg->as_symbol());
+    lambda_info.arg_ids.push_back(arg->as_symbol_id());
   }
 
   std::advance(it, 1);
   lambda_info.body = (*it);
   if (lambda_info.body->type != cell_type_e::LIST) {
     throw interpreter_c::exception_c("Expected list for function body",
-                                     lambda_info.body->locator);
+                                     lambda_info.body->locator());
   }
+  lambda_info.frame_layout = resolver::lambda_layout(lambda_info);
 
+  // The function runs in this environment, which must be kept for it
+  env.capture();
   function_info_s function_info("anon_fn", execute_suspected_lambda,
                                 function_type_e::LAMBDA_FUNCTION, &env);
 
   function_info.lambda = {lambda_info};
 
   auto fn_cell = allocate_cell(function_info);
-  fn_cell->locator = list[0]->locator;
+  fn_cell->set_locator(list[0]->packed_locator());
 
   return std::move(fn_cell);
 }
@@ -176,42 +180,45 @@ cell_ptr builtin_fn_env_fn(cell_processor_if &ci, cell_list_t &list,
 
   std::advance(it, 1);
 
-  auto target_function_name = (*it)->as_symbol();
+  auto target_function_id = (*it)->as_symbol_id();
+  auto &target_function_name = symbols::name_of(target_function_id);
 
   std::advance(it, 1);
 
-  auto &function_argument_list = (*it)->as_list_info();
+  auto &function_argument_list = (*it)->read_list_info();
 
   if (function_argument_list.type != list_types_e::DATA) {
     throw interpreter_c::exception_c(
-        "Expected data list `[]` for function arguments", (*it)->locator);
+        "Expected data list `[]` for function arguments", (*it)->locator());
   }
 
   lambda_info_s lambda_info;
 
-  lambda_info.arg_names.reserve(function_argument_list.list.size());
+  lambda_info.arg_ids.reserve(function_argument_list.list.size());
 
   for (auto &&arg : function_argument_list.list) {
-    lambda_info.arg_names.push_back(arg->as_symbol());
+    lambda_info.arg_ids.push_back(arg->as_symbol_id());
   }
 
   std::advance(it, 1);
   lambda_info.body = (*it);
   if (lambda_info.body->type != cell_type_e::LIST) {
     throw interpreter_c::exception_c("Expected list for function body",
-                                     lambda_info.body->locator);
+                                     lambda_info.body->locator());
   }
+  lambda_info.frame_layout = resolver::lambda_layout(lambda_info);
 
+  env.capture();
   function_info_s function_info(target_function_name, execute_suspected_lambda,
                                 function_type_e::LAMBDA_FUNCTION, &env);
 
   function_info.lambda = {lambda_info};
 
   auto fn_cell = allocate_cell(function_info);
-  fn_cell->locator = list[0]->locator;
+  fn_cell->set_locator(list[0]->packed_locator());
 
   // Set the variable
-  env.set(target_function_name, fn_cell);
+  env.set(target_function_id, fn_cell);
 
   return std::move(fn_cell);
 }
@@ -222,33 +229,32 @@ cell_ptr handle_dict_access(cell_processor_if &ci, cell_list_t &list,
   auto definition = list[0];
 
   if (definition->type == cell_type_e::SYMBOL) {
-    definition = env.get(definition->as_symbol());
+    definition = env.get(definition->as_symbol_id());
   }
 
-  auto fn_info = definition->as_function_info();
-  auto dict = fn_info.operating_env->get("$data");
+  static const symbol_id_t dict_data_id = symbols::intern("$data");
+
+  auto dict =
+      definition->as_function_info().operating_env->get(dict_data_id);
 
   // If its just the item then we will load and string the dict
   if (list.size() == 1) {
-    auto c = allocate_cell(dict->to_string(true, true));
-    c->locator = list[0]->locator;
-    return std::move(c);
+    return allocate_cell(dict->to_string(true, true));
   }
 
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::DICT, >=, 2)
 
   auto command = list[1]->as_symbol();
 
-  auto &dict_value = dict->as_dict();
+  // Only :let and :del write, so frozen dicts can serve the rest
+  auto &dict_value = dict->is_frozen() ? dict->read_dict() : dict->as_dict();
 
   if (command == ":keys") {
     list_info_s keys(list_types_e::DATA);
     for (auto &&dit : dict_value) {
       keys.list.push_back(allocate_cell(dit.first));
     }
-    auto c = allocate_cell(keys);
-    c->locator = list[1]->locator;
-    return std::move(c);
+    return allocate_cell(keys);
   }
 
   // Note: by not cloning the value we are allowing the user to
@@ -256,18 +262,15 @@ cell_ptr handle_dict_access(cell_processor_if &ci, cell_list_t &list,
   if (command == ":vals") {
     list_info_s vals(list_types_e::DATA);
     for (auto &&dit : dict_value) {
-      vals.list.push_back(dit.second);
+      vals.list.push_back(dit.second.box());
     }
-    auto c = allocate_cell(vals);
-    c->locator = list[1]->locator;
-    return std::move(c);
+    return allocate_cell(vals);
   }
 
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::DICT, >=, 3)
 
-  auto key = ci.process_cell(list[2], env)->to_string();
-  // auto key = ci.process_cell(ci.process_cell(list[2], env),
-  // env)->to_string();
+  cell_ptr held;
+  auto key = ci.borrow_cell(list[2], env, held)->to_string();
 
   /*
       OPTIMIZATION
@@ -284,34 +287,36 @@ cell_ptr handle_dict_access(cell_processor_if &ci, cell_list_t &list,
   if (command == ":let") {
     NIBI_LIST_ENFORCE_SIZE(nibi::kw::DICT, ==, 4)
 
-    auto value = ci.process_cell(list[3], env);
-    value->locator = list[3]->locator;
-    dict_value[key] = value;
-    return dict_value[key];
+    auto &target = dict->as_dict();
+    target[key] = ci.borrow_cell(list[3], env, held);
+    return target[key];
   }
 
   if (command == ":get") {
     auto dit = dict_value.find(key);
     if (dit == dict_value.end()) {
       throw interpreter_c::exception_c(
-          "Dict does not contain key `" + key + "`", list[2]->locator);
+          "Dict does not contain key `" + key + "`", list[2]->locator());
     }
 
+    // Box in place so updates to the result reach the dict
+    dit->second.box();
     return dit->second;
   }
 
   if (command == ":del") {
-    auto dit = dict_value.find(key);
-    if (dit == dict_value.end()) {
+    auto &target = dict->as_dict();
+    auto dit = target.find(key);
+    if (dit == target.end()) {
       return allocate_cell((int64_t)0);
     }
 
-    dict_value.erase(dit);
+    target.erase(dit);
     return allocate_cell((int64_t)1);
   }
 
   throw interpreter_c::exception_c("Unknown dict command `" + command + "`",
-                                   list[1]->locator);
+                                   list[1]->locator());
 }
 
 cell_ptr builtin_fn_dict_fn(cell_processor_if &ci, cell_list_t &list,
@@ -329,11 +334,11 @@ cell_ptr builtin_fn_dict_fn(cell_processor_if &ci, cell_list_t &list,
   if (list.size() == 1) {
 
     auto cell_actual = allocate_cell(dict_actual);
-    cell_actual->locator = list[0]->locator;
+    cell_actual->set_locator(list[0]->packed_locator());
     function_info.operating_env->set("$data", cell_actual);
     function_info.operating_env->set("$is_dict", allocate_cell((int64_t)1));
     auto fn_actual = allocate_cell(function_info);
-    fn_actual->locator = list[0]->locator;
+    fn_actual->set_locator(list[0]->packed_locator());
     return std::move(fn_actual);
   }
 
@@ -348,11 +353,11 @@ cell_ptr builtin_fn_dict_fn(cell_processor_if &ci, cell_list_t &list,
     dict_value = list[1];
   }
 
-  auto &list_info = dict_value->as_list_info();
+  auto &list_info = dict_value->read_list_info();
 
   if (list_info.type != list_types_e::DATA) {
     throw interpreter_c::exception_c("Expected data list `[]` for dict values",
-                                     list[1]->locator);
+                                     list[1]->locator());
   }
 
   if (list_info.list.size() != 0) {
@@ -360,19 +365,19 @@ cell_ptr builtin_fn_dict_fn(cell_processor_if &ci, cell_list_t &list,
 
     for (auto &value : list_info.list) {
       auto resolved_value = ci.process_cell(value, env);
-      auto &resolved_list_info = resolved_value->as_list_info();
+      auto &resolved_list_info = resolved_value->read_list_info();
       if (resolved_list_info.type != list_types_e::DATA) {
         throw interpreter_c::exception_c(
-            "Expected data list `[]` for dict values", value->locator);
+            "Expected data list `[]` for dict values", value->locator());
       }
       if (resolved_list_info.list.size() != 2) {
         throw interpreter_c::exception_c(
             "Expected list of size 2 for dict values [key value]",
-            value->locator);
+            value->locator());
       }
       if (resolved_list_info.list[0]->type != cell_type_e::STRING) {
         throw interpreter_c::exception_c("Expected string for dict key",
-                                         resolved_list_info.list[0]->locator);
+                                         resolved_list_info.list[0]->locator());
       }
 
       dict_actual[resolved_list_info.list[0]->to_string()] =
@@ -381,13 +386,13 @@ cell_ptr builtin_fn_dict_fn(cell_processor_if &ci, cell_list_t &list,
   }
 
   auto cell_actual = allocate_cell(dict_actual);
-  cell_actual->locator = list[0]->locator;
+  cell_actual->set_locator(list[0]->packed_locator());
 
   function_info.operating_env->set("$data", cell_actual);
   function_info.operating_env->set("$is_dict", allocate_cell((int64_t)1));
 
   auto fn_actual = allocate_cell(function_info);
-  fn_actual->locator = list[0]->locator;
+  fn_actual->set_locator(list[0]->packed_locator());
   return std::move(fn_actual);
 }
 
@@ -72,7 +72,8 @@ cell_ptr builtin_fn_except_throw(cell_processor_if &ci, cell_list_t &list,
 
   auto thrown = ci.process_cell(exec_cell, env, true);
 
-  throw interpreter_c::exception_c(thrown->to_string(), list.front()->locator);
+  throw interpreter_c::exception_c(thrown->to_string(),
+                                   list.front()->locator());
 }
 
 } // namespace builtins
@@ -62,7 +62,7 @@ cell_ptr builtin_fn_extern_call(cell_processor_if &ci, cell_list_t &list,
         cell_trivial_type_tag_map.end()) {
       std::string err =
           "extern-call: unsupported return type: " + return_type_tag;
-      throw interpreter_c::exception_c(err, list[4]->locator);
+      throw interpreter_c::exception_c(err, list[4]->locator());
     }
 
     return_type = cell_trivial_type_tag_map[return_type_tag];
@@ -70,7 +70,7 @@ cell_ptr builtin_fn_extern_call(cell_processor_if &ci, cell_list_t &list,
     if (cell_type_to_ffi.find(return_type) == cell_type_to_ffi.end()) {
       std::string err =
           "extern-call: unsupported return type: " + return_type_tag;
-      throw interpreter_c::exception_c(err, list[4]->locator);
+      throw interpreter_c::exception_c(err, list[4]->locator());
     }
   }
 
@@ -81,7 +81,7 @@ cell_ptr builtin_fn_extern_call(cell_processor_if &ci, cell_list_t &list,
     std::string err = "extern-call: " + std::to_string(arg_types.size()) +
                       " arguments declared, but supplied" +
                       std::to_string(list.size() - 5);
-    throw interpreter_c::exception_c(err, list[0]->locator);
+    throw interpreter_c::exception_c(err, list[0]->locator());
   }
 
   // Ensure all arg types are supported, and populate a list
@@ -93,14 +93,14 @@ cell_ptr builtin_fn_extern_call(cell_processor_if &ci, cell_list_t &list,
     if (it == cell_trivial_type_tag_map.end()) {
       std::string err =
           "extern-call: unsupported type: " + arg_type->as_symbol();
-      throw interpreter_c::exception_c(err, arg_type->locator);
+      throw interpreter_c::exception_c(err, arg_type->locator());
     }
 
     auto it2 = cell_type_to_ffi.find(it->second);
     if (it2 == cell_type_to_ffi.end()) {
       std::string err =
           "extern-call: unsupported type: " + arg_type->as_symbol();
-      throw interpreter_c::exception_c(err, arg_type->locator);
+      throw interpreter_c::exception_c(err, arg_type->locator());
     }
     arg_cell_types.push_back(it->second);
   }
@@ -111,7 +111,7 @@ cell_ptr builtin_fn_extern_call(cell_processor_if &ci, cell_list_t &list,
     std::string err = "extern-call: max ffi arguments exceeded: " +
                       std::to_string(arg_cell_types.size()) + " > " +
                       std::to_string(NIBI_FFI_ARG_MAX);
-    throw interpreter_c::exception_c(err, list[0]->locator);
+    throw interpreter_c::exception_c(err, list[0]->locator());
   }
 
   // Take arguments and process them down to their values
@@ -130,7 +130,7 @@ cell_ptr builtin_fn_extern_call(cell_processor_if &ci, cell_list_t &list,
           "extern-call: argument " + std::to_string(i) + " is of type " +
           cell_type_to_string(args_supplied[i]->type) + " but should be type " +
           cell_type_to_string(arg_cell_types[i]);
-      throw interpreter_c::exception_c(err, list[0]->locator);
+      throw interpreter_c::exception_c(err, list[0]->locator());
     }
   }
 
@@ -157,7 +157,7 @@ cell_ptr builtin_fn_extern_call(cell_processor_if &ci, cell_list_t &list,
     std::string err = "extern-call: could not open library " +
                       (lib_name.has_value() ? *lib_name : "") + " " +
                       dlerror() + ")";
-    throw interpreter_c::exception_c(err, list[0]->locator);
+    throw interpreter_c::exception_c(err, list[0]->locator());
   }
 
   void *fn_ptr = dlsym(lib_handle, fn_name.c_str());
@@ -167,7 +167,7 @@ cell_ptr builtin_fn_extern_call(cell_processor_if &ci, cell_list_t &list,
     std::string err =
         "extern-call: could not get handle to function: " + fn_name + " " +
         error;
-    throw interpreter_c::exception_c(err, list[0]->locator);
+    throw interpreter_c::exception_c(err, list[0]->locator());
   }
 
   // Setup the ffi call
@@ -176,12 +176,21 @@ cell_ptr builtin_fn_extern_call(cell_processor_if &ci, cell_list_t &list,
   ffi_type *ffi_ret_type = cell_type_to_ffi[return_type];
   ffi_type *ffi_arg_types[NIBI_FFI_ARG_MAX];
   void *ffi_arg_vals[NIBI_FFI_ARG_MAX];
+  char *ffi_string_args[NIBI_FFI_ARG_MAX];
   ffi_status status;
 
   // Load the arguments
 
   for (std::size_t i = 0; i < arg_cell_types.size(); i++) {
     ffi_arg_types[i] = cell_type_to_ffi[arg_cell_types[i]];
+
+    // Short strings are stored inside the cell, so the
+    // callee is given a pointer to the characters instead
+    if (arg_cell_types[i] == cell_type_e::STRING) {
+      ffi_string_args[i] = args_supplied[i]->as_c_string();
+      ffi_arg_vals[i] = &ffi_string_args[i];
+      continue;
+    }
     ffi_arg_vals[i] = &args_supplied[i]->data;
   }
 
@@ -199,7 +208,18 @@ cell_ptr builtin_fn_extern_call(cell_processor_if &ci, cell_list_t &list,
 
     std::string err = "'ffi' call to ffi_prep_cif failed with code: " +
                       std::to_string(status);
-    throw interpreter_c::exception_c(err, list[0]->locator);
+    throw interpreter_c::exception_c(err, list[0]->locator());
+  }
+
+  // Strings returned are copied into the cell, the callee keeps ownership
+
+  if (return_type == cell_type_e::STRING) {
+    char *returned_string{nullptr};
+    ffi_call(&cif, FFI_FN(fn_ptr), &returned_string, ffi_arg_vals);
+    auto result =
+        allocate_cell(std::string(returned_string ? returned_string : ""));
+    dlclose(lib_handle);
+    return result;
   }
 
   // Perform the call (data will be placed directly into cell->data union
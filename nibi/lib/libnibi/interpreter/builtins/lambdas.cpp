@@ -14,72 +14,97 @@ namespace builtins {
 //  Lambda Execution taking the form of builtin functions
 // --------------------------------------------------------
 
+namespace {
+bool is_variadic(const lambda_info_s &lambda) {
+  static const symbol_id_t variadic_args_id = symbols::intern(":args");
+  return lambda.arg_ids.size() == 1 && lambda.arg_ids[0] == variadic_args_id;
+}
+} // namespace
+
+void evaluate_lambda_arguments(cell_processor_if &ci,
+                               const lambda_info_s &lambda, cell_list_t &list,
+                               env_c &env, cell_list_t &arguments) {
+  if (is_variadic(lambda)) {
+    for (auto it = std::next(list.begin()); it != list.end(); ++it) {
+      arguments.push_back(ci.process_cell((*it), env));
+    }
+    return;
+  }
+
+  if (list.size() != lambda.arg_ids.size() + 1) {
+    throw interpreter_c::exception_c(
+        std::string(nibi::kw::FN) + " instruction expects " +
+            std::to_string(lambda.arg_ids.size()) + " parameters, got " +
+            std::to_string(list.size() - 1) + ".",
+        list.front()->locator());
+  }
+
+  auto it = list.begin();
+  for (auto &&arg_id : lambda.arg_ids) {
+    std::advance(it, 1);
+    NIBI_VALIDATE_VAR_NAME(symbols::name_of(arg_id), (*it)->locator());
+    arguments.push_back(ci.process_cell((*it), env));
+  }
+}
+
+void bind_lambda_arguments(const lambda_info_s &lambda, cell_list_t &arguments,
+                           env_c &lambda_env) {
+  if (is_variadic(lambda)) {
+    static const symbol_id_t args_list_id = symbols::intern("$args");
+    lambda_env.define(args_list_id, allocate_cell(list_info_s{
+                                        list_types_e::DATA,
+                                        std::move(arguments)}));
+    return;
+  }
+
+  for (std::size_t n = 0; n < lambda.arg_ids.size(); n++) {
+    lambda_env.define(lambda.arg_ids[n], std::move(arguments[n]));
+  }
+}
+
 cell_ptr execute_suspected_lambda(cell_processor_if &ci, cell_list_t &list,
                                   env_c &env) {
 
   auto it = list.begin();
 
-  cell_ptr target_cell = (*it);
+  // Borrowed, the interpreter holds the function for the call
+  const cell_ptr *target_cell = &(*it);
 
   // If the first argument is a symbol, then we need to look it up
   if ((*it)->type == cell_type_e::SYMBOL) {
-    auto target_symbol = (*it)->as_c_string();
-    target_cell = env.get(target_symbol);
+    target_cell = env.find((*it)->as_symbol_id());
     if (!target_cell) {
       throw interpreter_c::exception_c("Symbol not found in environment: " +
                                            (*it)->as_symbol(),
-                                       (*it)->locator);
+                                       (*it)->locator());
       return nullptr;
     }
   }
 
-  auto &fn_info = target_cell->as_function_info();
+  auto &fn_info = (*target_cell)->as_function_info();
 
   if (fn_info.type != function_type_e::LAMBDA_FUNCTION) {
     throw interpreter_c::exception_c("Expected lambda function",
-                                     (*it)->locator);
+                                     (*it)->locator());
   }
 
   auto &lambda_info = *fn_info.lambda;
 
   // Create an environment for the lambda
   // and populate it with the arguments
-  auto lambda_env = env_c(fn_info.operating_env);
-  auto &map = lambda_env.get_map();
-
-  if (lambda_info.arg_names.size() == 1 &&
-      lambda_info.arg_names[0] == ":args") {
-
-    list_info_s args = {list_types_e::DATA, {}};
-
-    while (it != list.end() - 1) {
-      std::advance(it, 1);
-      args.list.push_back(ci.process_cell((*it), env));
-    }
-
-    map["$args"] = allocate_cell(args);
-    map["$args"]->locator = lambda_info.body->locator;
+  cell_list_t arguments;
+  evaluate_lambda_arguments(ci, lambda_info, list, env, arguments);
+  auto lambda_env = env_c(fn_info.operating_env, lambda_info.frame_layout);
+  bind_lambda_arguments(lambda_info, arguments, lambda_env);
 
-    // We have a variadic function
-  } else {
-    NIBI_LIST_ENFORCE_SIZE(nibi::kw::FN, ==, lambda_info.arg_names.size() + 1);
-
-    for (auto &&arg_name : lambda_info.arg_names) {
-      std::advance(it, 1);
-      NIBI_VALIDATE_VAR_NAME(arg_name, (*it)->locator);
-      map[arg_name] = ci.process_cell((*it), env);
-    }
-  }
-
-  auto &body = lambda_info.body->as_list_info();
-
-  cell_ptr result = ci.process_cell(lambda_info.body, lambda_env, true);
+  cell_ptr result = ci.process_lambda(lambda_info, lambda_env);
 
   // Because we have pointers to parametrs stored we don't want the environment
   // to free them, so we manually remove them here before
 
-  for (auto &&arg_name : lambda_info.arg_names) {
-    map.erase(arg_name);
+  auto &map = lambda_env.get_map();
+  for (auto &&arg_id : lambda_info.arg_ids) {
+    map.erase(arg_id);
   }
 
   // We are out of the function, so we can reset the yield value
@@ -8,32 +8,24 @@
 namespace nibi {
 namespace builtins {
 
-#if CELL_LIST_USE_STD_VECTOR
 inline void pop_front(cell_list_t &list) { list.erase(list.begin()); }
 
 inline void push_front(cell_list_t &list, cell_ptr &&cell) {
-  list.insert(list.begin(), cell);
+  list.insert(list.begin(), std::move(cell));
 }
-#endif
 
 cell_ptr builtin_fn_list_push_front(cell_processor_if &ci, cell_list_t &list,
                                     env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::PUSH_FRONT, ==, 3)
 
   auto value_to_push = std::move(ci.process_cell(list[2], env));
-  value_to_push->locator = list[2]->locator;
 
   auto list_to_push_to = std::move(ci.process_cell(list[1], env));
-  list_to_push_to->locator = list[1]->locator;
 
   auto &list_info = list_to_push_to->as_list_info();
 
   // Clone the target and push it back
-#if CELL_LIST_USE_STD_VECTOR
-  push_front(list_info.list, std::move(value_to_push->clone(env)));
-#else
-  list_info.list.push_front(std::move(value_to_push->clone(env)));
-#endif
+  push_front(list_info.list, std::move(value_to_push.clone(env)));
 
   return std::move(list_to_push_to);
 }
@@ -43,15 +35,13 @@ cell_ptr builtin_fn_list_push_back(cell_processor_if &ci, cell_list_t &list,
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::PUSH_BACK, ==, 3)
 
   auto value_to_push = std::move(ci.process_cell(list[2], env));
-  value_to_push->locator = list[2]->locator;
 
   auto list_to_push_to = std::move(ci.process_cell(list[1], env));
-  list_to_push_to->locator = list[1]->locator;
 
   auto &list_info = list_to_push_to->as_list_info();
 
   // Clone the target and push it back
-  list_info.list.push_back(std::move(value_to_push->clone(env)));
+  list_info.list.push_back(std::move(value_to_push.clone(env)));
 
   return std::move(list_to_push_to);
 }
@@ -61,7 +51,6 @@ cell_ptr builtin_fn_list_pop_back(cell_processor_if &ci, cell_list_t &list,
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::POP_BACK, ==, 2)
 
   auto target = std::move(ci.process_cell(list[1], env));
-  target->locator = list[1]->locator;
 
   auto &list_info = target->as_list_info();
 
@@ -79,7 +68,6 @@ cell_ptr builtin_fn_list_pop_front(cell_processor_if &ci, cell_list_t &list,
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::POP_FRONT, ==, 2)
 
   auto target = std::move(ci.process_cell(list[1], env));
-  target->locator = list[1]->locator;
 
   auto &list_info = target->as_list_info();
 
@@ -87,11 +75,7 @@ cell_ptr builtin_fn_list_pop_front(cell_processor_if &ci, cell_list_t &list,
     return std::move(target);
   }
 
-#if CELL_LIST_USE_STD_VECTOR
   pop_front(list_info.list);
-#else
-  list_info.list.pop_front();
-#endif
 
   return std::move(target);
 }
@@ -102,26 +86,28 @@ cell_ptr builtin_fn_list_iter(cell_processor_if &ci, cell_list_t &list,
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::ITER, ==, 4)
 
   auto list_to_iterate = std::move(ci.process_cell(list[1], env));
-  list_to_iterate->locator = list[1]->locator;
 
-  auto &list_info = list_to_iterate->as_list_info();
+  // Frozen elements are already boxed, so a frozen list is only read
+  auto &list_info = list_to_iterate->is_frozen()
+                        ? list_to_iterate->read_list_info()
+                        : list_to_iterate->as_list_info();
 
   auto it = list.begin();
 
   std::advance(it, 2);
-  auto symbol_to_bind = (*it)->as_symbol();
+  auto symbol_to_bind = (*it)->as_symbol_id();
 
   std::advance(it, 1);
-  auto ins_to_exec_per_item = (*it);
+  auto &ins_to_exec_per_item = (*it);
 
   auto iter_env = env_c(&env);
 
-  auto &current_env_map = iter_env.get_map();
+  for (auto &cell : list_info.list) {
 
-  for (auto cell : list_info.list) {
+    // Box the element in place so the bound symbol refers to it
+    cell.box();
 
-    current_env_map[symbol_to_bind] =
-        std::move(ci.process_cell(cell, iter_env));
+    iter_env.define(symbol_to_bind, ci.process_cell(cell, iter_env));
 
     ci.process_cell(ins_to_exec_per_item, iter_env, true);
   }
@@ -134,13 +120,13 @@ cell_ptr builtin_fn_list_at(cell_processor_if &ci, cell_list_t &list,
                             env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::AT, ==, 3)
 
-  auto requested_idx = std::move(ci.process_cell(list[2], env));
+  cell_ptr held;
+  auto actual_idx_val = ci.borrow_cell(list[2], env, held).as_integer();
 
   auto target_list = std::move(ci.process_cell(list[1], env));
 
-  auto &list_info = target_list->as_list_info();
-
-  auto actual_idx_val = requested_idx->as_integer();
+  auto &list_info = target_list->is_frozen() ? target_list->read_list_info()
+                                              : target_list->as_list_info();
 
   while (actual_idx_val < 0) {
     actual_idx_val = list_info.list.size() + actual_idx_val;
@@ -148,31 +134,34 @@ cell_ptr builtin_fn_list_at(cell_processor_if &ci, cell_list_t &list,
 
   if (actual_idx_val >= list_info.list.size()) {
     throw interpreter_c::exception_c("Index out of bounds (OOB)",
-                                     list[2]->locator);
+                                     list[2]->locator());
   }
 
-  return std::move(ci.process_cell(list_info.list[actual_idx_val], env));
+  // Box the element in place so updates to the result reach the list
+  auto &element = list_info.list[actual_idx_val];
+  element.box();
+
+  return std::move(ci.process_cell(element, env));
 }
 
 cell_ptr builtin_fn_list_spawn(cell_processor_if &ci, cell_list_t &list,
                                env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::SPAWN, ==, 3)
 
-  auto list_size = std::move(ci.process_cell(list[2], env));
+  cell_ptr held;
+  auto list_size = ci.borrow_cell(list[2], env, held).as_integer();
 
-  if (list_size->as_integer() < 0) {
+  if (list_size < 0) {
     auto it = list.begin();
     std::advance(it, 2);
     throw interpreter_c::exception_c("Cannot spawn a list with a negative size",
-                                     (*it)->locator);
+                                     (*it)->locator());
   }
 
-  auto spawned = allocate_cell(list_info_s{
+  return allocate_cell(list_info_s{
       list_types_e::DATA,
-      cell_list_t(list_size->as_integer(),
-                  std::move(ci.process_cell(list[1], env)->clone(env)))});
-  spawned->locator = list[1]->locator;
-  return std::move(spawned);
+      cell_list_t(list_size,
+                  std::move(ci.process_cell(list[1], env).clone(env)))});
 }
 
 } // namespace builtins
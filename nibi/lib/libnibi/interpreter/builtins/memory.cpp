@@ -20,7 +20,8 @@ cell_ptr builtin_fn_memory_new(cell_processor_if &ci, cell_list_t &list,
     return ptr_cell;
   }
 
-  auto size = ci.process_cell(list[1], env)->as_integer();
+  cell_ptr held;
+  auto size = ci.borrow_cell(list[1], env, held)->as_integer();
 
   ptr_cell->data.ptr = malloc(size);
   return ptr_cell;
@@ -47,10 +48,11 @@ cell_ptr builtin_fn_memory_del(cell_processor_if &ci, cell_list_t &list,
 cell_ptr builtin_fn_memory_is_set(cell_processor_if &ci, cell_list_t &list,
                                   env_c &env) {
   NIBI_LIST_ENFORCE_SIZE(nibi::kw::MEM_IS_SET, ==, 2)
-  auto ptr = ci.process_cell(list[1], env);
+  cell_ptr held;
+  auto &ptr = ci.borrow_cell(list[1], env, held);
   if (ptr->type != cell_type_e::PTR) {
     throw interpreter_c::exception_c("Cell does not contain a pointer",
-                                     list[1]->locator);
+                                     list[1]->locator());
   }
   return allocate_cell((int64_t)(ptr->data.ptr != nullptr));
 }
@@ -60,12 +62,12 @@ cell_ptr copy_cell_into_memory(cell_processor_if &ci, cell_ptr &source,
 
   if (static_cast<uint8_t>(source->type) > CELL_TYPE_MAX_TRIVIAL) {
     throw interpreter_c::exception_c(
-        "Can not copy non-trivial cell into memory", source->locator);
+        "Can not copy non-trivial cell into memory", source->locator());
   }
 
   if (source->type == cell_type_e::NIL) {
     throw interpreter_c::exception_c("Can not copy NIL cell into memory",
-                                     source->locator);
+                                     source->locator());
   }
 
   if (dest->data.ptr != nullptr) {
@@ -129,7 +131,7 @@ cell_ptr copy_cell_into_memory(cell_processor_if &ci, cell_ptr &source,
   default:
     throw interpreter_c::exception_c(
         "Attempt to copy unhandled non-trivial cell into memory",
-        source->locator);
+        source->locator());
     break;
   }
   return dest;
@@ -155,7 +157,7 @@ cell_ptr builtin_fn_memory_cpy(cell_processor_if &ci, cell_list_t &list,
 
   if (dest->type != cell_type_e::PTR) {
     throw interpreter_c::exception_c("Destination cell must be a pointer",
-                                     list[2]->locator);
+                                     list[2]->locator());
   }
 
   auto source = ci.process_cell(list[1], env);
@@ -170,7 +172,7 @@ cell_ptr builtin_fn_memory_cpy(cell_processor_if &ci, cell_list_t &list,
 
   if (!size_bytes->is_integer()) {
     throw interpreter_c::exception_c("Expected size parameter to be an integer",
-                                     list[3]->locator);
+                                     list[3]->locator());
   }
 
   return copy_memory(ci, source, dest, size_bytes->data.u64);
@@ -185,14 +187,14 @@ cell_ptr builtin_fn_memory_load(cell_processor_if &ci, cell_list_t &list,
   auto tcm = cell_trivial_type_tag_map.find(suspected_tag);
   if (tcm == cell_trivial_type_tag_map.end()) {
     throw interpreter_c::exception_c(
-        "Expected parameter to be a trivial type tag", list[1]->locator);
+        "Expected parameter to be a trivial type tag", list[1]->locator());
   }
 
   auto dest = ci.process_cell(list[2], env);
 
   if (dest->data.ptr == nullptr) {
     throw interpreter_c::exception_c("Attempt to load from unallocated pointer",
-                                     list[2]->locator);
+                                     list[2]->locator());
   }
 
   auto new_cell = allocate_cell(tcm->second);
@@ -236,7 +238,7 @@ cell_ptr builtin_fn_memory_load(cell_processor_if &ci, cell_list_t &list,
   default:
     throw interpreter_c::exception_c(
         "Attempted to load unhandled type directly from memory",
-        list[1]->locator);
+        list[1]->locator());
     break;
   }
 
@@ -49,7 +49,7 @@ inline nibi::cell_ptr type(nibi::cell_processor_if &ci, nibi::cell_list_t &list,
   case nibi::cell_type_e::PTR:
     return nibi::allocate_cell(nibi::types::PTR);
   case nibi::cell_type_e::LIST: {
-    auto list_info = resolved->as_list_info();
+    auto &list_info = resolved->read_list_info();
     switch (list_info.type) {
     case nibi::list_types_e::DATA:
       return nibi::allocate_cell(nibi::types::LIST_DATA);
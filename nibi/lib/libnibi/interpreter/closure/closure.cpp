@@ -0,0 +1,629 @@
+#include "closure.hpp"
+
+#include "interpreter/interpreter.hpp"
+#include "libnibi/alloc_profiler.hpp"
+#include "libnibi/interpreter/forms.hpp"
+#include "libnibi/interpreter/numeric.hpp"
+#include "libnibi/interpreter/resolver.hpp"
+#include "libnibi/small_vector.hpp"
+
+#include <vector>
+
+namespace nibi {
+namespace closure {
+
+namespace {
+
+// Operands most arithmetic forms fit in without an allocation
+static constexpr std::size_t INLINE_OPERANDS = 4;
+
+[[noreturn]] void symbol_not_found(cell_ref_t symbol) {
+  throw interpreter_c::exception_c("Symbol not found in environment: " +
+                                       symbol->as_symbol(),
+                                   symbol->locator());
+}
+
+} // namespace
+
+struct node_s;
+
+//! \brief What a node runs with
+struct context_s {
+  interpreter_c &interpreter;
+  env_c &env;
+  env_c &frame; // Of the lambda, which env is or is nested in
+};
+
+//! \brief A cell of the body, built into the function that runs it
+struct node_s {
+  using run_fn_t = cell_ptr (*)(const node_s &node,
+                                const context_s &context);
+
+  run_fn_t run{nullptr};
+  cell_ptr cell{nullptr};          // The cell the node was built from
+  cell_ptr head{nullptr};          // The head of a call or operation
+  symbol_id_t symbol{0};           // The variable read, bound or called
+  resolver::address_s address;     // Where the variable is kept
+  forms::builtin_fn_t fn{nullptr}; // The builtin a form calls
+  slot_layout_t layout;            // The slots of the scope a form opens
+  std::vector<node_s> children;    // The arguments, in order
+  mutable binding_cache_s cache;   // Of the function a call calls
+};
+
+struct program_s {
+  node_s body;
+  int32_t arity{-1};       // -1 if calls must go through the interpreter
+  uint32_t generation{0}; // Of the macro names it was built with, see
+                          // resolver::generation
+};
+
+struct runner_c::nodes_s {
+
+  //! \brief Run a node where process_cell would run its cell, which
+  //!        gives the yielded value once there is one
+  static inline cell_ptr evaluate(const node_s &node,
+                                  const context_s &context) {
+    if (context.interpreter.yield_value_) {
+      return context.interpreter.yield_value_;
+    }
+    return node.run(node, context);
+  }
+
+  static inline void safe_point(interpreter_c &interpreter) {
+    if (--interpreter.safe_point_countdown_ == 0) {
+      interpreter.handle_safe_point();
+    }
+  }
+
+  static cell_ptr literal(const node_s &node, const context_s &) {
+    return node.cell;
+  }
+
+  static cell_ptr nil(const node_s &, const context_s &) {
+    return allocate_cell(cell_type_e::NIL);
+  }
+
+  // Load a variable as process_cell does, boxing it
+  static cell_ptr get(const node_s &node, const context_s &context) {
+    auto value = context.env.get(node.symbol);
+    if (!value) {
+      symbol_not_found(node.cell);
+    }
+    return value;
+  }
+
+  // Read a variable as borrow_cell does
+  static cell_ptr read(const node_s &node, const context_s &context) {
+    auto *value = context.env.find(node.symbol);
+    if (!value) {
+      symbol_not_found(node.cell);
+    }
+    return *value;
+  }
+
+  static cell_ptr get_local(const node_s &node, const context_s &context) {
+    auto value = context.env.get(node.symbol, node.address.depth,
+                                 node.address.slot);
+    if (!value) {
+      symbol_not_found(node.cell);
+    }
+    return value;
+  }
+
+  static cell_ptr read_local(const node_s &node, const context_s &context) {
+    auto *value = context.env.find(node.symbol, node.address.depth,
+                                   node.address.slot);
+    if (!value) {
+      symbol_not_found(node.cell);
+    }
+    return *value;
+  }
+
+  static cell_ptr eval(const node_s &node, const context_s &context) {
+    return context.interpreter.process_cell(node.cell, context.env);
+  }
+
+  // Run the items of a data list in turn
+  static cell_ptr sequence(const node_s &node, const context_s &context) {
+    cell_ptr result = allocate_cell(cell_type_e::NIL);
+    for (auto &child : node.children) {
+      result = evaluate(child, context);
+      if (context.interpreter.yield_value_) {
+        return context.interpreter.yield_value_;
+      }
+    }
+    return result;
+  }
+
+  // Call the bound builtin with the parsed form, as handle_list_cell
+  // does once it has loaded the head
+  static cell_ptr builtin(const node_s &node, const context_s &context) {
+    auto &interpreter = context.interpreter;
+    auto &instruction = node.cell->as_list_info();
+    auto &list = instruction.list;
+
+    interpreter.call_stack_.push(list.front());
+    alloc_profiler::frame_c profiler_frame(*list.front());
+    interpreter.instruction_ = &instruction;
+    auto value = node.fn(interpreter, list, context.env);
+    interpreter.call_stack_.pop();
+    return value;
+  }
+
+  static cell_ptr assign(const node_s &node, const context_s &context) {
+    auto value = evaluate(node.children[0], context).clone(context.env);
+    context.env.set(node.symbol, value);
+    return value;
+  }
+
+  static cell_ptr assign_local(const node_s &node, const context_s &context) {
+    auto value = evaluate(node.children[0], context).clone(context.env);
+    context.env.set(node.symbol, node.address.depth, node.address.slot,
+                    value);
+    return value;
+  }
+
+  static cell_ptr set(const node_s &node, const context_s &context) {
+    auto target = evaluate(node.children[0], context);
+    auto value = evaluate(node.children[1], context);
+    target.box();
+    target->update_from(value, context.env);
+    return target;
+  }
+
+  static cell_ptr if_form(const node_s &node, const context_s &context) {
+    env_c if_env(&context.env, node.layout);
+    return if_in_place(node, {context.interpreter, if_env, context.frame});
+  }
+
+  // An `if` that binds nothing, run in the scope around it
+  static cell_ptr if_in_place(const node_s &node, const context_s &context) {
+    if (evaluate(node.children[0], context).as_integer() > 0) {
+      return evaluate(node.children[1], context);
+    }
+    if (node.children.size() == 3) {
+      return evaluate(node.children[2], context);
+    }
+    return context.interpreter.last_result_;
+  }
+
+  // (loop (pre) (cond) (post) (body))
+  static cell_ptr loop(const node_s &node, const context_s &context) {
+    env_c loop_env(&context.env, node.layout);
+    return loop_in_place(node, {context.interpreter, loop_env, context.frame});
+  }
+
+  // A `loop` that binds nothing, run in the scope around it
+  static cell_ptr loop_in_place(const node_s &node,
+                                const context_s &context) {
+    auto &interpreter = context.interpreter;
+    evaluate(node.children[0], context);
+
+    cell_ptr result = allocate_cell(cell_type_e::NIL);
+    while (evaluate(node.children[1], context).to_integer() > 0) {
+      result = evaluate(node.children[3], context);
+      if (interpreter.yield_value_) {
+        return interpreter.yield_value_;
+      }
+      evaluate(node.children[2], context);
+      safe_point(interpreter);
+    }
+    return result;
+  }
+
+  static cell_ptr yield_zero(const node_s &, const context_s &context) {
+    context.interpreter.yield_value_ = allocate_cell((int64_t)0);
+    return context.interpreter.yield_value_;
+  }
+
+  static cell_ptr yield(const node_s &node, const context_s &context) {
+    auto &interpreter = context.interpreter;
+    auto value = evaluate(node.children[0], context);
+    if (interpreter.tail_call_.function) {
+      interpreter.tail_call_.clone = true;
+      value = allocate_cell(cell_type_e::NIL);
+    } else {
+      value = value.clone(context.env);
+    }
+    interpreter.yield_value_ = value;
+    return value;
+  }
+
+  // Operands that are not I64 or F64 go to the builtin
+  template <forms::operation_e Op>
+  static cell_ptr arithmetic(const node_s &node, const context_s &context) {
+    small_vector_c<cell_ptr, INLINE_OPERANDS> operands;
+    for (auto &child : node.children) {
+      operands.push_back(evaluate(child, context));
+    }
+    cell_ptr result;
+    if (numeric::arithmetic<Op>(operands.data(), operands.size(), result)) {
+      return result;
+    }
+    return context.interpreter.apply_builtin(node.head, operands.data(),
+                                             operands.size(), context.env);
+  }
+
+  template <forms::operation_e Op>
+  static cell_ptr compare(const node_s &node, const context_s &context) {
+    cell_ptr operands[2] = {evaluate(node.children[0], context),
+                            evaluate(node.children[1], context)};
+    cell_ptr result;
+    if (numeric::compare<Op>(operands[0], operands[1], result)) {
+      return result;
+    }
+    return context.interpreter.apply_builtin(node.head, operands, 2,
+                                             context.env);
+  }
+
+  static cell_ptr negate(const node_s &node, const context_s &context) {
+    auto operand = evaluate(node.children[0], context);
+    cell_ptr result;
+    if (numeric::negate(operand, result)) {
+      return result;
+    }
+    return context.interpreter.apply_builtin(node.head, &operand, 1,
+                                             context.env);
+  }
+
+  // Call a lambda by name, binding the arguments straight from their
+  // nodes. Anything else is called by the interpreter, which also
+  // reports the errors
+  static cell_ptr call(const node_s &node, const context_s &context) {
+    auto &interpreter = context.interpreter;
+    auto *found = context.env.find(node.symbol, node.cache);
+    if (!found || !is_built_call(*found, node.children.size())) {
+      return interpreter.process_cell(node.cell, context.env);
+    }
+
+    // Held as the body may replace the function it belongs to
+    cell_ptr function = *found;
+    auto &info = function->as_function_info();
+    auto program = program_of(*info.lambda);
+
+    interpreter.call_stack_.push(node.head);
+    cell_ptr result;
+    {
+      alloc_profiler::frame_c profiler_frame(*node.head);
+
+      // The arguments are the first slots of the layout
+      env_c lambda_env(info.operating_env, info.lambda->frame_layout);
+      for (std::size_t n = 0; n < node.children.size(); n++) {
+        lambda_env.slot(n) = evaluate(node.children[n], context);
+      }
+
+      interpreter_c::call_frame_c call_frame(interpreter);
+      result = evaluate(program->body, {interpreter, lambda_env, lambda_env});
+      if (interpreter.tail_call_.function) {
+        result = interpreter.run_tail_calls(lambda_env);
+      }
+    }
+    if (interpreter.yield_value_) {
+      interpreter.yield_value_ = nullptr;
+    }
+    interpreter.call_stack_.pop();
+
+    safe_point(interpreter);
+    return result;
+  }
+
+  // Leave a call in tail position to the caller of the frame, which
+  // makes it in place of the frame. Anything but a lambda call that is
+  // built is made by the interpreter, as it is by `call`
+  static cell_ptr tail_call(const node_s &node, const context_s &context) {
+    auto &interpreter = context.interpreter;
+    auto *found = context.env.find(node.symbol, node.cache);
+    if (!found || !is_built_call(*found, node.children.size())) {
+      return interpreter.process_cell(node.cell, context.env);
+    }
+
+    // Held as the arguments may replace the function
+    cell_ptr function = *found;
+    cell_list_t arguments;
+    for (auto &child : node.children) {
+      arguments.push_back(evaluate(child, context));
+    }
+
+    // A yield in the arguments is the value of the call, as the
+    // body would give it back without running
+    if (interpreter.yield_value_) {
+      auto value = std::move(interpreter.yield_value_);
+      interpreter.yield_value_ = nullptr;
+      return value;
+    }
+
+    auto &tail_call = interpreter.tail_call_;
+    tail_call.function = std::move(function);
+    tail_call.head = node.head;
+    tail_call.arguments = std::move(arguments);
+
+    // A function made in a scope of the frame may refer to it, so
+    // the call is made before the scope ends
+    if (context.env.is_captured_below(context.frame)) {
+      interpreter_c::call_frame_c call_frame(interpreter);
+      return interpreter.run_tail_calls(context.env);
+    }
+    return allocate_cell(cell_type_e::NIL);
+  }
+
+  static bool is_built_call(cell_ref_t function, const std::size_t count) {
+    if (!function || function.is_immediate() ||
+        function->type != cell_type_e::FUNCTION) {
+      return false;
+    }
+    auto &info = function->as_function_info();
+    return info.type == function_type_e::LAMBDA_FUNCTION && info.lambda &&
+           program_of(*info.lambda)->arity == static_cast<int32_t>(count);
+  }
+
+  // Build a cell into the node giving `process_cell(cell, env)` if
+  // boxed, or `borrow_cell` otherwise. The position of each form is
+  // that the tree walker gives it in interpreter_c::process_tail
+  static node_s build(cell_ref_t cell, const bool boxed,
+                      resolver::scopes_c &scopes,
+                      const forms::position_e position =
+                          forms::position_e::VALUE) {
+    node_s node;
+    node.cell = cell;
+
+    if (!cell) {
+      node.run = nil;
+      return node;
+    }
+
+    if (cell.is_immediate()) {
+      node.run = literal;
+      return node;
+    }
+
+    switch (cell->type) {
+    case cell_type_e::SYMBOL:
+      node.symbol = cell->as_symbol_id();
+      if (auto address = scopes.resolve(node.symbol)) {
+        node.run = boxed ? get_local : read_local;
+        node.address = *address;
+        return node;
+      }
+      node.run = boxed ? get : read;
+      return node;
+    case cell_type_e::LIST:
+      if (auto *list = forms::instruction_list(cell)) {
+        return build_form(cell, *list, scopes, position);
+      }
+      node.run = eval;
+      return node;
+    case cell_type_e::ALIAS:
+      node.run = eval;
+      return node;
+    default:
+      node.run = literal;
+      return node;
+    }
+  }
+
+  // Build a cell into the node giving `process_cell(cell, env, true)`
+  static node_s build_body(cell_ref_t cell, resolver::scopes_c &scopes,
+                           const forms::position_e position =
+                               forms::position_e::VALUE) {
+    auto *list = forms::body_list(cell);
+    if (!list) {
+      return build(cell, true, scopes, position);
+    }
+
+    node_s node;
+    node.run = sequence;
+    node.cell = cell;
+    node.children.reserve(list->size());
+    auto before_last = position == forms::position_e::VALUE
+                           ? forms::position_e::VALUE
+                           : forms::position_e::STATEMENT;
+    for (std::size_t n = 0; n < list->size(); n++) {
+      node.children.push_back(build((*list)[n], true, scopes,
+                                    n + 1 < list->size() ? before_last
+                                                         : position));
+    }
+    return node;
+  }
+
+  static node_s build_form(cell_ref_t cell, const cell_list_t &list,
+                           resolver::scopes_c &scopes,
+                           const forms::position_e position) {
+    node_s node;
+    node.cell = cell;
+    node.head = list.front();
+
+    if (list.front().type() == cell_type_e::SYMBOL) {
+      node.run = position == forms::position_e::TAIL ||
+                         position == forms::position_e::YIELD
+                     ? tail_call
+                     : call;
+      node.symbol = list.front()->as_symbol_id();
+      node.children.reserve(list.size() - 1);
+      for (std::size_t n = 1; n < list.size(); n++) {
+        node.children.push_back(build(list[n], true, scopes));
+      }
+      return node;
+    }
+
+    auto builtin = forms::identify(list.front());
+    if (!builtin.fn) {
+      node.run = eval;
+      return node;
+    }
+
+    // Forms without the shape their builtin expects are given to it,
+    // so that it reports the error
+    node.run = nodes_s::builtin;
+    node.fn = builtin.fn;
+
+    switch (builtin.form) {
+    case forms::form_e::ASSIGN:
+      if (list.size() == 3 && list[1].type() == cell_type_e::SYMBOL &&
+          forms::is_assignable(list[1]->as_symbol_id())) {
+        node.symbol = list[1]->as_symbol_id();
+        node.children.push_back(build(list[2], false, scopes));
+        if (auto address = scopes.resolve(node.symbol)) {
+          node.run = assign_local;
+          node.address = *address;
+        } else {
+          node.run = assign;
+        }
+      }
+      break;
+    case forms::form_e::SET:
+      if (list.size() == 3) {
+        node.run = set;
+        node.children.push_back(build(list[1], true, scopes));
+        node.children.push_back(build(list[2], false, scopes));
+      }
+      break;
+    case forms::form_e::IF:
+      if (list.size() == 3 || list.size() == 4) {
+        auto scoped = resolver::needs_scope(cell->read_list_info());
+        node.run = scoped ? if_form : if_in_place;
+        if (scoped) {
+          node.layout = scopes.enter_scope(list);
+        }
+        node.children.push_back(build(list[1], false, scopes));
+        for (std::size_t n = 2; n < list.size(); n++) {
+          node.children.push_back(build_body(list[n], scopes, position));
+        }
+        if (scoped) {
+          scopes.leave_scope();
+        }
+      }
+      break;
+    case forms::form_e::LOOP:
+      if (list.size() == 5) {
+        auto scoped = resolver::needs_scope(cell->read_list_info());
+        node.run = scoped ? loop : loop_in_place;
+        if (scoped) {
+          node.layout = scopes.enter_scope(list);
+        }
+        node.children.push_back(build(list[1], true, scopes));
+        node.children.push_back(build(list[2], false, scopes));
+        node.children.push_back(build(list[3], true, scopes));
+        node.children.push_back(build_body(list[4], scopes));
+        if (scoped) {
+          scopes.leave_scope();
+        }
+      }
+      break;
+    case forms::form_e::YIELD:
+      if (list.size() == 1) {
+        node.run = yield_zero;
+      } else if (list.size() == 2) {
+        node.run = yield;
+        node.children.push_back(
+            build(list[1], false, scopes,
+                  position == forms::position_e::VALUE
+                      ? forms::position_e::VALUE
+                      : forms::position_e::YIELD));
+      }
+      break;
+    case forms::form_e::ARITHMETIC:
+    case forms::form_e::COMPARISON:
+    case forms::form_e::NOT:
+      // Strings are only added and repeated by the builtin
+      if (forms::has_operands(builtin, list) &&
+          !(builtin.form == forms::form_e::ARITHMETIC &&
+            list[1].type() == cell_type_e::STRING)) {
+        build_operation(builtin, list, node, scopes);
+      }
+      break;
+    default:
+      break;
+    }
+    return node;
+  }
+
+  static void build_operation(const forms::builtin_s &builtin,
+                              const cell_list_t &list, node_s &node,
+                              resolver::scopes_c &scopes) {
+    using op = forms::operation_e;
+
+    // `not` runs a data list given to it
+    if (builtin.form == forms::form_e::NOT) {
+      node.run = negate;
+      node.children.push_back(build_body(list[1], scopes));
+      return;
+    }
+
+    for (std::size_t n = 1; n < list.size(); n++) {
+      node.children.push_back(build(list[n], false, scopes));
+    }
+
+    switch (builtin.operation) {
+    case op::ADD:
+      node.run = arithmetic<op::ADD>;
+      break;
+    case op::SUB:
+      node.run = arithmetic<op::SUB>;
+      break;
+    case op::MUL:
+      node.run = arithmetic<op::MUL>;
+      break;
+    case op::DIV:
+      node.run = arithmetic<op::DIV>;
+      break;
+    case op::MOD:
+      node.run = arithmetic<op::MOD>;
+      break;
+    case op::POW:
+      node.run = arithmetic<op::POW>;
+      break;
+    case op::EQ:
+      node.run = compare<op::EQ>;
+      break;
+    case op::NEQ:
+      node.run = compare<op::NEQ>;
+      break;
+    case op::LT:
+      node.run = compare<op::LT>;
+      break;
+    case op::GT:
+      node.run = compare<op::GT>;
+      break;
+    case op::LTE:
+      node.run = compare<op::LTE>;
+      break;
+    case op::GTE:
+      node.run = compare<op::GTE>;
+      break;
+    case op::AND:
+      node.run = compare<op::AND>;
+      break;
+    case op::OR:
+      node.run = compare<op::OR>;
+      break;
+    case op::NOT:
+      break;
+    }
+  }
+};
+
+const std::shared_ptr<program_s> &runner_c::program_of(lambda_info_s &lambda) {
+  if (!lambda.closure ||
+      lambda.closure->generation != resolver::generation()) {
+    auto program = std::make_shared<program_s>();
+    program->generation = resolver::generation();
+    resolver::scopes_c scopes;
+    scopes.enter_lambda(lambda);
+    program->body =
+        nodes_s::build_body(lambda.body, scopes, forms::position_e::TAIL);
+    if (forms::has_fixed_arguments(lambda)) {
+      program->arity = static_cast<int32_t>(lambda.arg_ids.size());
+    }
+    lambda.closure = std::move(program);
+  }
+  return lambda.closure;
+}
+
+cell_ptr runner_c::run_lambda(lambda_info_s &lambda, env_c &env) {
+  // Held as the body may replace the function it belongs to
+  auto program = program_of(lambda);
+  return nodes_s::evaluate(program->body, {interpreter_, env, env});
+}
+
+} // namespace closure
+} // namespace nibi
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "libnibi/cell.hpp"
+#include "libnibi/environment.hpp"
+
+#include <memory>
+
+/*
+    The closure tier builds the body of a lambda, once, into a tree of
+    nodes that each hold a C++ function and everything about their form
+    that does not change between calls: the bound builtin, the literal
+    values, the symbol ids and the nodes of their arguments. Running a
+    body is then a direct call per node, without going through the
+    type switch of `interpreter_c::process_cell` or looking up the head
+    of each form again.
+
+    Nodes give exactly what the tree walker gives for their cell, down
+    to a yield leaving every node after it with the yielded value.
+    Forms that no node is built for, including the builtins the tier
+    does not run itself, are handed to the interpreter.
+*/
+
+namespace nibi {
+
+class interpreter_c;
+
+namespace closure {
+
+//! \brief The body of a lambda built into closures
+struct program_s;
+
+//! \brief Runs the bodies of lambdas as closures for an interpreter
+//! \note  Calls from built code to lambdas run straight from their
+//!        node, anything else goes back through the interpreter
+class runner_c {
+public:
+  runner_c() = delete;
+
+  //! \brief Create a runner for an interpreter
+  //! \param interpreter The interpreter forms that are not built,
+  //!        the call trace and the yield value belong to
+  runner_c(interpreter_c &interpreter) : interpreter_(interpreter) {}
+
+  //! \brief Run the body of a lambda, building it on its first call
+  //! \param lambda The lambda to run
+  //! \param env The environment holding its arguments
+  //! \return The result of the body, or the value it yielded
+  cell_ptr run_lambda(lambda_info_s &lambda, env_c &env);
+
+private:
+  // The functions nodes run, and the builder choosing them
+  struct nodes_s;
+
+  interpreter_c &interpreter_;
+
+  // Get the built body of a lambda
+  static const std::shared_ptr<program_s> &program_of(lambda_info_s &lambda);
+};
+
+} // namespace closure
+} // namespace nibi
@@ -0,0 +1,121 @@
+#include "forms.hpp"
+
+#include "interpreter/builtins/builtins.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace nibi {
+namespace forms {
+
+builtin_s identify(cell_ref_t head) {
+  if (!head || head.is_immediate() || head->type != cell_type_e::FUNCTION) {
+    return {};
+  }
+
+  auto &info = head->as_function_info();
+  if (info.type != function_type_e::BUILTIN_CPP_FUNCTION) {
+    return {};
+  }
+
+  auto *fn = info.fn.target<builtin_fn_t>();
+  if (!fn) {
+    return {};
+  }
+
+  using namespace builtins;
+  using op = operation_e;
+  static const std::unordered_map<builtin_fn_t, builtin_s> known = {
+      {builtin_fn_env_fn, {form_e::DEFINE}},
+      {builtin_fn_common_macro, {form_e::BIND}},
+      {builtin_fn_env_alias, {form_e::BIND}},
+      {builtin_fn_except_try, {form_e::BIND}},
+      {builtin_fn_common_eval, {form_e::BIND}},
+      {builtin_fn_common_import, {form_e::BIND}},
+      {builtin_fn_common_use, {form_e::BIND}},
+      {builtin_fn_env_assignment, {form_e::ASSIGN}},
+      {builtin_fn_env_set, {form_e::SET}},
+      {builtin_fn_common_if, {form_e::IF}},
+      {builtin_fn_common_loop, {form_e::LOOP}},
+      {builtin_fn_common_yield, {form_e::YIELD}},
+      {builtin_fn_arithmetic_add, {form_e::ARITHMETIC, op::ADD}},
+      {builtin_fn_arithmetic_sub, {form_e::ARITHMETIC, op::SUB}},
+      {builtin_fn_arithmetic_mul, {form_e::ARITHMETIC, op::MUL}},
+      {builtin_fn_arithmetic_div, {form_e::ARITHMETIC, op::DIV}},
+      {builtin_fn_arithmetic_mod, {form_e::ARITHMETIC, op::MOD}},
+      {builtin_fn_arithmetic_pow, {form_e::ARITHMETIC, op::POW}},
+      {builtin_fn_comparison_eq, {form_e::COMPARISON, op::EQ}},
+      {builtin_fn_comparison_neq, {form_e::COMPARISON, op::NEQ}},
+      {builtin_fn_comparison_lt, {form_e::COMPARISON, op::LT}},
+      {builtin_fn_comparison_gt, {form_e::COMPARISON, op::GT}},
+      {builtin_fn_comparison_lte, {form_e::COMPARISON, op::LTE}},
+      {builtin_fn_comparison_gte, {form_e::COMPARISON, op::GTE}},
+      {builtin_fn_comparison_and, {form_e::COMPARISON, op::AND}},
+      {builtin_fn_comparison_or, {form_e::COMPARISON, op::OR}},
+      {builtin_fn_comparison_not, {form_e::NOT, op::NOT}},
+  };
+
+  builtin_s result;
+  if (auto it = known.find(*fn); it != known.end()) {
+    result = it->second;
+  }
+  result.fn = *fn;
+  return result;
+}
+
+bool is_assignable(const symbol_id_t id) {
+  auto &name = symbols::name_of(id);
+  return name.empty() || (name[0] != '$' && name[0] != ':');
+}
+
+bool has_fixed_arguments(const lambda_info_s &lambda) {
+  static const symbol_id_t variadic_args_id = symbols::intern(":args");
+  if (lambda.arg_ids.size() == 1 && lambda.arg_ids[0] == variadic_args_id) {
+    return false;
+  }
+  auto &ids = lambda.arg_ids;
+  for (auto it = ids.begin(); it != ids.end(); ++it) {
+    if (!is_assignable(*it) || std::find(ids.begin(), it, *it) != it) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const cell_list_t *instruction_list(cell_ref_t cell) {
+  if (!cell || cell.is_immediate() || cell->type != cell_type_e::LIST) {
+    return nullptr;
+  }
+  auto &info = cell->read_list_info();
+  if (info.type != list_types_e::INSTRUCTION || info.list.empty()) {
+    return nullptr;
+  }
+  return &info.list;
+}
+
+const cell_list_t *body_list(cell_ref_t cell) {
+  if (!cell || cell.is_immediate() || cell->type != cell_type_e::LIST) {
+    return nullptr;
+  }
+  auto &info = cell->read_list_info();
+  if (info.type != list_types_e::DATA || info.list.empty()) {
+    return nullptr;
+  }
+  return &info.list;
+}
+
+bool has_operands(const builtin_s &builtin, const cell_list_t &list) {
+  switch (builtin.form) {
+  case form_e::ARITHMETIC:
+    return list.size() >= 2;
+  case form_e::COMPARISON:
+    return list.size() == 3;
+  case form_e::NOT:
+    return list.size() == 2;
+  default:
+    return false;
+  }
+}
+
+} // namespace forms
+} // namespace nibi
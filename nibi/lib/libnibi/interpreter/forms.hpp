@@ -0,0 +1,101 @@
+#pragma once
+
+#include "libnibi/cell.hpp"
+#include "libnibi/environment.hpp"
+#include "libnibi/interfaces/cell_processor_if.hpp"
+#include "libnibi/symbols.hpp"
+
+#include <cstdint>
+
+/*
+    What the compiled tiers (interpreter/vm and interpreter/closure)
+    need to know about parsed forms. Builtins are special forms that
+    evaluate their own arguments, so a tier can only run the ones it
+    knows the meaning of itself, and calls the rest as the tree walker
+    would.
+*/
+
+namespace nibi {
+namespace forms {
+
+//! \brief The signature of builtin functions
+using builtin_fn_t = cell_ptr (*)(cell_processor_if &, cell_list_t &,
+                                  env_c &);
+
+//! \brief Builtins the compiled tiers run themselves, or need to
+//!        know the meaning of
+enum class form_e {
+  OTHER,
+  DEFINE, // `fn`, which binds in the environment it runs in
+  BIND,   // Others that may, such as `macro`, `alias`, `try` or `eval`
+  ASSIGN,
+  SET,
+  IF,
+  LOOP,
+  YIELD,
+  ARITHMETIC,
+  COMPARISON,
+  NOT,
+};
+
+//! \brief Where a form is in the body of a lambda. A call to a lambda
+//!        whose value is that of the body takes the place of the frame
+//!        that makes it, see interpreter_c::run_tail_calls
+enum class position_e {
+  VALUE,     // Its value is used
+  STATEMENT, // Its value is not used, unless it yields
+  TAIL,      // Its value is that of the body
+  YIELD,     // Its value is yielded, so is that of the body once copied
+};
+
+//! \brief Operations with fast paths for I64 and F64 operands, see
+//!        numeric.hpp
+enum class operation_e : uint8_t {
+  ADD,
+  SUB,
+  MUL,
+  DIV,
+  MOD,
+  POW,
+  EQ,
+  NEQ,
+  LT,
+  GT,
+  LTE,
+  GTE,
+  AND,
+  OR,
+  NOT,
+};
+
+//! \brief A builtin at the head of a form
+struct builtin_s {
+  form_e form{form_e::OTHER};
+  operation_e operation{operation_e::ADD};
+  builtin_fn_t fn{nullptr}; // nullptr if the head is not a builtin
+};
+
+//! \brief Find out which builtin, if any, the head of a form calls
+extern builtin_s identify(cell_ref_t head);
+
+//! \brief Check that a name may be bound, as NIBI_VALIDATE_VAR_NAME does
+extern bool is_assignable(const symbol_id_t id);
+
+//! \brief Check that every argument of a lambda can be bound by a
+//!        compiled call to a slot of its own, which is not so for
+//!        variadic lambdas or repeated names
+extern bool has_fixed_arguments(const lambda_info_s &lambda);
+
+//! \brief Get the list of an instruction, if the cell is one
+extern const cell_list_t *instruction_list(cell_ref_t cell);
+
+//! \brief Get the items of a data list that is run as a body, if the
+//!        cell is a data list with items
+extern const cell_list_t *body_list(cell_ref_t cell);
+
+//! \brief Check that an arithmetic, comparison or `not` form has the
+//!        number of arguments its builtin takes
+extern bool has_operands(const builtin_s &builtin, const cell_list_t &list);
+
+} // namespace forms
+} // namespace nibi
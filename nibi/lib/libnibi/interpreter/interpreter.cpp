@@ -1,8 +1,23 @@
 #include "interpreter.hpp"
 
+#include "interpreter/builtins/builtins.hpp"
+#include "libnibi/alloc_profiler.hpp"
+#include "libnibi/collector.hpp"
+#include "libnibi/heap.hpp"
+#include "libnibi/interpreter/forms.hpp"
+#include "libnibi/interpreter/resolver.hpp"
 #include "libnibi/platform.hpp"
 #include "libnibi/rang.hpp"
 
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+
 #if PROFILE_INTERPRETER
 #include <chrono>
 #include <iostream>
@@ -10,6 +25,45 @@
 
 namespace nibi {
 
+namespace {
+
+// The lowest address the native stack of the calling thread may reach
+// while leaving NIBI_STACK_RESERVE bytes free, 0 if it can not be found
+std::uintptr_t find_stack_floor() {
+  std::uintptr_t lowest{0};
+#if defined(__linux__)
+  pthread_attr_t attr;
+  if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+    void *address{nullptr};
+    std::size_t size{0};
+    if (pthread_attr_getstack(&attr, &address, &size) == 0) {
+      lowest = reinterpret_cast<std::uintptr_t>(address);
+    }
+    pthread_attr_destroy(&attr);
+  }
+#elif defined(__APPLE__)
+  auto self = pthread_self();
+  lowest = reinterpret_cast<std::uintptr_t>(pthread_get_stackaddr_np(self)) -
+           pthread_get_stacksize_np(self);
+#endif
+  return lowest ? lowest + config::NIBI_STACK_RESERVE : 0;
+}
+
+// How deeply calls nest is counted, but the native stack each takes
+// varies with the tier and the build, so what is left is checked too
+bool is_stack_exhausted() {
+  static thread_local const std::uintptr_t floor = find_stack_floor();
+#if defined(__GNUC__) || defined(__clang__)
+  auto here = reinterpret_cast<std::uintptr_t>(__builtin_frame_address(0));
+#else
+  char marker;
+  auto here = reinterpret_cast<std::uintptr_t>(&marker);
+#endif
+  return here < floor;
+}
+
+} // namespace
+
 interpreter_c::interpreter_c(env_c &env, source_manager_c &source_manager)
     : interpreter_env(env), source_manager_(source_manager),
       modules_(source_manager, *this) {
@@ -33,18 +87,79 @@ interpreter_c::~interpreter_c() {
 #endif
 }
 
+void interpreter_c::set_memory_budget(const std::size_t bytes) {
+  memory_limit_ = bytes ? heap::get_stats().live_bytes + bytes : 0;
+  host_memory_limit_ = memory_limit_;
+}
+
+std::size_t interpreter_c::limit_memory(const std::size_t bytes) {
+  auto limit = bytes ? heap::get_stats().live_bytes + bytes : 0;
+  if (host_memory_limit_ && (!limit || limit > host_memory_limit_)) {
+    limit = host_memory_limit_;
+  }
+  memory_limit_ = limit;
+  apply_memory_limit();
+  return memory_available();
+}
+
+std::size_t interpreter_c::memory_available() {
+  auto limit = heap::get_limit();
+  auto live = heap::get_stats().live_bytes;
+  return limit > live ? limit - live : 0;
+}
+
+void interpreter_c::apply_memory_limit() {
+  auto limit = outer_memory_limit_;
+  if (memory_limit_ && (!limit || memory_limit_ < limit)) {
+    limit = memory_limit_;
+  }
+  heap::set_limit(limit);
+}
+
 void interpreter_c::instruction_ind(cell_ptr &cell) {
+  // The limit around the outermost instruction is given back when it
+  // is done. Instructions may run others, as `import` does
+  struct memory_scope_s {
+    interpreter_c &interpreter;
+    memory_scope_s(interpreter_c &interpreter) : interpreter(interpreter) {
+      if (!interpreter.running_instructions_++) {
+        interpreter.outer_memory_limit_ = heap::get_limit();
+        interpreter.apply_memory_limit();
+      }
+    }
+    ~memory_scope_s() {
+      if (!--interpreter.running_instructions_) {
+        heap::set_limit(interpreter.outer_memory_limit_);
+      }
+    }
+  } memory_scope(*this);
   try {
     // We can ignore the return value because
     // at this level nothing would be returned
     last_result_ = handle_list_cell(cell, interpreter_env, false);
   } catch (interpreter_c::exception_c &error) {
-    halt_with_error(error_c(error.get_source_location(), error.what()));
+    halt_with_error(
+        error_c(locate(error.get_source_location(), cell), error.what()));
   } catch (cell_access_exception_c &error) {
-    halt_with_error(error_c(error.get_source_location(), error.what()));
+    halt_with_error(
+        error_c(locate(error.get_source_location(), cell), error.what()));
   } catch (std::exception &error) {
-    halt_with_error(error_c(cell->locator, error.what()));
+    halt_with_error(error_c(locate(nullptr, cell), error.what()));
+  }
+}
+
+locator_ptr interpreter_c::locate(locator_ptr location, cell_ref_t cell) {
+  if (location) {
+    return location;
   }
+  // Literals are immediates and have no location of their own, so
+  // errors about them are reported at the call that was running
+  if (!call_stack_.empty()) {
+    if (auto running = call_stack_.top()->locator()) {
+      return running;
+    }
+  }
+  return cell->locator();
 }
 
 void interpreter_c::halt_with_error(error_c error) {
@@ -69,10 +184,10 @@ void interpreter_c::halt_with_error(error_c error) {
     std::cout << ">>> " << rang::fg::cyan << top_cell->to_string(true, true)
               << rang::fg::reset;
 
-    if (top_cell->locator) {
-      std::cout << " in " << top_cell->locator->get_source_name() << ":("
-                << top_cell->locator->get_line() << ":"
-                << top_cell->locator->get_column() << ")";
+    if (top_cell->locator()) {
+      std::cout << " in " << top_cell->locator()->get_source_name() << ":("
+                << top_cell->locator()->get_line() << ":"
+                << top_cell->locator()->get_column() << ")";
     } else {
       std::cout << " in <location unknown>";
     }
@@ -85,50 +200,342 @@ void interpreter_c::halt_with_error(error_c error) {
   std::exit(1);
 }
 
-cell_ptr interpreter_c::process_cell(cell_ptr cell, env_c &env,
+cell_ptr interpreter_c::process_cell(cell_ref_t cell, env_c &env,
                                      const bool process_data_list) {
 
   if (yield_value_) {
     return yield_value_;
   }
 
+  if (--safe_point_countdown_ == 0) {
+    handle_safe_point();
+  }
+
+  // Immediates are already values, there is nothing to load
+  if (cell.is_immediate()) {
+    return cell;
+  }
+
   if (!cell) {
     return allocate_cell(cell_type_e::NIL);
   }
 
   switch (cell->type) {
   case cell_type_e::LIST: {
-    return std::move(handle_list_cell(cell, env, process_data_list));
+    return handle_list_cell(cell, env, process_data_list);
   }
   case cell_type_e::ALIAS:
     return cell->get_alias();
   case cell_type_e::SYMBOL: {
     // Load the symbol from the environment
-    auto loaded_cell = env.get(cell->as_symbol());
+    auto loaded_cell = env.get(cell->as_symbol_id());
     if (!loaded_cell) {
 
       const std::string error =
           "Symbol not found in environment: " + cell->as_symbol();
-      throw exception_c(error, cell->locator);
+      throw exception_c(error, cell->locator());
       return nullptr;
     }
+    return loaded_cell;
+  }
+  default: {
+    return cell;
+  }
+  }
+  return nullptr;
+}
 
-    // Cache the cell so we don't load it again later (potentially)
-    cell = loaded_cell;
+cell_ref_t interpreter_c::borrow_cell(cell_ref_t cell, env_c &env,
+                                      cell_ptr &storage) {
+  if (yield_value_) {
+    return yield_value_;
+  }
+
+  if (cell.is_immediate()) {
+    return cell;
+  }
 
-    [[fallthrough]];
+  // Values and symbols can be read where they are, anything
+  // else has to run and its result is held by the caller
+  if (cell) {
+    switch (cell->type) {
+    case cell_type_e::LIST:
+    case cell_type_e::ALIAS:
+      break;
+    case cell_type_e::SYMBOL: {
+      // Unlike `process_cell` this does not box the value, so
+      // it can not be updated through the result
+      if (auto *loaded_cell = env.find(cell->as_symbol_id())) {
+        return *loaded_cell;
+      }
+      break;
+    }
+    default:
+      return cell;
+    }
   }
+
+  storage = process_cell(cell, env);
+  return storage;
+}
+
+interpreter_c::call_frame_c::call_frame_c(interpreter_c &interpreter)
+    : interpreter_(interpreter) {
+  auto limit = interpreter.max_call_depth_;
+  auto &stack = interpreter.call_stack_;
+  if (limit && interpreter.call_depth_ >= limit) {
+    throw exception_c("Maximum call depth of " + std::to_string(limit) +
+                          " exceeded",
+                      stack.empty() ? nullptr : stack.top()->locator());
+  }
+  if (is_stack_exhausted()) {
+    throw exception_c("Native stack exhausted after " +
+                          std::to_string(interpreter.call_depth_) +
+                          " nested calls",
+                      stack.empty() ? nullptr : stack.top()->locator());
+  }
+  interpreter.call_depth_++;
+}
+
+cell_ptr interpreter_c::process_lambda(lambda_info_s &lambda, env_c &env) {
+  call_frame_c call_frame(*this);
+  auto result = run_body(lambda, env);
+  if (tail_call_.function) {
+    return run_tail_calls(env);
+  }
+  return result;
+}
+
+bool interpreter_c::needs_scope(const cell_list_t &list) {
+  // Builtins may be called with lists that are not in an instruction
+  if (!instruction_ || &instruction_->list != &list) {
+    return true;
+  }
+  return resolver::needs_scope(*instruction_);
+}
+
+cell_ptr interpreter_c::run_body(lambda_info_s &lambda, env_c &env) {
+  switch (tier_) {
+  case execution_tier_e::BYTECODE:
+    return vm_.run_lambda(lambda, env);
+  case execution_tier_e::CLOSURE:
+    return closures_.run_lambda(lambda, env);
   default: {
-    return std::move(cell);
+    cell_ptr body = lambda.body;
+    return process_tail(body, env, env, true, true);
   }
   }
-  return nullptr;
 }
 
-inline bool considered_private(cell_ptr &cell) {
+cell_ptr interpreter_c::run_tail_calls(env_c &env) {
+  // The environment of a call is emptied for the next one, unless
+  // a function made during the call refers to it
+  std::unique_ptr<env_c> frame;
+  std::vector<std::unique_ptr<env_c>> kept;
+  auto clone = false;
+  cell_ptr result;
+
+  while (tail_call_.function) {
+    // Held as the body may replace the function it belongs to
+    auto function = std::move(tail_call_.function);
+    auto head = std::move(tail_call_.head);
+    clone = clone || tail_call_.clone;
+    tail_call_.clone = false;
+    yield_value_ = nullptr;
+
+    auto &info = function->as_function_info();
+    auto &lambda = *info.lambda;
+    if (frame && frame->is_captured()) {
+      kept.push_back(std::move(frame));
+    }
+    if (frame) {
+      frame->reset(info.operating_env, lambda.frame_layout);
+    } else {
+      frame = std::make_unique<env_c>(info.operating_env, lambda.frame_layout);
+    }
+    builtins::bind_lambda_arguments(lambda, tail_call_.arguments, *frame);
+    tail_call_.arguments.clear();
+
+    call_stack_.push(head);
+    {
+      alloc_profiler::frame_c profiler_frame(*head);
+      result = run_body(lambda, *frame);
+    }
+    call_stack_.pop();
+
+    if (--safe_point_countdown_ == 0) {
+      handle_safe_point();
+    }
+  }
+
+  return clone ? result.clone(env) : result;
+}
+
+cell_ptr interpreter_c::process_tail(cell_ref_t cell, env_c &env,
+                                     env_c &frame, const bool body,
+                                     const bool tail) {
+  if (yield_value_) {
+    return yield_value_;
+  }
+
+  if (!cell || cell.is_immediate() || cell->type != cell_type_e::LIST) {
+    return process_cell(cell, env, body);
+  }
+
+  auto &info =
+      cell->is_frozen() ? cell->read_list_info() : cell->as_list_info();
+  auto &list = info.list;
+  if (list.empty()) {
+    return process_cell(cell, env, body);
+  }
+
+  // Each item of a body is run in turn, the last in the position of
+  // the body itself
+  if (info.type == list_types_e::DATA) {
+    if (!body) {
+      return process_cell(cell, env);
+    }
+    cell_ptr last_result = allocate_cell(cell_type_e::NIL);
+    for (std::size_t n = 0; n < list.size(); n++) {
+      last_result = process_tail(list[n], env, frame, false,
+                                 tail && n + 1 == list.size());
+      if (yield_value_) {
+        return yield_value_;
+      }
+    }
+    return last_result;
+  }
+
+  if (info.type != list_types_e::INSTRUCTION) {
+    return process_cell(cell, env, body);
+  }
+
+  auto &head = list.front();
+  if (head.type() == cell_type_e::SYMBOL) {
+    return tail ? leave_tail_call(cell, env, frame) : process_cell(cell, env);
+  }
+
+  // The branches of an `if` are in its position, and a yield ends the
+  // frame with the value of its argument. Both run as their builtins do
+  switch (forms::identify(head).form) {
+  case forms::form_e::IF: {
+    if (list.size() != 3 && list.size() != 4) {
+      break;
+    }
+    call_stack_.push(head);
+    alloc_profiler::frame_c profiler_frame(*head);
+    std::optional<env_c> scope;
+    auto &if_env = resolver::needs_scope(info) ? scope.emplace(&env) : env;
+
+    cell_ptr result;
+    cell_ptr held;
+    if (borrow_cell(list[1], if_env, held).as_integer() > 0) {
+      result = process_tail(list[2], if_env, frame, true, tail);
+    } else if (list.size() == 4) {
+      result = process_tail(list[3], if_env, frame, true, tail);
+    } else {
+      result = last_result_;
+    }
+    call_stack_.pop();
+    return result;
+  }
+  case forms::form_e::YIELD: {
+    if (list.size() != 2 || !forms::instruction_list(list[1])) {
+      break;
+    }
+    call_stack_.push(head);
+    alloc_profiler::frame_c profiler_frame(*head);
+    auto value = process_tail(list[1], env, frame, false, true);
+    if (tail_call_.function) {
+      tail_call_.clone = true;
+      value = allocate_cell(cell_type_e::NIL);
+    } else {
+      value = value.clone(env);
+    }
+    yield_value_ = value;
+    call_stack_.pop();
+    return value;
+  }
+  default:
+    break;
+  }
+
+  return process_cell(cell, env, body);
+}
+
+cell_ptr interpreter_c::leave_tail_call(cell_ref_t cell, env_c &env,
+                                        env_c &frame) {
+  auto &call = cell->as_list_info();
+  auto &list = call.list;
+  auto *found = env.find(list.front()->as_symbol_id(), call.cache);
+  if (!found || !*found || found->is_immediate() ||
+      (*found)->type != cell_type_e::FUNCTION) {
+    return process_cell(cell, env);
+  }
+
+  auto &info = (*found)->as_function_info();
+  if (info.type != function_type_e::LAMBDA_FUNCTION || !info.lambda) {
+    return process_cell(cell, env);
+  }
+
+  // Held as the arguments may replace the function
+  cell_ptr function = *found;
+  cell_list_t arguments;
+  builtins::evaluate_lambda_arguments(*this, *info.lambda, list, env,
+                                      arguments);
+
+  // A yield in the arguments is the value of the call, as the
+  // body would give it back without running
+  if (yield_value_) {
+    auto value = std::move(yield_value_);
+    yield_value_ = nullptr;
+    return value;
+  }
+
+  tail_call_.function = std::move(function);
+  tail_call_.head = list.front();
+  tail_call_.arguments = std::move(arguments);
+
+  // A function made in a scope of the frame may refer to it, so
+  // the call is made before the scope ends
+  if (env.is_captured_below(frame)) {
+    call_frame_c call_frame(*this);
+    return run_tail_calls(env);
+  }
+  return allocate_cell(cell_type_e::NIL);
+}
+
+cell_ptr interpreter_c::apply_builtin(cell_ref_t builtin,
+                                      const cell_ptr *operands,
+                                      const std::size_t count, env_c &env) {
+  // Builtins evaluate their own arguments, an alias
+  // evaluates to the cell it holds
+  cell_list_t list;
+  list.push_back(builtin);
+  for (std::size_t n = 0; n < count; n++) {
+    list.push_back(allocate_cell(alias_s{operands[n]}));
+  }
+
+  call_stack_.push(builtin);
+  alloc_profiler::frame_c profiler_frame(*builtin);
+  auto result = builtin->as_function_info().fn(*this, list, env);
+  call_stack_.pop();
+  return result;
+}
+
+void interpreter_c::handle_safe_point() {
+  safe_point_countdown_ = config::NIBI_SAFE_POINT_INTERVAL;
+
+  // Every cell in use is held by a counted reference here
+  // (environments, the call stack, or a builtin's locals)
+  // so trial deletion can not mistake one for garbage
+  collector::run_safe_point();
+}
+
+inline bool considered_private(cell_ref_t cell) {
   switch (cell->type) {
   case cell_type_e::SYMBOL: {
-    return cell->as_symbol().starts_with("_");
+    return cell->as_string_view().starts_with("_");
   }
   case cell_type_e::FUNCTION: {
     return cell->as_function_info().name.starts_with("_");
@@ -140,14 +547,18 @@ inline bool considered_private(cell_ptr &cell) {
   return false;
 }
 
-inline cell_ptr interpreter_c::handle_list_cell(cell_ptr &cell, env_c &env,
+inline cell_ptr interpreter_c::handle_list_cell(cell_ref_t cell, env_c &env,
                                                 bool process_data_list) {
-  auto &list = cell->as_list();
+  // Frozen lists can be read but not written, which is
+  // all that the data and access paths below do
+  auto &info =
+      cell->is_frozen() ? cell->read_list_info() : cell->as_list_info();
+  auto &list = info.list;
   if (!list.size()) {
-    return std::move(cell);
+    return cell;
   }
 
-  switch (cell->as_list_info().type) {
+  switch (info.type) {
   case list_types_e::DATA: {
     if (process_data_list) {
       cell_ptr last_result = allocate_cell(cell_type_e::NIL);
@@ -166,41 +577,51 @@ inline cell_ptr interpreter_c::handle_list_cell(cell_ptr &cell, env_c &env,
     // and directing us through environments to a final cell value
     auto it = list.begin();
     auto *current_env = &env;
-    cell_ptr result = allocate_cell(cell_type_e::NIL);
+    cell_ptr result;
     for (std::size_t i = 0; i < list.size() - 1; i++) {
       result = process_cell(*it, *current_env);
       if (result->type == cell_type_e::ENVIRONMENT) {
         current_env = result->as_environment_info().env.get();
         if (considered_private(result) && i != 0) {
-          halt_with_error(error_c(cell->locator,
+          halt_with_error(error_c(cell->locator(),
                                   "Private members can only be accessed "
                                   "from the root of an access list"));
         }
         std::advance(it, 1);
         continue;
       }
-      halt_with_error(error_c(cell->locator,
+      halt_with_error(error_c(cell->locator(),
                               "Each member up-to the end of an access list "
                               "must be an environment"));
     }
     if (considered_private((*it))) {
-      halt_with_error(error_c(cell->locator,
+      halt_with_error(error_c(cell->locator(),
                               "Private members can only be accessed from "
                               "the root of an access list"));
     }
 
-    cell = process_cell(*it, *current_env);
-    return std::move(cell);
+    return process_cell(*it, *current_env);
   }
   case list_types_e::INSTRUCTION: {
     // All lists' first item should be a function of some sort,
-    // so we recurse to either load
-    auto operation = list.front();
+    // so we recurse to either load. The operation is held for
+    // the call as the function may replace its own definition
+    auto &call = cell->as_list_info();
+    auto &list = call.list;
+    cell_ptr operation = list.front();
     if (operation->type == cell_type_e::SYMBOL) {
 
-      // If the operation is a symbol then we need to
-      // look it up in the environment
-      operation = process_cell(std::move(operation), env);
+      // If the operation is a symbol then we need to look it up in
+      // the environment. The list caches where it was found, so the
+      // environment that holds it is not searched again until that
+      // one changes
+      auto *found = env.find(operation->as_symbol_id(), call.cache);
+      if (found && *found) {
+        found->box();
+        operation = *found;
+      } else {
+        operation = process_cell(operation, env);
+      }
     }
 
     if (operation->type == cell_type_e::ALIAS) {
@@ -215,21 +636,23 @@ inline cell_ptr interpreter_c::handle_list_cell(cell_ptr &cell, env_c &env,
       list.front() = operation;
     }
 
-    auto fn_info = operation->as_function_info();
+    // Only the callable is copied, the rest of the function info
+    // is read by the callee through the cell
+    auto &fn_info = operation->as_function_info();
+    auto fn = fn_info.fn;
 
     call_stack_.push(list.front());
+    alloc_profiler::frame_c profiler_frame(*list.front());
+    instruction_ = &call;
 
 #if PROFILE_INTERPRETER
-    if (fn_call_data_.find(fn_info.name) == fn_call_data_.end()) {
-      fn_call_data_[fn_info.name] = {0, 0};
-    }
+    auto &t = fn_call_data_[fn_info.name];
     auto start = std::chrono::high_resolution_clock::now();
-    auto value = fn_info.fn(*this, list, env);
+    auto value = fn(*this, list, env);
     auto end = std::chrono::high_resolution_clock::now();
     auto duration =
         std::chrono::duration_cast<std::chrono::microseconds>(end - start)
             .count();
-    auto &t = fn_call_data_[fn_info.name];
     t.time += duration;
     t.calls++;
 
@@ -238,17 +661,17 @@ inline cell_ptr interpreter_c::handle_list_cell(cell_ptr &cell, env_c &env,
 #else
     // All functions point to a `cell_fn_t`, even lambda functions
     // so we can just call the function and return the result
-    auto value = fn_info.fn(*this, list, env);
+    auto value = fn(*this, list, env);
 
     call_stack_.pop();
-    return std::move(value);
+    return value;
 #endif
   }
   }
 
   // If we get here then we have a list that is not a function
   // so we return it as is
-  return std::move(cell);
+  return cell;
 }
 
 void interpreter_c::load_module(cell_ptr &module_name) {
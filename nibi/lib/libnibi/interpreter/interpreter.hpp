@@ -2,13 +2,18 @@
 
 #include "libnibi/RLL/rll_wrapper.hpp"
 #include "libnibi/cell.hpp"
+#include "libnibi/config.hpp"
 #include "libnibi/environment.hpp"
 #include "libnibi/error.hpp"
+#include "libnibi/execution.hpp"
 #include "libnibi/interfaces/cell_processor_if.hpp"
 #include "libnibi/interfaces/instruction_processor_if.hpp"
 #include "libnibi/modules.hpp"
 #include "libnibi/source.hpp"
 
+#include "libnibi/interpreter/closure/closure.hpp"
+#include "libnibi/interpreter/vm/vm.hpp"
+
 #include <stack>
 
 #define PROFILE_INTERPRETER 0
@@ -55,13 +60,53 @@ public:
   //!       expression, and not exit on exception
   inline void indicate_repl() { repl_mode_ = true; };
 
+  //! \brief Limit the memory the interpreter may take while it runs
+  //! \param bytes The bytes that may be held on top of those held
+  //!        now, 0 removes the limit
+  //! \note  Going over throws an exception_c, which `try` can catch.
+  //!        The limit is kept by the thread running the interpreter
+  //!        (see heap.hpp) and covers everything it holds while the
+  //!        interpreter runs. The program can tighten it, but not
+  //!        raise or remove it, see limit_memory
+  void set_memory_budget(const std::size_t bytes);
+
+  //! \brief Choose how the bodies of lambdas are run
+  //! \note  Takes effect from the next call of each lambda
+  inline void set_execution_tier(const execution_tier_e tier) {
+    tier_ = tier;
+  }
+
+  //! \brief Limit how deeply lambda calls may nest
+  //! \param depth The calls that may be running at once, 0 removes
+  //!        the limit
+  //! \note  Going over throws an exception_c, which `try` can catch.
+  //!        Calls in tail position take the place of the call that
+  //!        made them, so they do not count. Whatever the limit, a
+  //!        call that would leave less than config::NIBI_STACK_RESERVE
+  //!        bytes of native stack free throws the same way
+  inline void set_max_call_depth(const std::size_t depth) {
+    max_call_depth_ = depth;
+  }
+
   // From instruction_processor_if
   void instruction_ind(cell_ptr &cell) override;
 
   // From cell_processor_if
-  virtual cell_ptr process_cell(cell_ptr instruction, env_c &env,
+  virtual cell_ptr process_cell(cell_ref_t instruction, env_c &env,
                                 const bool process_data_cell = false) override;
 
+  virtual cell_ref_t borrow_cell(cell_ref_t instruction, env_c &env,
+                                 cell_ptr &storage) override;
+
+  virtual cell_ptr process_lambda(lambda_info_s &lambda,
+                                  env_c &env) override;
+
+  virtual std::size_t limit_memory(const std::size_t bytes) override;
+
+  virtual std::size_t memory_available() override;
+
+  virtual bool needs_scope(const cell_list_t &list) override;
+
   virtual void set_yield_value(cell_ptr value) override {
     yield_value_ = value;
   }
@@ -81,6 +126,10 @@ public:
   virtual env_c &get_env() override { return interpreter_env; }
 
 private:
+  // Compiled code reads and updates the interpreter state directly
+  friend class vm::vm_c;
+  friend class closure::runner_c;
+
   // The last item that was processed
   cell_ptr last_result_{nullptr};
 
@@ -97,17 +146,105 @@ private:
   // The yield value
   cell_ptr yield_value_{nullptr};
 
+  // The instruction whose builtin was called last, which the builtin
+  // may find what is cached about its form in
+  const list_info_s *instruction_{nullptr};
+
   // Handle a list cell
-  cell_ptr handle_list_cell(cell_ptr &cell, env_c &env, bool process_data_cell);
+  cell_ptr handle_list_cell(cell_ref_t cell, env_c &env,
+                            bool process_data_cell);
 
   // Indicates if we are in repl mode
   bool repl_mode_{false};
 
+  // Live bytes the thread may hold while running, 0 if unlimited.
+  // The host sets both, the program may only lower the first
+  std::size_t memory_limit_{0};
+  std::size_t host_memory_limit_{0};
+
+  // The limit of the thread around the instructions being run, which
+  // the interpreter's own only ever tightens
+  std::size_t outer_memory_limit_{0};
+  std::size_t running_instructions_{0};
+
+  // Give the thread the tighter of the interpreter's limit and the
+  // one around it
+  void apply_memory_limit();
+
   // Halt the interpreter with an error
   void halt_with_error(error_c error);
 
+  // The location to report an error at, that of the call being run
+  // (or else the instruction) when it was raised without one
+  locator_ptr locate(locator_ptr location, cell_ref_t cell);
+
   std::stack<cell_ptr> call_stack_;
 
+  // Lambda calls running, and how many may be
+  std::size_t call_depth_{0};
+  std::size_t max_call_depth_{config::NIBI_MAX_CALL_DEPTH};
+
+  // Counts a lambda call for as long as it runs
+  class call_frame_c {
+  public:
+    call_frame_c(interpreter_c &interpreter);
+    ~call_frame_c() { interpreter_.call_depth_--; }
+
+  private:
+    interpreter_c &interpreter_;
+  };
+
+  // A call in tail position, which the frame making it leaves for its
+  // caller to make in its place, see run_tail_calls
+  struct tail_call_s {
+    cell_ptr function;
+    cell_ptr head; // For the call trace
+    cell_list_t arguments;
+    bool clone{false}; // Made by a yield, which gives a copy
+  };
+  tail_call_s tail_call_;
+
+  // Run the body of a lambda as the tier does
+  cell_ptr run_body(lambda_info_s &lambda, env_c &env);
+
+  // Make the tail call left by a frame, and those left by the calls it
+  // makes in turn, reusing a single environment where it is not
+  // captured. `env` is the environment of the frame that left it
+  cell_ptr run_tail_calls(env_c &env);
+
+  // Run a cell as process_cell does, with `body` set as the data list
+  // flag. Where `tail` is set the value is that of the lambda running
+  // in `frame`, so a call to a lambda is left as a tail call. The
+  // argument of a yield always is, whether `tail` is set or not
+  cell_ptr process_tail(cell_ref_t cell, env_c &env, env_c &frame,
+                        const bool body, const bool tail);
+
+  // Leave a call to a lambda as the tail call, returning nil. A call
+  // to anything else, or one that may not outlive the scopes it was
+  // made in, is made now and gives its value
+  cell_ptr leave_tail_call(cell_ref_t cell, env_c &env, env_c &frame);
+
+  // Calls to process_cell left until the next safe point, where
+  // background memory work (cycle collection) is allowed to run
+  uint32_t safe_point_countdown_{config::NIBI_SAFE_POINT_INTERVAL};
+
+  // Run whatever memory work is due
+  void handle_safe_point();
+
+  // How lambda bodies are run
+  execution_tier_e tier_{execution_tier_e::BYTECODE};
+
+  // Runs lambda bodies for the BYTECODE tier
+  vm::vm_c vm_{*this};
+
+  // Runs lambda bodies for the CLOSURE tier
+  closure::runner_c closures_{*this};
+
+  // Call a builtin with arguments the compiled tiers have already
+  // evaluated
+  cell_ptr apply_builtin(cell_ref_t builtin, const cell_ptr *operands,
+                         const std::size_t count, env_c &env);
+
 #if PROFILE_INTERPRETER
   struct profile_info_s {
     int64_t calls{0};
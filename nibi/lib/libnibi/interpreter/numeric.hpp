@@ -0,0 +1,149 @@
+#pragma once
+
+#include "libnibi/cell.hpp"
+#include "libnibi/interpreter/forms.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+/*
+    Fast paths of the arithmetic and comparison builtins for I64 and
+    F64 operands, used by the compiled tiers. Each gives the result the
+    builtin would, and returns false for anything it does not handle so
+    the caller can hand the operands to the builtin instead.
+*/
+
+namespace nibi {
+namespace numeric {
+
+using forms::operation_e;
+
+//! \brief Check for a value the fast paths handle
+inline bool is_number(cell_ref_t cell) {
+  auto type = cell.type();
+  return type == cell_type_e::I64 || type == cell_type_e::F64;
+}
+
+template <typename T> inline T convert(cell_ref_t cell);
+template <> inline int64_t convert(cell_ref_t cell) {
+  return cell.to_integer();
+}
+template <> inline double convert(cell_ref_t cell) { return cell.to_double(); }
+
+//! \brief Fold the operands as the arithmetic builtins do
+//! \return false on division by zero, which the builtin reports
+template <operation_e Op, typename T>
+inline bool fold(const cell_ptr *operands, const std::size_t count,
+                 T &accumulate) {
+  accumulate = convert<T>(operands[0]);
+  if constexpr (Op == operation_e::SUB) {
+    if (count == 1) {
+      accumulate = 0 - accumulate;
+      return true;
+    }
+  }
+  for (std::size_t i = 1; i < count; i++) {
+    T value = convert<T>(operands[i]);
+    if constexpr (Op == operation_e::ADD) {
+      accumulate += value;
+    } else if constexpr (Op == operation_e::SUB) {
+      accumulate -= value;
+    } else if constexpr (Op == operation_e::MUL) {
+      accumulate *= value;
+    } else if constexpr (Op == operation_e::DIV) {
+      if (value == 0) {
+        return false;
+      }
+      accumulate /= value;
+    } else if constexpr (Op == operation_e::MOD) {
+      if constexpr (std::is_same_v<T, int64_t>) {
+        if (value == 0) {
+          return false;
+        }
+        accumulate %= value;
+      } else {
+        accumulate = std::fmod(accumulate, value);
+      }
+    } else if constexpr (Op == operation_e::POW) {
+      accumulate = std::pow(accumulate, value);
+    }
+  }
+  return true;
+}
+
+//! \brief Apply an arithmetic operation, the first operand deciding
+//!        whether integers or doubles are used
+template <operation_e Op>
+inline bool arithmetic(const cell_ptr *operands, const std::size_t count,
+                       cell_ptr &result) {
+  for (std::size_t i = 0; i < count; i++) {
+    if (!is_number(operands[i])) {
+      return false;
+    }
+  }
+  if (operands[0].type() == cell_type_e::I64) {
+    int64_t accumulate;
+    if (!fold<Op>(operands, count, accumulate)) {
+      return false;
+    }
+    result = allocate_cell(accumulate);
+    return true;
+  }
+  double accumulate;
+  if (!fold<Op>(operands, count, accumulate)) {
+    return false;
+  }
+  result = allocate_cell(accumulate);
+  return true;
+}
+
+template <operation_e Op, typename T>
+inline bool apply(const T lhs, const T rhs) {
+  if constexpr (Op == operation_e::EQ) {
+    return lhs == rhs;
+  } else if constexpr (Op == operation_e::NEQ) {
+    return lhs != rhs;
+  } else if constexpr (Op == operation_e::LT) {
+    return lhs < rhs;
+  } else if constexpr (Op == operation_e::GT) {
+    return lhs > rhs;
+  } else if constexpr (Op == operation_e::LTE) {
+    return lhs <= rhs;
+  } else if constexpr (Op == operation_e::GTE) {
+    return lhs >= rhs;
+  } else if constexpr (Op == operation_e::AND) {
+    return lhs && rhs;
+  } else {
+    return lhs || rhs;
+  }
+}
+
+//! \brief Compare as the comparison builtins do, the left hand
+//!        side deciding whether integers or doubles are compared
+template <operation_e Op>
+inline bool compare(cell_ref_t lhs, cell_ref_t rhs, cell_ptr &result) {
+  if (!is_number(lhs) || !is_number(rhs)) {
+    return false;
+  }
+  if (lhs.type() == cell_type_e::I64) {
+    result = allocate_cell(
+        (int64_t)apply<Op>(lhs.as_integer(), rhs.to_integer()));
+  } else {
+    result =
+        allocate_cell((int64_t)apply<Op>(lhs.as_double(), rhs.to_double()));
+  }
+  return true;
+}
+
+//! \brief Negate a value as `not` does
+inline bool negate(cell_ref_t value, cell_ptr &result) {
+  if (!is_number(value)) {
+    return false;
+  }
+  result = allocate_cell((int64_t)(!value.to_integer()));
+  return true;
+}
+
+} // namespace numeric
+} // namespace nibi
@@ -0,0 +1,193 @@
+#include "resolver.hpp"
+
+#include "libnibi/interpreter/forms.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <unordered_set>
+
+namespace nibi {
+namespace resolver {
+
+namespace {
+
+static constexpr std::size_t MAX_SLOTS = std::numeric_limits<uint16_t>::max();
+
+std::unordered_set<symbol_id_t> &macro_names() {
+  static std::unordered_set<symbol_id_t> names;
+  return names;
+}
+
+uint32_t current_generation{1};
+
+//! \brief Check if running a cell may bind a variable in the
+//!        environment it runs in
+bool may_bind(cell_ref_t cell) {
+  if (!cell || cell.is_immediate() || cell->type != cell_type_e::LIST) {
+    return false;
+  }
+
+  auto &info = cell->read_list_info();
+  if (info.type == list_types_e::ACCESS || info.list.empty()) {
+    return false;
+  }
+
+  auto &list = info.list;
+  if (info.type == list_types_e::INSTRUCTION) {
+    auto &head = list.front();
+    if (head.type() == cell_type_e::SYMBOL &&
+        macro_names().contains(head->as_symbol_id())) {
+      return true;
+    }
+    switch (forms::identify(head).form) {
+    case forms::form_e::IF:
+    case forms::form_e::LOOP:
+      // Either opens a scope of its own or binds nothing
+      return false;
+    case forms::form_e::DEFINE:
+      // Only named functions are bound, the body runs in each call
+      return list.size() > 1 && list[1].type() == cell_type_e::SYMBOL;
+    case forms::form_e::ASSIGN:
+    case forms::form_e::BIND:
+      return true;
+    default:
+      break;
+    }
+  }
+
+  // Calls to lambdas bind in environments of their own, whatever
+  // else the items do may bind here
+  for (auto &item : list) {
+    if (may_bind(item)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//! \brief Gathers the variables that forms bind in the scope they run in
+class collector_c {
+public:
+  collector_c(slot_layout_t &layout, const scopes_c *around)
+      : layout_(layout), around_(around) {}
+
+  void add(const symbol_id_t id) {
+    if (layout_.size() >= MAX_SLOTS || !forms::is_assignable(id) ||
+        std::find(layout_.begin(), layout_.end(), id) != layout_.end() ||
+        (around_ && around_->resolve(id).has_value())) {
+      return;
+    }
+    layout_.push_back(id);
+  }
+
+  void collect(cell_ref_t cell) {
+    if (!cell || cell.is_immediate() || cell->type != cell_type_e::LIST) {
+      return;
+    }
+
+    auto &info = cell->read_list_info();
+    if (info.type == list_types_e::ACCESS || info.list.empty()) {
+      return;
+    }
+
+    auto &list = info.list;
+    if (info.type == list_types_e::INSTRUCTION) {
+      switch (forms::identify(list.front()).form) {
+      case forms::form_e::IF:
+      case forms::form_e::LOOP:
+        // Opens a scope of its own
+        return;
+      case forms::form_e::DEFINE:
+        // The body runs in the environment of each call
+        if (list.size() == 4 && list[1].type() == cell_type_e::SYMBOL) {
+          add(list[1]->as_symbol_id());
+        }
+        return;
+      case forms::form_e::ASSIGN:
+        if (list.size() == 3 && list[1].type() == cell_type_e::SYMBOL) {
+          add(list[1]->as_symbol_id());
+          collect(list[2]);
+          return;
+        }
+        break;
+      default:
+        break;
+      }
+    }
+
+    // Whatever else the items do may run here too. A variable laid
+    // out that is bound elsewhere only leaves a slot unused
+    for (auto &item : list) {
+      collect(item);
+    }
+  }
+
+private:
+  slot_layout_t &layout_;
+  const scopes_c *around_;
+};
+
+} // namespace
+
+bool needs_scope(const list_info_s &form) {
+  auto &cache = form.scope;
+  if (cache.generation != current_generation) {
+    cache.needed = false;
+    for (std::size_t n = 1; n < form.list.size() && !cache.needed; n++) {
+      cache.needed = may_bind(form.list[n]);
+    }
+    cache.generation = current_generation;
+  }
+  return cache.needed;
+}
+
+void note_macro(const symbol_id_t id) {
+  if (macro_names().insert(id).second) {
+    current_generation++;
+  }
+}
+
+uint32_t generation() { return current_generation; }
+
+slot_layout_t lambda_layout(const lambda_info_s &lambda) {
+  slot_layout_t layout;
+  if (forms::has_fixed_arguments(lambda)) {
+    layout = lambda.arg_ids;
+  }
+  collector_c(layout, nullptr).collect(lambda.body);
+  return layout;
+}
+
+void scopes_c::enter_lambda(const lambda_info_s &lambda) {
+  scopes_.push_back(lambda.frame_layout);
+}
+
+slot_layout_t scopes_c::enter_scope(const cell_list_t &form) {
+  slot_layout_t layout;
+  collector_c collector(layout, this);
+  for (std::size_t n = 1; n < form.size(); n++) {
+    collector.collect(form[n]);
+  }
+  scopes_.push_back(layout);
+  return layout;
+}
+
+void scopes_c::leave_scope() { scopes_.pop_back(); }
+
+std::optional<address_s> scopes_c::resolve(const symbol_id_t id) const {
+  if (scopes_.size() > MAX_SLOTS) {
+    return std::nullopt;
+  }
+  for (std::size_t depth = 0; depth < scopes_.size(); depth++) {
+    auto &layout = scopes_[scopes_.size() - 1 - depth];
+    auto it = std::find(layout.begin(), layout.end(), id);
+    if (it != layout.end()) {
+      return address_s{static_cast<uint16_t>(depth),
+                       static_cast<uint16_t>(it - layout.begin())};
+    }
+  }
+  return std::nullopt;
+}
+
+} // namespace resolver
+} // namespace nibi
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "libnibi/cell.hpp"
+#include "libnibi/symbols.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+/*
+    Lexical addressing for the compiled tiers. The environment a lambda
+    is called in, and each scope its `if` and `loop` forms open, keep the
+    variables bound in them by `:=` and `fn` in slots (see env_c), so
+    compiled code can read them by (depth, slot) rather than searching
+    each environment by name.
+
+    Layouts only decide where variables are kept, what a name means is
+    still decided as the tree walker decides it. A variable that is not
+    bound yet has an empty slot, and anything bound by name (by `eval`,
+    `import` or a builtin the resolver does not know) makes lookups
+    through its environment fall back to searching by name.
+
+    An `if` or `loop` only opens a scope when something in it may bind
+    a variable there, otherwise it runs in the environment around it
+    (see needs_scope). Every tier decides this the same way.
+*/
+
+namespace nibi {
+namespace resolver {
+
+//! \brief Where a variable of a compiled scope is kept
+struct address_s {
+  uint16_t depth{0}; // Scopes up from the one the variable is used in
+  uint16_t slot{0};  // The slot in that scope's environment
+};
+
+//! \brief Lay out the environment calls to a lambda run in: the
+//!        arguments in order, if calls can bind them to slots, then
+//!        the variables the body binds
+extern slot_layout_t lambda_layout(const lambda_info_s &lambda);
+
+//! \brief Check if an `if` or `loop` form has to run in an environment
+//!        of its own, which is so when running it may bind a variable
+//!        there. The answer is kept in the form
+//! \note  A macro binds whatever its expansion binds, so calls to a name
+//!        that a macro has been defined with are taken to bind. Answers
+//!        hold until a macro is defined with a new name, see generation
+extern bool needs_scope(const list_info_s &form);
+
+//! \brief Note that a macro has been defined with a name
+extern void note_macro(const symbol_id_t id);
+
+//! \brief Get the number of names macros have been defined with, plus
+//!        one. Code compiled with answers from needs_scope is compiled
+//!        again when it changes
+extern uint32_t generation();
+
+//! \brief The scopes a compiler is in, to resolve variables with
+class scopes_c {
+public:
+  //! \brief Enter the environment of a lambda
+  void enter_lambda(const lambda_info_s &lambda);
+
+  //! \brief Enter the scope an `if` or `loop` form opens
+  //! \param form The items of the form
+  //! \return The layout to create the scope's environment with
+  //! \note  Variables bound in the scopes around are left to them, as
+  //!        `:=` updates those rather than binding its own
+  slot_layout_t enter_scope(const cell_list_t &form);
+
+  //! \brief Leave the innermost scope
+  void leave_scope();
+
+  //! \brief Find where a variable is kept
+  //! \return nullopt if it is not kept in a slot of any scope
+  std::optional<address_s> resolve(const symbol_id_t id) const;
+
+private:
+  std::vector<slot_layout_t> scopes_;
+};
+
+} // namespace resolver
+} // namespace nibi
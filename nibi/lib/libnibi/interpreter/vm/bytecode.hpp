@@ -0,0 +1,110 @@
+#pragma once
+
+#include "libnibi/cell.hpp"
+#include "libnibi/symbols.hpp"
+
+#include <cstdint>
+#include <vector>
+
+/*
+    Bytecode for the bodies of lambdas, see compiler.hpp and vm.hpp.
+
+    Instructions work on the registers of a call frame, each of which
+    holds a cell. `a` is the register written unless noted, `b` and `c`
+    are registers or counts, and `d` is a constant, symbol or jump
+    target. K[n] is constant n of the chunk and R[n] register n.
+
+    Forms that are not compiled are kept as constants and handed to the
+    tree walker with EVAL, so anything the compiler does not understand
+    still runs exactly as it would have. The arithmetic and comparison
+    instructions only handle I64 and F64 operands themselves. Others
+    are handed to the builtin already evaluated, each wrapped in an
+    alias so that the builtin reads the value rather than running it.
+
+    A yield ends the frame as soon as it is seen. The tree walker lets
+    the builtin a yielding form was an argument of finish first, which
+    only matters for forms such as (:= x (<- 1)).
+
+    A call to a lambda in tail position, or yielded, leaves the function
+    and its arguments to the interpreter and ends the frame, so that the
+    call runs in its place (see interpreter_c::run_tail_calls).
+*/
+
+namespace nibi {
+namespace vm {
+
+enum class opcode_e : uint8_t {
+  LOAD_CONST,     // R[a] = K[d]
+  LOAD_NIL,       // R[a] = nil
+  LOAD_LAST,      // R[a] = the last result of the interpreter
+  GET_VAR,        // R[a] = variable d, boxed so it can be updated.
+                  //        K[c] is the symbol, for errors
+  READ_VAR,       // R[a] = variable d, as stored. K[c] is the symbol
+  GET_LOCAL,      // R[a] = variable K[d] kept in slot b of the scope c
+                  //        up, boxed so it can be updated
+  READ_LOCAL,     // R[a] = variable K[d] in slot b, c up, as stored
+  EVAL,           // R[a] = K[d] run by the tree walker
+  ASSIGN,         // R[a] = clone of R[b], set as variable d
+  ASSIGN_LOCAL,   // R[a] = clone of R[a], set as variable K[d] which
+                  //        is kept in slot b of the scope c up
+  SET,            // Update R[a] in place from R[b]
+  ADD,            // R[a] = R[b] + ... R[b + c - 1], or builtin K[d]
+  SUB,            //        on them if they are not I64 or F64
+  MUL,            //
+  DIV,            //
+  MOD,            //
+  POW,            //
+  EQ,             // R[a] = R[b] == R[c], or builtin K[d] on them
+  NEQ,            //        if they are not I64 or F64
+  LT,             //
+  GT,             //
+  LTE,            //
+  GTE,            //
+  AND,            //
+  OR,             //
+  NOT,            // R[a] = !R[b], or builtin K[d] on it
+  JUMP,           // Continue at instruction d
+  JUMP_UNLESS,    // Continue at d unless R[a] is an integer above 0
+  JUMP_IF_DONE,   // Continue at d if R[a] converts to 0 or less
+  LOOP,           // Continue at d after running any memory work due
+  ENTER_SCOPE,    // Run in a new environment, held in scope slot a,
+                  //        with the variables of layout b in slots
+  LEAVE_SCOPE,    // Return to the environment outside scope slot a
+  RESOLVE_CALL,   // R[a] = the function found through inline cache c.
+                  //        Continue at d unless it is a lambda taking
+                  //        b arguments
+  CALL,           // R[a] = R[b] called with R[b + 1] ... R[b + c].
+                  //        K[d] is the symbol called, for the trace
+  TAIL_CALL,      // Return, leaving R[b] to be called with R[b + 1]
+                  //        ... R[b + c] in place of the frame, its
+                  //        value copied if a is set. K[d] is the symbol
+  RETURN,         // Return R[a], or a clone of it if b is set
+  COUNT
+};
+
+//! \brief A single instruction, see opcode_e for the operands
+struct instruction_s {
+  opcode_e op;
+  uint16_t a{0};
+  uint16_t b{0};
+  uint16_t c{0};
+  uint32_t d{0};
+};
+
+//! \brief The compiled body of a lambda
+struct chunk_s {
+  std::vector<instruction_s> code;
+  std::vector<cell_ptr> constants;
+  std::vector<slot_layout_t> layouts; // Of the scopes entered
+  mutable std::vector<binding_cache_s> caches; // Of the calls resolved
+  uint16_t registers{0}; // Registers a frame needs
+  uint16_t scopes{0};    // Environments a frame may nest
+  int32_t arity{-1};     // Arguments a CALL binds, -1 if calls have to
+                         // go through the tree walker (variadic lambdas,
+                         // or arguments with names it rejects)
+  uint32_t generation{0}; // Of the macro names it was compiled with, see
+                          // resolver::generation
+};
+
+} // namespace vm
+} // namespace nibi
@@ -0,0 +1,428 @@
+#include "compiler.hpp"
+
+#include "libnibi/interpreter/forms.hpp"
+#include "libnibi/interpreter/resolver.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+
+namespace nibi {
+namespace vm {
+
+namespace {
+
+using forms::builtin_s;
+using forms::form_e;
+using forms::operation_e;
+using forms::position_e;
+
+// The operations have instructions of their own, in the same order
+static_assert(static_cast<uint8_t>(opcode_e::OR) -
+                      static_cast<uint8_t>(opcode_e::ADD) ==
+                  static_cast<uint8_t>(operation_e::OR),
+              "Arithmetic and comparison opcodes follow operation_e");
+static_assert(static_cast<uint8_t>(opcode_e::NOT) -
+                      static_cast<uint8_t>(opcode_e::ADD) ==
+                  static_cast<uint8_t>(operation_e::NOT),
+              "Arithmetic and comparison opcodes follow operation_e");
+
+//! \brief Get the instruction for an operation
+opcode_e opcode_of(const operation_e operation) {
+  return static_cast<opcode_e>(static_cast<uint8_t>(opcode_e::ADD) +
+                               static_cast<uint8_t>(operation));
+}
+
+class compiler_c {
+public:
+  //! \param shallow Hand every form to the tree walker
+  compiler_c(const bool shallow) : shallow_(shallow) {}
+
+  //! \brief Compile a body
+  //! \return false if the chunk would need more registers or
+  //!         constants than an instruction can address
+  bool compile(const lambda_info_s &lambda, chunk_s &chunk);
+
+private:
+  static constexpr std::size_t MAX_OPERAND =
+      std::numeric_limits<uint16_t>::max();
+
+  bool shallow_{false};
+  bool overflow_{false};
+  chunk_s *chunk_{nullptr};
+  std::size_t next_register_{0};
+  std::size_t scope_depth_{0};
+  resolver::scopes_c scopes_;
+
+  // Take count consecutive registers, returning the first
+  uint16_t take_registers(const std::size_t count);
+
+  // Add a constant that is referenced from a 16 bit operand
+  uint16_t small_constant(cell_ref_t cell);
+
+  // Add a constant that is referenced from d
+  uint32_t constant(cell_ref_t cell);
+
+  // Add an inline cache for the function called by a symbol
+  uint16_t cache(const symbol_id_t id);
+
+  std::size_t emit(const opcode_e op, const uint16_t a = 0,
+                   const uint16_t b = 0, const uint16_t c = 0,
+                   const uint32_t d = 0);
+
+  // Point the jump at `from` to the next instruction
+  void jump_here(const std::size_t from);
+
+  // Open an environment for an `if` or `loop` if it needs one, see
+  // resolver::needs_scope. Returns the scope slot to leave_scope, or
+  // nullopt if the form runs in the scope around it
+  std::optional<uint16_t> enter_scope(cell_ref_t cell,
+                                      const cell_list_t &list);
+  void leave_scope(const std::optional<uint16_t> slot);
+
+  // Each of the following leave their value in `target`. The
+  // value is that of `process_cell(cell, env, true)` for body,
+  // of `process_cell(cell, env)` for a boxed expression and of
+  // `borrow_cell` otherwise. A yield ends the frame wherever it is,
+  // so the position of its argument is always YIELD
+
+  void body(cell_ref_t cell, const uint16_t target,
+            const position_e position);
+  void expression(cell_ref_t cell, const uint16_t target, const bool boxed,
+                  const position_e position = position_e::VALUE);
+  void form(cell_ref_t cell, const cell_list_t &list, const uint16_t target,
+            const position_e position);
+  void call(cell_ref_t cell, const cell_list_t &list, const uint16_t target,
+            const position_e position);
+  void eval(cell_ref_t cell, const uint16_t target);
+};
+
+bool compiler_c::compile(const lambda_info_s &lambda, chunk_s &chunk) {
+  chunk_ = &chunk;
+  chunk.generation = resolver::generation();
+  scopes_.enter_lambda(lambda);
+
+  if (forms::has_fixed_arguments(lambda)) {
+    chunk.arity = static_cast<int32_t>(lambda.arg_ids.size());
+  }
+
+  auto result = take_registers(1);
+  body(lambda.body, result, position_e::TAIL);
+  emit(opcode_e::RETURN, result);
+
+  return !overflow_;
+}
+
+uint16_t compiler_c::take_registers(const std::size_t count) {
+  auto first = next_register_;
+  next_register_ += count;
+  if (next_register_ > MAX_OPERAND) {
+    overflow_ = true;
+    return 0;
+  }
+  chunk_->registers = std::max<uint16_t>(chunk_->registers, next_register_);
+  return static_cast<uint16_t>(first);
+}
+
+uint16_t compiler_c::small_constant(cell_ref_t cell) {
+  auto index = constant(cell);
+  if (index > MAX_OPERAND) {
+    overflow_ = true;
+    return 0;
+  }
+  return static_cast<uint16_t>(index);
+}
+
+uint32_t compiler_c::constant(cell_ref_t cell) {
+  chunk_->constants.push_back(cell);
+  return static_cast<uint32_t>(chunk_->constants.size() - 1);
+}
+
+uint16_t compiler_c::cache(const symbol_id_t id) {
+  chunk_->caches.push_back({id});
+  auto index = chunk_->caches.size() - 1;
+  if (index > MAX_OPERAND) {
+    overflow_ = true;
+    return 0;
+  }
+  return static_cast<uint16_t>(index);
+}
+
+std::size_t compiler_c::emit(const opcode_e op, const uint16_t a,
+                             const uint16_t b, const uint16_t c,
+                             const uint32_t d) {
+  chunk_->code.push_back({op, a, b, c, d});
+  return chunk_->code.size() - 1;
+}
+
+void compiler_c::jump_here(const std::size_t from) {
+  chunk_->code[from].d = static_cast<uint32_t>(chunk_->code.size());
+}
+
+std::optional<uint16_t> compiler_c::enter_scope(cell_ref_t cell,
+                                                const cell_list_t &list) {
+  if (!resolver::needs_scope(cell->read_list_info())) {
+    return std::nullopt;
+  }
+  auto slot = scope_depth_++;
+  chunk_->layouts.push_back(scopes_.enter_scope(list));
+  auto layout = chunk_->layouts.size() - 1;
+  if (scope_depth_ > MAX_OPERAND || layout > MAX_OPERAND) {
+    overflow_ = true;
+    return 0;
+  }
+  chunk_->scopes = std::max<uint16_t>(chunk_->scopes, scope_depth_);
+  emit(opcode_e::ENTER_SCOPE, static_cast<uint16_t>(slot),
+       static_cast<uint16_t>(layout));
+  return static_cast<uint16_t>(slot);
+}
+
+void compiler_c::leave_scope(const std::optional<uint16_t> slot) {
+  if (!slot) {
+    return;
+  }
+  emit(opcode_e::LEAVE_SCOPE, *slot);
+  scopes_.leave_scope();
+  scope_depth_--;
+}
+
+void compiler_c::body(cell_ref_t cell, const uint16_t target,
+                      const position_e position) {
+  // A data list runs each of its items in turn, as the
+  // interpreter does for one given with `process_data_cell`
+  if (auto *list = forms::body_list(cell)) {
+    for (std::size_t n = 0; n + 1 < list->size(); n++) {
+      expression((*list)[n], target, true, position_e::STATEMENT);
+    }
+    expression(list->back(), target, true, position);
+    return;
+  }
+  expression(cell, target, true, position);
+}
+
+void compiler_c::expression(cell_ref_t cell, const uint16_t target,
+                            const bool boxed, const position_e position) {
+  if (!cell) {
+    emit(opcode_e::LOAD_NIL, target);
+    return;
+  }
+
+  if (cell.is_immediate()) {
+    emit(opcode_e::LOAD_CONST, target, 0, 0, constant(cell));
+    return;
+  }
+
+  switch (cell->type) {
+  case cell_type_e::SYMBOL:
+    if (auto address = scopes_.resolve(cell->as_symbol_id())) {
+      emit(boxed ? opcode_e::GET_LOCAL : opcode_e::READ_LOCAL, target,
+           address->slot, address->depth, constant(cell));
+      return;
+    }
+    emit(boxed ? opcode_e::GET_VAR : opcode_e::READ_VAR, target, 0,
+         small_constant(cell), cell->as_symbol_id());
+    return;
+  case cell_type_e::LIST:
+    if (auto *list = forms::instruction_list(cell); list && !shallow_) {
+      form(cell, *list, target, position);
+      return;
+    }
+    eval(cell, target);
+    return;
+  case cell_type_e::ALIAS:
+    eval(cell, target);
+    return;
+  default:
+    emit(opcode_e::LOAD_CONST, target, 0, 0, constant(cell));
+    return;
+  }
+}
+
+void compiler_c::form(cell_ref_t cell, const cell_list_t &list,
+                      const uint16_t target, const position_e position) {
+  if (list.front().type() == cell_type_e::SYMBOL) {
+    call(cell, list, target, position);
+    return;
+  }
+
+  auto mark = next_register_;
+  auto builtin = forms::identify(list.front());
+
+  switch (builtin.form) {
+  case form_e::ASSIGN: {
+    if (list.size() != 3 || list[1].type() != cell_type_e::SYMBOL ||
+        !forms::is_assignable(list[1]->as_symbol_id())) {
+      break;
+    }
+    expression(list[2], target, false);
+    if (auto address = scopes_.resolve(list[1]->as_symbol_id())) {
+      emit(opcode_e::ASSIGN_LOCAL, target, address->slot, address->depth,
+           constant(list[1]));
+      return;
+    }
+    emit(opcode_e::ASSIGN, target, target, 0, list[1]->as_symbol_id());
+    return;
+  }
+  case form_e::SET: {
+    if (list.size() != 3) {
+      break;
+    }
+    auto value = take_registers(1);
+    expression(list[1], target, true);
+    expression(list[2], value, false);
+    emit(opcode_e::SET, target, value);
+    next_register_ = mark;
+    return;
+  }
+  case form_e::IF: {
+    if (list.size() != 3 && list.size() != 4) {
+      break;
+    }
+    auto scope = enter_scope(cell, list);
+    expression(list[1], target, false);
+    auto otherwise = emit(opcode_e::JUMP_UNLESS, target);
+    body(list[2], target, position);
+    auto done = emit(opcode_e::JUMP);
+    jump_here(otherwise);
+    if (list.size() == 4) {
+      body(list[3], target, position);
+    } else {
+      emit(opcode_e::LOAD_LAST, target);
+    }
+    jump_here(done);
+    leave_scope(scope);
+    return;
+  }
+  case form_e::LOOP: {
+    // (loop (pre) (cond) (post) (body))
+    if (list.size() != 5) {
+      break;
+    }
+    auto scope = enter_scope(cell, list);
+    auto scratch = take_registers(1);
+    expression(list[1], scratch, true);
+    emit(opcode_e::LOAD_NIL, target);
+    auto condition = chunk_->code.size();
+    expression(list[2], scratch, false);
+    auto exit = emit(opcode_e::JUMP_IF_DONE, scratch);
+    body(list[4], target, position_e::STATEMENT);
+    expression(list[3], scratch, true);
+    emit(opcode_e::LOOP, 0, 0, 0, static_cast<uint32_t>(condition));
+    jump_here(exit);
+    leave_scope(scope);
+    next_register_ = mark;
+    return;
+  }
+  case form_e::YIELD: {
+    if (list.size() == 1) {
+      emit(opcode_e::LOAD_CONST, target, 0, 0,
+           constant(allocate_cell((int64_t)0)));
+      emit(opcode_e::RETURN, target);
+      return;
+    }
+    if (list.size() != 2) {
+      break;
+    }
+    expression(list[1], target, false, position_e::YIELD);
+    emit(opcode_e::RETURN, target, 1);
+    return;
+  }
+  case form_e::ARITHMETIC:
+  case form_e::COMPARISON:
+  case form_e::NOT: {
+    // Strings are only added and repeated by the builtin,
+    // there is no point trying the instruction first
+    if (!forms::has_operands(builtin, list) ||
+        (builtin.form == form_e::ARITHMETIC &&
+         list[1].type() == cell_type_e::STRING)) {
+      break;
+    }
+    auto count = list.size() - 1;
+    auto first = take_registers(count);
+    auto fallback = constant(list.front());
+    switch (builtin.form) {
+    case form_e::ARITHMETIC:
+      for (std::size_t i = 0; i < count; i++) {
+        expression(list[i + 1], first + i, false);
+      }
+      emit(opcode_of(builtin.operation), target, first, count, fallback);
+      break;
+    case form_e::COMPARISON:
+      expression(list[1], first, false);
+      expression(list[2], first + 1, false);
+      emit(opcode_of(builtin.operation), target, first, first + 1, fallback);
+      break;
+    default:
+      // `not` runs a data list given to it
+      body(list[1], first, position_e::VALUE);
+      emit(opcode_of(builtin.operation), target, first, 0, fallback);
+      break;
+    }
+    next_register_ = mark;
+    return;
+  }
+  default:
+    break;
+  }
+
+  eval(cell, target);
+}
+
+void compiler_c::call(cell_ref_t cell, const cell_list_t &list,
+                      const uint16_t target, const position_e position) {
+  auto mark = next_register_;
+  auto count = list.size() - 1;
+  if (count > MAX_OPERAND) {
+    eval(cell, target);
+    return;
+  }
+
+  // The arguments follow the function so the call can bind
+  // them straight from the registers
+  auto function = take_registers(count + 1);
+  auto head = small_constant(list.front());
+  auto resolve = emit(opcode_e::RESOLVE_CALL, function, count,
+                      cache(list.front()->as_symbol_id()));
+  for (std::size_t i = 0; i < count; i++) {
+    expression(list[i + 1], function + 1 + i, true);
+  }
+  switch (position) {
+  case position_e::TAIL:
+  case position_e::YIELD:
+    emit(opcode_e::TAIL_CALL, position == position_e::YIELD, function, count,
+         head);
+    break;
+  default:
+    emit(opcode_e::CALL, target, function, count, head);
+    break;
+  }
+  auto done = emit(opcode_e::JUMP);
+
+  // Anything other than a lambda taking these arguments is
+  // called by the interpreter, which also reports the errors
+  jump_here(resolve);
+  eval(cell, target);
+  jump_here(done);
+  next_register_ = mark;
+}
+
+void compiler_c::eval(cell_ref_t cell, const uint16_t target) {
+  emit(opcode_e::EVAL, target, 0, 0, constant(cell));
+}
+
+} // namespace
+
+std::shared_ptr<chunk_s> compile(const lambda_info_s &lambda) {
+  auto chunk = std::make_shared<chunk_s>();
+  if (compiler_c(false).compile(lambda, *chunk)) {
+    return chunk;
+  }
+
+  // Too large to address, so run it all through the tree walker
+  chunk = std::make_shared<chunk_s>();
+  compiler_c(true).compile(lambda, *chunk);
+  return chunk;
+}
+
+} // namespace vm
+} // namespace nibi
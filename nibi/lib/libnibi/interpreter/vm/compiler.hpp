@@ -0,0 +1,20 @@
+#pragma once
+
+#include "libnibi/cell.hpp"
+#include "libnibi/interpreter/vm/bytecode.hpp"
+
+#include <memory>
+
+namespace nibi {
+namespace vm {
+
+//! \brief Compile the body of a lambda to bytecode
+//! \param lambda The lambda to compile
+//! \return The compiled body
+//! \note  This does not fail. Forms that are not understood, or do not
+//!        have the shape their builtin expects, are left to the tree
+//!        walker so they run (and report errors) exactly as before
+extern std::shared_ptr<chunk_s> compile(const lambda_info_s &lambda);
+
+} // namespace vm
+} // namespace nibi
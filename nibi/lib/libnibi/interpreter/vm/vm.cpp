@@ -0,0 +1,350 @@
+#include "vm.hpp"
+
+#include "compiler.hpp"
+#include "interpreter/interpreter.hpp"
+#include "libnibi/alloc_profiler.hpp"
+#include "libnibi/interpreter/numeric.hpp"
+#include "libnibi/interpreter/resolver.hpp"
+#include "libnibi/small_vector.hpp"
+
+#include <optional>
+
+#if defined(__GNUC__)
+#define NIBI_VM_COMPUTED_GOTO 1
+#else
+#define NIBI_VM_COMPUTED_GOTO 0
+#endif
+
+namespace nibi {
+namespace vm {
+
+namespace {
+
+using forms::operation_e;
+
+// Registers and scopes most frames fit in without an allocation
+static constexpr std::size_t INLINE_REGISTERS = 16;
+static constexpr std::size_t INLINE_SCOPES = 4;
+
+[[noreturn]] void symbol_not_found(cell_ref_t symbol) {
+  throw interpreter_c::exception_c("Symbol not found in environment: " +
+                                       symbol->as_symbol(),
+                                   symbol->locator());
+}
+
+} // namespace
+
+const std::shared_ptr<chunk_s> &vm_c::chunk_of(lambda_info_s &lambda) {
+  if (!lambda.bytecode ||
+      lambda.bytecode->generation != resolver::generation()) {
+    lambda.bytecode = compile(lambda);
+  }
+  return lambda.bytecode;
+}
+
+cell_ptr vm_c::run_lambda(lambda_info_s &lambda, env_c &env) {
+  // Held as the body may replace the function it belongs to
+  auto chunk = chunk_of(lambda);
+  return run(*chunk, env);
+}
+
+cell_ptr vm_c::run(const chunk_s &chunk, env_c &env) {
+  auto &interpreter = interpreter_;
+
+  small_vector_c<cell_ptr, INLINE_REGISTERS> registers(chunk.registers,
+                                                       cell_ptr{});
+  small_vector_c<std::optional<env_c>, INLINE_SCOPES> scopes;
+  scopes.resize(chunk.scopes);
+
+  cell_ptr *r = registers.data();
+  const cell_ptr *k = chunk.constants.data();
+  const instruction_s *code = chunk.code.data();
+  const instruction_s *ip = code;
+  const instruction_s *i = nullptr;
+  env_c *current = &env;
+
+  // Operands the instructions do not handle go to the builtin
+#define NIBI_VM_FALLBACK(___count)                                             \
+  r[i->a] = interpreter.apply_builtin(k[i->d], r + i->b, ___count, *current)
+
+#define NIBI_VM_SAFE_POINT()                                                   \
+  if (--interpreter.safe_point_countdown_ == 0) {                              \
+    interpreter.handle_safe_point();                                           \
+  }
+
+#if NIBI_VM_COMPUTED_GOTO
+  static void *const dispatch[] = {
+      &&op_LOAD_CONST,   &&op_LOAD_NIL,     &&op_LOAD_LAST,
+      &&op_GET_VAR,      &&op_READ_VAR,     &&op_GET_LOCAL,
+      &&op_READ_LOCAL,   &&op_EVAL,         &&op_ASSIGN,
+      &&op_ASSIGN_LOCAL, &&op_SET,          &&op_ADD,
+      &&op_SUB,          &&op_MUL,          &&op_DIV,
+      &&op_MOD,          &&op_POW,          &&op_EQ,
+      &&op_NEQ,          &&op_LT,           &&op_GT,
+      &&op_LTE,          &&op_GTE,          &&op_AND,
+      &&op_OR,           &&op_NOT,          &&op_JUMP,
+      &&op_JUMP_UNLESS,  &&op_JUMP_IF_DONE, &&op_LOOP,
+      &&op_ENTER_SCOPE,  &&op_LEAVE_SCOPE,  &&op_RESOLVE_CALL,
+      &&op_CALL,         &&op_TAIL_CALL,    &&op_RETURN,
+  };
+  static_assert(sizeof(dispatch) / sizeof(dispatch[0]) ==
+                    static_cast<std::size_t>(opcode_e::COUNT),
+                "Every opcode needs a handler");
+
+#define NIBI_VM_CASE(___op) op_##___op
+#define NIBI_VM_NEXT()                                                         \
+  i = ip++;                                                                    \
+  goto *dispatch[static_cast<std::size_t>(i->op)]
+
+  NIBI_VM_NEXT();
+  {
+#else
+#define NIBI_VM_CASE(___op) case opcode_e::___op
+#define NIBI_VM_NEXT() continue
+
+  while (true) {
+    i = ip++;
+    switch (i->op) {
+#endif
+
+  NIBI_VM_CASE(LOAD_CONST) : r[i->a] = k[i->d];
+    NIBI_VM_NEXT();
+
+  NIBI_VM_CASE(LOAD_NIL) : r[i->a] = allocate_cell(cell_type_e::NIL);
+    NIBI_VM_NEXT();
+
+  NIBI_VM_CASE(LOAD_LAST) : r[i->a] = interpreter.last_result_;
+    NIBI_VM_NEXT();
+
+  NIBI_VM_CASE(GET_VAR) : {
+    auto value = current->get(i->d);
+    if (!value) {
+      symbol_not_found(k[i->c]);
+    }
+    r[i->a] = std::move(value);
+    NIBI_VM_NEXT();
+  }
+
+  NIBI_VM_CASE(READ_VAR) : {
+    auto *value = current->find(i->d);
+    if (!value) {
+      symbol_not_found(k[i->c]);
+    }
+    r[i->a] = *value;
+    NIBI_VM_NEXT();
+  }
+
+  NIBI_VM_CASE(GET_LOCAL) : {
+    auto value = current->get(k[i->d]->as_symbol_id(), i->c, i->b);
+    if (!value) {
+      symbol_not_found(k[i->d]);
+    }
+    r[i->a] = std::move(value);
+    NIBI_VM_NEXT();
+  }
+
+  NIBI_VM_CASE(READ_LOCAL) : {
+    auto *value = current->find(k[i->d]->as_symbol_id(), i->c, i->b);
+    if (!value) {
+      symbol_not_found(k[i->d]);
+    }
+    r[i->a] = *value;
+    NIBI_VM_NEXT();
+  }
+
+  NIBI_VM_CASE(EVAL) : {
+    r[i->a] = interpreter.process_cell(k[i->d], *current);
+    if (interpreter.yield_value_) {
+      return interpreter.yield_value_;
+    }
+    NIBI_VM_NEXT();
+  }
+
+  NIBI_VM_CASE(ASSIGN) : {
+    r[i->a] = r[i->b].clone(*current);
+    current->set(i->d, r[i->a]);
+    NIBI_VM_NEXT();
+  }
+
+  NIBI_VM_CASE(ASSIGN_LOCAL) : {
+    r[i->a] = r[i->a].clone(*current);
+    current->set(k[i->d]->as_symbol_id(), i->c, i->b, r[i->a]);
+    NIBI_VM_NEXT();
+  }
+
+  NIBI_VM_CASE(SET) : {
+    r[i->a].box();
+    r[i->a]->update_from(r[i->b], *current);
+    NIBI_VM_NEXT();
+  }
+
+#define NIBI_VM_ARITHMETIC(___op)                                              \
+  NIBI_VM_CASE(___op) : {                                                      \
+    if (!numeric::arithmetic<operation_e::___op>(r + i->b, i->c, r[i->a])) {  \
+      NIBI_VM_FALLBACK(i->c);                                                  \
+    }                                                                          \
+    NIBI_VM_NEXT();                                                            \
+  }
+
+  NIBI_VM_ARITHMETIC(ADD)
+  NIBI_VM_ARITHMETIC(SUB)
+  NIBI_VM_ARITHMETIC(MUL)
+  NIBI_VM_ARITHMETIC(DIV)
+  NIBI_VM_ARITHMETIC(MOD)
+  NIBI_VM_ARITHMETIC(POW)
+
+#define NIBI_VM_COMPARISON(___op)                                              \
+  NIBI_VM_CASE(___op) : {                                                      \
+    if (!numeric::compare<operation_e::___op>(r[i->b], r[i->c], r[i->a])) {   \
+      NIBI_VM_FALLBACK(2);                                                     \
+    }                                                                          \
+    NIBI_VM_NEXT();                                                            \
+  }
+
+  NIBI_VM_COMPARISON(EQ)
+  NIBI_VM_COMPARISON(NEQ)
+  NIBI_VM_COMPARISON(LT)
+  NIBI_VM_COMPARISON(GT)
+  NIBI_VM_COMPARISON(LTE)
+  NIBI_VM_COMPARISON(GTE)
+  NIBI_VM_COMPARISON(AND)
+  NIBI_VM_COMPARISON(OR)
+
+  NIBI_VM_CASE(NOT) : {
+    if (!numeric::negate(r[i->b], r[i->a])) {
+      NIBI_VM_FALLBACK(1);
+    }
+    NIBI_VM_NEXT();
+  }
+
+  NIBI_VM_CASE(JUMP) : {
+    ip = code + i->d;
+    NIBI_VM_NEXT();
+  }
+
+  NIBI_VM_CASE(JUMP_UNLESS) : {
+    if (!(r[i->a].as_integer() > 0)) {
+      ip = code + i->d;
+    }
+    NIBI_VM_NEXT();
+  }
+
+  NIBI_VM_CASE(JUMP_IF_DONE) : {
+    if (r[i->a].to_integer() <= 0) {
+      ip = code + i->d;
+    }
+    NIBI_VM_NEXT();
+  }
+
+  NIBI_VM_CASE(LOOP) : {
+    NIBI_VM_SAFE_POINT()
+    ip = code + i->d;
+    NIBI_VM_NEXT();
+  }
+
+  NIBI_VM_CASE(ENTER_SCOPE) : {
+    scopes[i->a].emplace(current, chunk.layouts[i->b]);
+    current = &*scopes[i->a];
+    NIBI_VM_NEXT();
+  }
+
+  NIBI_VM_CASE(LEAVE_SCOPE) : {
+    current = i->a ? &*scopes[i->a - 1] : &env;
+    scopes[i->a].reset();
+    NIBI_VM_NEXT();
+  }
+
+  NIBI_VM_CASE(RESOLVE_CALL) : {
+    auto &cache = chunk.caches[i->c];
+    auto *function = current->find(cache.id, cache);
+    if (!function || !*function || function->is_immediate() ||
+        (*function)->type != cell_type_e::FUNCTION) {
+      ip = code + i->d;
+      NIBI_VM_NEXT();
+    }
+    auto &info = (*function)->as_function_info();
+    if (info.type != function_type_e::LAMBDA_FUNCTION || !info.lambda ||
+        chunk_of(*info.lambda)->arity != i->b) {
+      ip = code + i->d;
+      NIBI_VM_NEXT();
+    }
+    r[i->a] = *function;
+    NIBI_VM_NEXT();
+  }
+
+  NIBI_VM_CASE(CALL) : {
+    // Held as the body may replace the function it belongs to
+    cell_ptr function = std::move(r[i->b]);
+    auto &info = function->as_function_info();
+    auto chunk = chunk_of(*info.lambda);
+
+    // The arguments are the first slots of the layout
+    env_c lambda_env(info.operating_env, info.lambda->frame_layout);
+    for (uint16_t n = 0; n < i->c; n++) {
+      lambda_env.slot(n) = std::move(r[i->b + 1 + n]);
+    }
+
+    interpreter.call_stack_.push(k[i->d]);
+    cell_ptr result;
+    {
+      interpreter_c::call_frame_c call_frame(interpreter);
+      alloc_profiler::frame_c profiler_frame(*k[i->d]);
+      result = run(*chunk, lambda_env);
+      if (interpreter.tail_call_.function) {
+        result = interpreter.run_tail_calls(lambda_env);
+      }
+    }
+    if (interpreter.yield_value_) {
+      interpreter.yield_value_ = nullptr;
+    }
+    interpreter.call_stack_.pop();
+
+    r[i->a] = std::move(result);
+    NIBI_VM_SAFE_POINT()
+    NIBI_VM_NEXT();
+  }
+
+  NIBI_VM_CASE(TAIL_CALL) : {
+    auto &tail_call = interpreter.tail_call_;
+    tail_call.function = std::move(r[i->b]);
+    tail_call.head = k[i->d];
+    tail_call.clone = i->a;
+    for (uint16_t n = 0; n < i->c; n++) {
+      tail_call.arguments.push_back(std::move(r[i->b + 1 + n]));
+    }
+
+    // A function made in a scope of the frame may refer to it, so
+    // the call is made before the scope ends
+    if (current->is_captured_below(env)) {
+      interpreter_c::call_frame_c call_frame(interpreter);
+      return interpreter.run_tail_calls(*current);
+    }
+    return allocate_cell(cell_type_e::NIL);
+  }
+
+  NIBI_VM_CASE(RETURN) : {
+    if (i->b) {
+      return r[i->a].clone(*current);
+    }
+    return std::move(r[i->a]);
+  }
+
+#if !NIBI_VM_COMPUTED_GOTO
+  default:
+    break;
+  }
+#endif
+  }
+
+#undef NIBI_VM_COMPARISON
+#undef NIBI_VM_ARITHMETIC
+#undef NIBI_VM_NEXT
+#undef NIBI_VM_CASE
+#undef NIBI_VM_SAFE_POINT
+#undef NIBI_VM_FALLBACK
+
+  return allocate_cell(cell_type_e::NIL);
+}
+
+} // namespace vm
+} // namespace nibi
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "libnibi/cell.hpp"
+#include "libnibi/environment.hpp"
+#include "libnibi/interpreter/vm/bytecode.hpp"
+
+namespace nibi {
+
+class interpreter_c;
+
+namespace vm {
+
+//! \brief Runs the bodies of lambdas as bytecode for an interpreter
+//! \note  Calls from compiled code to lambdas run in a new frame of
+//!        the same vm, anything else goes back through the interpreter
+class vm_c {
+public:
+  vm_c() = delete;
+
+  //! \brief Create a vm for an interpreter
+  //! \param interpreter The interpreter forms that are not compiled,
+  //!        the call trace and the yield value belong to
+  vm_c(interpreter_c &interpreter) : interpreter_(interpreter) {}
+
+  //! \brief Run the body of a lambda, compiling it on its first call
+  //! \param lambda The lambda to run
+  //! \param env The environment holding its arguments
+  //! \return The result of the body, or the value it yielded
+  cell_ptr run_lambda(lambda_info_s &lambda, env_c &env);
+
+private:
+  interpreter_c &interpreter_;
+
+  // Run a chunk in a new frame
+  cell_ptr run(const chunk_s &chunk, env_c &env);
+
+  // Get the compiled body of a lambda
+  static const std::shared_ptr<chunk_s> &chunk_of(lambda_info_s &lambda);
+};
+
+} // namespace vm
+} // namespace nibi
@@ -32,6 +32,18 @@ public:
     return interpreter_.get_last_result()->to_string();
   }
 
+  void set_memory_budget(std::size_t bytes) override {
+    interpreter_.set_memory_budget(bytes);
+  }
+
+  void set_max_call_depth(std::size_t depth) override {
+    interpreter_.set_max_call_depth(depth);
+  }
+
+  void set_execution_tier(execution_tier_e tier) override {
+    interpreter_.set_execution_tier(tier);
+  }
+
 private:
   std::shared_ptr<source_origin_c> source_origin_;
   error_callback_f error_callback_;
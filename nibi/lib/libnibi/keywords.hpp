@@ -40,6 +40,7 @@ static constexpr const char *YIELD = "<-";
 static constexpr const char *LOOP = "loop";
 static constexpr const char *IF = "if";
 static constexpr const char *CLONE = "clone";
+static constexpr const char *FREEZE = "freeze";
 static constexpr const char *IMPORT = "import";
 static constexpr const char *USE = "use";
 static constexpr const char *EXIT = "exit";
@@ -14,10 +14,12 @@ namespace nibi {
 
 // Iterate over a list, executing the loop body for each element
 // after skipping the first n elements, and loading the value
-// into an "arg" variable
+// into an "arg" variable. The value is borrowed, so the loop body
+// must copy it if it is kept beyond the current iteration
 #define NIBI_LIST_ITER_AND_LOAD_SKIP_N(___n, ___loop_body)                     \
   for (auto i = std::next(list.begin(), ___n); i != list.end(); ++i) {         \
-    nibi::cell_ptr arg = ci.process_cell(*i, env);                             \
+    nibi::cell_ptr arg_storage;                                                \
+    nibi::cell_ref_t arg = ci.borrow_cell(*i, env, arg_storage);               \
     ___loop_body                                                               \
   }
 
@@ -30,7 +32,7 @@ namespace nibi {
         std::string(___cmd) + " instruction expects " +                        \
             std::to_string(___size - 1) + " parameters, got " +                \
             std::to_string(list.size() - 1) + ".",                             \
-        list.front()->locator);                                                \
+        list.front()->locator());                                              \
     return nibi::allocate_cell(nibi::cell_type_e::NIL);                        \
   }
 } // namespace nibi
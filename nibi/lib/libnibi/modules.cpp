@@ -68,7 +68,7 @@ std::filesystem::path modules_c::get_module_path(cell_ptr &module_name) {
 
   if (!opt_path.has_value()) {
     throw interpreter_c::exception_c("Could not locate module: " + name,
-                                     module_name->locator);
+                                     module_name->locator());
   }
 
   // load the module
@@ -79,13 +79,13 @@ std::filesystem::path modules_c::get_module_path(cell_ptr &module_name) {
   if (!std::filesystem::exists(module_file)) {
     throw interpreter_c::exception_c("Could not locate module file: " +
                                          module_file.string(),
-                                     module_name->locator);
+                                     module_name->locator());
   }
 
   if (!std::filesystem::is_regular_file(module_file)) {
     throw interpreter_c::exception_c("Module file is not a regular file: " +
                                          module_file.string(),
-                                     module_name->locator);
+                                     module_name->locator());
   }
   return path;
 }
@@ -206,7 +206,7 @@ void modules_c::load_module(cell_ptr &module_name, env_c &target_env) {
 
   if (!loaded_something) {
     throw interpreter_c::exception_c(
-        "Module did not contain any loadable items", module_name->locator);
+        "Module did not contain any loadable items", module_name->locator());
   }
 
   auto new_env_cell = allocate_cell(module_cell_env);
@@ -229,7 +229,7 @@ modules_c::execute_post_import_actions(cell_ptr &post_list,
     if (!std::filesystem::exists(file)) {
       throw interpreter_c::exception_c("Could not locate post-import file: " +
                                            file.string(),
-                                       post_list->locator);
+                                       post_list->locator());
     }
 
     populate_env(file, ci_, ci_.get_env());
@@ -248,13 +248,13 @@ inline void modules_c::load_dylib(std::string &name, env_c &module_env,
   if (!std::filesystem::exists(lib_file)) {
     throw interpreter_c::exception_c("Could not locate dylib file: " +
                                          lib_file.string(),
-                                     dylib_list->locator);
+                                     dylib_list->locator());
   }
 
   if (!std::filesystem::is_regular_file(lib_file)) {
     throw interpreter_c::exception_c("Dylib file is not a regular file: " +
                                          lib_file.string(),
-                                     dylib_list->locator);
+                                     dylib_list->locator());
   }
 
   // Load the library with RLL
@@ -266,7 +266,7 @@ inline void modules_c::load_dylib(std::string &name, env_c &module_env,
   } catch (rll_wrapper_c::library_loading_error_c &e) {
     throw interpreter_c::exception_c("Could not load library: " + name +
                                          ".\nFailed with error: " + e.what(),
-                                     dylib_list->locator);
+                                     dylib_list->locator());
   }
 
   // Validate all listed symbolsm and import them to the module environment
@@ -278,7 +278,7 @@ inline void modules_c::load_dylib(std::string &name, env_c &module_env,
     if (!target_lib->has_symbol(sym)) {
       std::string err =
           "Could not locate symbol: " + sym + " in library: " + name;
-      throw interpreter_c::exception_c(err, func->locator);
+      throw interpreter_c::exception_c(err, func->locator());
     }
 
     auto target_cell = allocate_cell(function_info_s(
@@ -323,7 +323,7 @@ inline void modules_c::load_source_list(std::string &name, env_c &module_env,
       throw interpreter_c::exception_c(
           "File listed in module: " + name +
               " is not a regular file: " + source_file_path.string(),
-          source_file->locator);
+          source_file->locator());
     }
 
     file_interpreter_c(error_callback, module_env, source_manager_)
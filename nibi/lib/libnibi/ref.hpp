@@ -1,5 +1,7 @@
 #pragma once
 
+#include "libnibi/build_config.hpp"
+#include <atomic>
 #include <cstdint>
 
 namespace nibi {
@@ -11,17 +13,31 @@ public:
   virtual ~ref_counted_c() {}
 
   const ref_counted_c *acquire() const {
+#if NIBI_ATOMIC_REFCOUNT
+    ref_count_.fetch_add(1, std::memory_order_relaxed);
+#else
     ref_count_++;
+#endif
     return this;
   }
-  int64_t release() const { return --ref_count_; }
+  int64_t release() const {
+#if NIBI_ATOMIC_REFCOUNT
+    return ref_count_.fetch_sub(1, std::memory_order_acq_rel) - 1;
+#else
+    return --ref_count_;
+#endif
+  }
   int64_t refCount() const { return ref_count_; }
 
 private:
   ref_counted_c(const ref_counted_c &);
   ref_counted_c &operator=(const ref_counted_c &);
 
+#if NIBI_ATOMIC_REFCOUNT
+  mutable std::atomic<std::uint32_t> ref_count_{0};
+#else
   mutable std::uint32_t ref_count_{0};
+#endif
 };
 
 //! \brief A wrapper that performs operations
@@ -0,0 +1,300 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+    A vector that keeps its first N elements inside the object itself.
+    Most lists the parser produces are short instruction lists such as
+    (+ a b), so holding them inline saves an allocation per list and
+    keeps the elements on the same cache lines as the list header.
+
+    Once more than N elements are needed the contents move to the heap
+    and the vector behaves like std::vector from then on. It does not
+    move back inline when it shrinks.
+
+    Iterators are plain pointers and are invalidated by anything that
+    changes the capacity, exactly as with std::vector. Moving a vector
+    that is still inline moves its elements, so unlike std::vector a
+    move also invalidates iterators into the source.
+
+    The Storage policy is told about every heap allocation before it is
+    made, and about every release, so the owner can account for them
+    (see heap.hpp). It may refuse an allocation by throwing.
+*/
+
+namespace nibi {
+
+//! \brief Storage policy of a small_vector_c that does no accounting
+struct uncounted_storage_s {
+  static void allocated(const std::size_t) {}
+  static void released(const std::size_t) {}
+};
+
+template <typename T, std::size_t N, typename Storage = uncounted_storage_s>
+class small_vector_c {
+  static_assert(N > 0, "small_vector_c needs at least one inline element");
+
+public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T &;
+  using const_reference = const T &;
+  using pointer = T *;
+  using const_pointer = const T *;
+  using iterator = T *;
+  using const_iterator = const T *;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  //! \brief Number of elements held without a heap allocation
+  static constexpr size_type INLINE_CAPACITY = N;
+
+  small_vector_c() = default;
+
+  small_vector_c(size_type count, const T &value) {
+    reserve(count);
+    std::uninitialized_fill_n(data_, count, value);
+    size_ = count;
+  }
+
+  template <typename InputIt,
+            typename = typename std::iterator_traits<InputIt>::value_type>
+  small_vector_c(InputIt first, InputIt last) {
+    append(first, last);
+  }
+
+  small_vector_c(std::initializer_list<T> init) {
+    append(init.begin(), init.end());
+  }
+
+  small_vector_c(const small_vector_c &other) {
+    append(other.begin(), other.end());
+  }
+
+  small_vector_c(small_vector_c &&other) noexcept { take(std::move(other)); }
+
+  ~small_vector_c() {
+    clear();
+    release_storage();
+  }
+
+  small_vector_c &operator=(const small_vector_c &other) {
+    if (this != &other) {
+      clear();
+      append(other.begin(), other.end());
+    }
+    return *this;
+  }
+
+  small_vector_c &operator=(small_vector_c &&other) noexcept {
+    if (this != &other) {
+      clear();
+      release_storage();
+      take(std::move(other));
+    }
+    return *this;
+  }
+
+  iterator begin() { return data_; }
+  iterator end() { return data_ + size_; }
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+  const_iterator cbegin() const { return data_; }
+  const_iterator cend() const { return data_ + size_; }
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rbegin() const {
+    return const_reverse_iterator(end());
+  }
+  const_reverse_iterator rend() const {
+    return const_reverse_iterator(begin());
+  }
+
+  size_type size() const { return size_; }
+  size_type capacity() const { return capacity_; }
+  bool empty() const { return size_ == 0; }
+
+  //! \brief Check if the elements are held inside the object
+  bool is_inline() const { return data_ == inline_data(); }
+
+  T *data() { return data_; }
+  const T *data() const { return data_; }
+
+  T &operator[](size_type idx) {
+    assert(idx < size_);
+    return data_[idx];
+  }
+  const T &operator[](size_type idx) const {
+    assert(idx < size_);
+    return data_[idx];
+  }
+
+  T &front() { return (*this)[0]; }
+  const T &front() const { return (*this)[0]; }
+  T &back() { return (*this)[size_ - 1]; }
+  const T &back() const { return (*this)[size_ - 1]; }
+
+  void reserve(size_type new_capacity) {
+    if (new_capacity > capacity_) {
+      grow_to(new_capacity);
+    }
+  }
+
+  void clear() {
+    std::destroy_n(data_, size_);
+    size_ = 0;
+  }
+
+  void push_back(const T &value) { emplace_back(value); }
+  void push_back(T &&value) { emplace_back(std::move(value)); }
+
+  template <typename... Args> T &emplace_back(Args &&...args) {
+    if (size_ == capacity_) {
+      // The argument may live in this vector, build it before moving
+      T value(std::forward<Args>(args)...);
+      grow_to(next_capacity(size_ + 1));
+      ::new (data_ + size_) T(std::move(value));
+    } else {
+      ::new (data_ + size_) T(std::forward<Args>(args)...);
+    }
+    return data_[size_++];
+  }
+
+  void pop_back() {
+    assert(size_);
+    std::destroy_at(data_ + --size_);
+  }
+
+  void resize(size_type count) {
+    if (count < size_) {
+      std::destroy(data_ + count, data_ + size_);
+      size_ = count;
+      return;
+    }
+    reserve(count);
+    std::uninitialized_value_construct(data_ + size_, data_ + count);
+    size_ = count;
+  }
+
+  iterator insert(const_iterator pos, const T &value) {
+    return emplace(pos, value);
+  }
+
+  iterator insert(const_iterator pos, T &&value) {
+    return emplace(pos, std::move(value));
+  }
+
+  template <typename... Args>
+  iterator emplace(const_iterator pos, Args &&...args) {
+    auto idx = static_cast<size_type>(pos - data_);
+    assert(idx <= size_);
+    if (idx == size_) {
+      emplace_back(std::forward<Args>(args)...);
+      return data_ + idx;
+    }
+    T value(std::forward<Args>(args)...);
+    if (size_ == capacity_) {
+      grow_to(next_capacity(size_ + 1));
+    }
+    ::new (data_ + size_) T(std::move(data_[size_ - 1]));
+    std::move_backward(data_ + idx, data_ + size_ - 1, data_ + size_);
+    data_[idx] = std::move(value);
+    size_++;
+    return data_ + idx;
+  }
+
+  iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    auto idx = static_cast<size_type>(first - data_);
+    auto count = static_cast<size_type>(last - first);
+    assert(idx + count <= size_);
+    if (count) {
+      std::move(data_ + idx + count, data_ + size_, data_ + idx);
+      std::destroy(data_ + size_ - count, data_ + size_);
+      size_ -= count;
+    }
+    return data_ + idx;
+  }
+
+  void swap(small_vector_c &other) noexcept {
+    small_vector_c tmp(std::move(other));
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  friend bool operator==(const small_vector_c &lhs, const small_vector_c &rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+  }
+
+private:
+  T *data_{inline_data()};
+  uint32_t size_{0};
+  uint32_t capacity_{N};
+  alignas(T) unsigned char inline_[N * sizeof(T)];
+
+  T *inline_data() { return reinterpret_cast<T *>(inline_); }
+  const T *inline_data() const { return reinterpret_cast<const T *>(inline_); }
+
+  size_type next_capacity(size_type needed) const {
+    return std::max<size_type>(needed, size_type(capacity_) * 2);
+  }
+
+  template <typename InputIt> void append(InputIt first, InputIt last) {
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+      reserve(size_ + static_cast<size_type>(std::distance(first, last)));
+    }
+    for (; first != last; ++first) {
+      emplace_back(*first);
+    }
+  }
+
+  void grow_to(size_type new_capacity) {
+    // Told first as it may refuse, leaving the vector as it was
+    Storage::allocated(new_capacity * sizeof(T));
+    auto *fresh = static_cast<T *>(::operator new(new_capacity * sizeof(T)));
+    std::uninitialized_move_n(data_, size_, fresh);
+    std::destroy_n(data_, size_);
+    release_storage();
+    data_ = fresh;
+    capacity_ = static_cast<uint32_t>(new_capacity);
+  }
+
+  void release_storage() {
+    if (!is_inline()) {
+      Storage::released(capacity_ * sizeof(T));
+      ::operator delete(data_);
+      data_ = inline_data();
+      capacity_ = N;
+    }
+  }
+
+  // Expects this vector to be empty and inline
+  void take(small_vector_c &&other) {
+    if (other.is_inline()) {
+      std::uninitialized_move_n(other.data_, other.size_, data_);
+      size_ = other.size_;
+      other.clear();
+      return;
+    }
+    data_ = other.data_;
+    size_ = other.size_;
+    capacity_ = other.capacity_;
+    other.data_ = other.inline_data();
+    other.size_ = 0;
+    other.capacity_ = N;
+  }
+};
+
+} // namespace nibi
@@ -1,12 +1,92 @@
 #include "libnibi/source.hpp"
 #include "libnibi/rang.hpp"
 
+#include <deque>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <vector>
 
 namespace nibi {
+
+namespace {
+
+//! \brief Names of every source that has been given an id
+//! \note  Shared by all source managers and threads. Names are kept
+//!        in a deque so pointers to them stay valid as it grows
+class source_table_c {
+public:
+  uint32_t id_of(const std::string &name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = ids_.find(name);
+    if (it != ids_.end()) {
+      return it->second;
+    }
+    if (names_.size() >= packed_locator_s::MAX_SOURCE) {
+      // Out of ids, later sources are reported without a name
+      return 0;
+    }
+    names_.push_back(name);
+    // Id 0 is no source
+    auto id = static_cast<uint32_t>(names_.size());
+    ids_[name] = id;
+    return id;
+  }
+
+  const char *name_of(const uint32_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id == 0 || id > names_.size()) {
+      return "";
+    }
+    return names_[id - 1].c_str();
+  }
+
+private:
+  std::mutex mutex_;
+  std::deque<std::string> names_;
+  std::unordered_map<std::string, uint32_t> ids_;
+};
+
+// Never destroyed, errors may be reported during static destruction
+source_table_c &get_source_table() {
+  static source_table_c *table = new source_table_c();
+  return *table;
+}
+
+} // namespace
+
+const char *locator_c::get_source_name() const {
+  return source_manager_c::get_source_name(location_.source_id());
+}
+
+source_origin_c::source_origin_c(std::string source_name)
+    : source_name_(source_name),
+      id_(source_manager_c::get_source_id(source_name)) {}
+
+uint32_t source_manager_c::get_source_id(const std::string &source_name) {
+  return get_source_table().id_of(source_name);
+}
+
+const char *source_manager_c::get_source_name(const uint32_t source_id) {
+  return get_source_table().name_of(source_id);
+}
+
+locator_ptr source_manager_c::resolve(const packed_locator_s location) {
+  if (!location) {
+    return nullptr;
+  }
+  return new locator_c(location);
+}
+
+packed_locator_s source_manager_c::pack(const locator_ptr &locator) {
+  if (!locator) {
+    return {};
+  }
+  return packed_locator_s(get_source_id(locator->get_source_name()),
+                          locator->get_line(), locator->get_column());
+}
+
 void draw_locator(locator_if &location) {
 
   std::cout << rang::fg::magenta << location.get_source_name()
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <tuple>
@@ -24,29 +25,53 @@ using locator_ptr = nibi::ref_counted_ptr_c<locator_if>;
 
 extern void draw_locator(locator_if &location);
 
-//! \brief A locator implementation.
+//! \brief A location in a source packed into a single word
+//! \note  The top 20 bits hold the id the source was given by
+//!        source_manager_c, the next 28 the line and the low 16 the
+//!        column. Lines and columns past their range are clamped.
+//!        A value of 0 is no location
+struct packed_locator_s {
+  static constexpr uint64_t COLUMN_BITS = 16;
+  static constexpr uint64_t LINE_BITS = 28;
+  static constexpr uint64_t SOURCE_BITS = 20;
+  static constexpr uint64_t MAX_COLUMN = (1ull << COLUMN_BITS) - 1;
+  static constexpr uint64_t MAX_LINE = (1ull << LINE_BITS) - 1;
+  static constexpr uint64_t MAX_SOURCE = (1ull << SOURCE_BITS) - 1;
+
+  uint64_t bits{0};
+
+  packed_locator_s() = default;
+  packed_locator_s(const uint32_t source_id, const size_t line,
+                   const size_t column)
+      : bits((uint64_t)source_id << (LINE_BITS + COLUMN_BITS) |
+             (uint64_t)(line < MAX_LINE ? line : MAX_LINE) << COLUMN_BITS |
+             (uint64_t)(column < MAX_COLUMN ? column : MAX_COLUMN)) {}
+
+  uint32_t source_id() const {
+    return (uint32_t)(bits >> (LINE_BITS + COLUMN_BITS));
+  }
+  size_t line() const { return (bits >> COLUMN_BITS) & MAX_LINE; }
+  size_t column() const { return bits & MAX_COLUMN; }
+  explicit operator bool() const { return bits != 0; }
+};
+
+//! \brief A locator implementation, resolved from a packed location
 class locator_c final : public locator_if {
 public:
   //! \brief Create the locator.
-  //! \param source The name of the source.
-  //! \param line The line of the source.
-  //! \param column The column of the source.
-  locator_c(std::shared_ptr<std::string> source, const size_t line,
-            const size_t column)
-      : line_(line), column_(column), source_name_(source) {}
+  //! \param location The packed location.
+  locator_c(const packed_locator_s location) : location_(location) {}
   virtual std::tuple<size_t, size_t> get_line_column() const override {
-    return std::make_tuple(line_, column_);
+    return std::make_tuple(location_.line(), location_.column());
   }
-  virtual const size_t get_line() const override { return line_; }
-  virtual const size_t get_column() const override { return column_; }
-  virtual const char *get_source_name() const override {
-    return source_name_->c_str();
+  virtual const size_t get_line() const override { return location_.line(); }
+  virtual const size_t get_column() const override {
+    return location_.column();
   }
+  virtual const char *get_source_name() const override;
 
 private:
-  const size_t line_{0};
-  const size_t column_{0};
-  std::shared_ptr<std::string> source_name_{nullptr};
+  const packed_locator_s location_;
 };
 
 //! \brief A source origin. (File, string, etc.)
@@ -59,21 +84,33 @@ public:
 
   //! \brief Create a source origin.
   //! \param source_name The name of the source.
-  source_origin_c(std::string source_name)
-      : source_name_(std::make_shared<std::string>(source_name)) {}
+  source_origin_c(std::string source_name);
 
   //! \brief Get the name of the source.
-  std::string get_source_name() { return *source_name_; }
+  std::string get_source_name() { return source_name_; }
+
+  //! \brief Get the id of the source, see source_manager_c
+  uint32_t get_id() const { return id_; }
+
+  //! \brief Get a packed location in the source.
+  packed_locator_s pack(const size_t line, const size_t column) const {
+    return packed_locator_s(id_, line, column);
+  }
+
   //! \brief Get a locator interface for the source.
   locator_ptr get_locator(const size_t line, const size_t column) const {
-    return new locator_c(source_name_, line, column);
+    return new locator_c(pack(line, column));
   }
 
 private:
-  std::shared_ptr<std::string> source_name_{nullptr};
+  std::string source_name_;
+  uint32_t id_{0};
 };
 
 //! \brief A source manager that manages all the sources.
+//! \note  Source names are given ids that are shared by every manager
+//!        and never reused, so a packed location can be resolved
+//!        without knowing which manager the source came from
 class source_manager_c {
 public:
   //! \brief Get a source by name.
@@ -94,6 +131,22 @@ public:
   }
   inline void clear() { sources_.clear(); }
 
+  //! \brief Get the id of a source name, giving it one if it has none
+  static uint32_t get_source_id(const std::string &source_name);
+
+  //! \brief Get the name of a source id
+  //! \returns The name, or an empty string if the id is unknown. The
+  //!          string lives as long as the program
+  static const char *get_source_name(const uint32_t source_id);
+
+  //! \brief Get a locator interface for a packed location
+  //! \returns The locator, or nullptr if there is no location
+  static locator_ptr resolve(const packed_locator_s location);
+
+  //! \brief Pack the location of a locator interface
+  //! \returns The packed location, or 0 if there is no locator
+  static packed_locator_s pack(const locator_ptr &locator);
+
 private:
   std::unordered_map<std::string, std::shared_ptr<source_origin_c>> sources_;
 };
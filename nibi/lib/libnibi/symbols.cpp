@@ -0,0 +1,106 @@
+#include "libnibi/symbols.hpp"
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+/*
+    Every symbol the parser sees is interned here once and from then on
+    handled as a 32 bit id. Environments are keyed on those ids, so a
+    variable lookup is an integer compare rather than a string compare.
+
+    Names are stored in fixed size chunks that are never moved or freed,
+    so `name_of` can hand out references without holding the lock. A
+    chunk pointer is published with release semantics before any id
+    within it is returned from `intern`.
+*/
+
+namespace nibi {
+namespace symbols {
+
+namespace {
+
+static constexpr std::size_t CHUNK_SIZE = 4096;
+static constexpr std::size_t MAX_CHUNKS = 4096;
+
+class symbol_table_c {
+public:
+  symbol_table_c() { intern(""); }
+
+  symbol_id_t intern(const std::string_view name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = ids_.find(name);
+    if (it != ids_.end()) {
+      return it->second;
+    }
+
+    auto id = static_cast<symbol_id_t>(count_);
+    auto chunk_idx = count_ / CHUNK_SIZE;
+    if (chunk_idx >= MAX_CHUNKS) {
+      throw std::length_error("Symbol table exhausted");
+    }
+
+    auto *chunk = chunks_[chunk_idx].load(std::memory_order_relaxed);
+    if (!chunk) {
+      chunk = new std::string[CHUNK_SIZE];
+      chunks_[chunk_idx].store(chunk, std::memory_order_release);
+    }
+
+    auto &stored = chunk[count_ % CHUNK_SIZE];
+    stored = name;
+    count_++;
+
+    // Key on the stored copy, it never moves
+    ids_[stored] = id;
+    return id;
+  }
+
+  std::optional<symbol_id_t> find(const std::string_view name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = ids_.find(name);
+    if (it == ids_.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+
+  const std::string &name_of(const symbol_id_t id) const {
+    auto *chunk = chunks_[id / CHUNK_SIZE].load(std::memory_order_acquire);
+    assert(chunk);
+    return chunk[id % CHUNK_SIZE];
+  }
+
+private:
+  std::mutex mutex_;
+  std::unordered_map<std::string_view, symbol_id_t> ids_;
+  std::array<std::atomic<std::string *>, MAX_CHUNKS> chunks_{};
+  std::size_t count_{0};
+};
+
+// Never destroyed, cells may be released (and named in errors)
+// during static destruction
+symbol_table_c &get_table() {
+  static symbol_table_c *table = new symbol_table_c();
+  return *table;
+}
+
+} // namespace
+
+symbol_id_t intern(const std::string_view name) {
+  return get_table().intern(name);
+}
+
+std::optional<symbol_id_t> find(const std::string_view name) {
+  return get_table().find(name);
+}
+
+const std::string &name_of(const symbol_id_t id) {
+  return get_table().name_of(id);
+}
+
+} // namespace symbols
+} // namespace nibi
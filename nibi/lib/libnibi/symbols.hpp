@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace nibi {
+
+//! \brief Identifier of an interned symbol
+using symbol_id_t = uint32_t;
+
+namespace symbols {
+
+//! \brief The id of the empty symbol, which is always interned
+static constexpr symbol_id_t EMPTY_SYMBOL_ID = 0;
+
+//! \brief Get the id of a name, interning it if it has not been seen
+//! \param name The name to intern
+//! \returns The id that every occurrence of the name will share
+//! \note Ids are process wide and are never released
+extern symbol_id_t intern(const std::string_view name);
+
+//! \brief Get the id of a name without interning it
+//! \param name The name to find
+//! \returns The id if the name has been interned, otherwise nullopt
+//! \note Anything keyed on symbol ids can not contain a name
+//!       that has never been interned
+extern std::optional<symbol_id_t> find(const std::string_view name);
+
+//! \brief Get the name of an interned symbol
+//! \param id An id returned by `intern`
+//! \returns The name. The reference remains valid for the life
+//!          of the process
+extern const std::string &name_of(const symbol_id_t id);
+
+} // namespace symbols
+} // namespace nibi
@@ -1,7 +1,50 @@
 #include "lib.hpp"
 
+#include <cctype>
 #include <iostream>
+#include <libnibi/alloc_profiler.hpp>
+#include <libnibi/allocator.hpp>
+#include <libnibi/collector.hpp>
+#include <libnibi/heap.hpp>
 #include <libnibi/macros.hpp>
+#include <sstream>
+
+namespace {
+
+// Sum the live counts of every cell type, or of the single type named
+// by the optional argument (`list`, `string`, ...)
+nibi::heap::type_stats_s get_type_stats(nibi::cell_processor_if &ci,
+                                        nibi::cell_list_t &list,
+                                        nibi::env_c &env) {
+  std::string name;
+  if (list.size() == 2) {
+    name = ci.process_cell(list[1], env)->to_string();
+    for (auto &c : name) {
+      c = std::toupper(static_cast<unsigned char>(c));
+    }
+  }
+
+  nibi::heap::type_stats_s total;
+  bool found = name.empty();
+  for (std::size_t i = 0; i <= UINT8_MAX; i++) {
+    auto type = static_cast<nibi::cell_type_e>(i);
+    if (!name.empty() && name != nibi::cell_type_to_string(type)) {
+      continue;
+    }
+    auto stats = nibi::heap::get_type_stats(type);
+    total.live_cells += stats.live_cells;
+    total.payload_bytes += stats.payload_bytes;
+    found = true;
+  }
+
+  if (!found) {
+    throw nibi::interpreter_c::exception_c("Unknown cell type `" + name + "`",
+                                           list[1]->locator());
+  }
+  return total;
+}
+
+} // namespace
 
 nibi::cell_ptr meta_cell(nibi::cell_processor_if &ci, nibi::cell_list_t &list,
                          nibi::env_c &env) {
@@ -12,3 +55,207 @@ nibi::cell_ptr meta_locator(nibi::cell_processor_if &ci,
                             nibi::cell_list_t &list, nibi::env_c &env) {
   return nibi::allocate_cell((int64_t)sizeof(nibi::locator_ptr));
 }
+
+nibi::cell_ptr meta_collect_cycles(nibi::cell_processor_if &ci,
+                                   nibi::cell_list_t &list, nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_collect_cycles}", ==, 1)
+  return nibi::allocate_cell((int64_t)nibi::collector::collect());
+}
+
+nibi::cell_ptr meta_collected_bytes(nibi::cell_processor_if &ci,
+                                    nibi::cell_list_t &list,
+                                    nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_collected_bytes}", ==, 1)
+  return nibi::allocate_cell(
+      (int64_t)nibi::collector::get_stats().collected_bytes);
+}
+
+nibi::cell_ptr meta_collected_cells(nibi::cell_processor_if &ci,
+                                    nibi::cell_list_t &list,
+                                    nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_collected_cells}", ==, 1)
+  return nibi::allocate_cell(
+      (int64_t)nibi::collector::get_stats().collected_cells);
+}
+
+nibi::cell_ptr meta_pending_roots(nibi::cell_processor_if &ci,
+                                  nibi::cell_list_t &list, nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_pending_roots}", ==, 1)
+  return nibi::allocate_cell((int64_t)nibi::collector::get_pending_roots());
+}
+
+nibi::cell_ptr meta_cycle_budget(nibi::cell_processor_if &ci,
+                                 nibi::cell_list_t &list, nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_cycle_budget}", <=, 2)
+  if (list.size() == 2) {
+    auto budget = ci.process_cell(list[1], env)->to_integer();
+    if (budget <= 0) {
+      throw nibi::interpreter_c::exception_c(
+          "Cycle collector budget must be positive", list[1]->locator());
+    }
+    nibi::collector::set_step_budget(budget);
+  }
+  return nibi::allocate_cell((int64_t)nibi::collector::get_step_budget());
+}
+
+nibi::cell_ptr meta_queue_depth(nibi::cell_processor_if &ci,
+                                nibi::cell_list_t &list, nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_queue_depth}", ==, 1)
+  return nibi::allocate_cell((int64_t)nibi::collector::get_queue_depth());
+}
+
+nibi::cell_ptr meta_last_pause_ns(nibi::cell_processor_if &ci,
+                                  nibi::cell_list_t &list, nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_last_pause_ns}", ==, 1)
+  return nibi::allocate_cell(
+      (int64_t)nibi::collector::get_stats().last_pause_ns);
+}
+
+nibi::cell_ptr meta_max_pause_ns(nibi::cell_processor_if &ci,
+                                 nibi::cell_list_t &list, nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_max_pause_ns}", ==, 1)
+  return nibi::allocate_cell(
+      (int64_t)nibi::collector::get_stats().max_pause_ns);
+}
+
+nibi::cell_ptr meta_total_pause_ns(nibi::cell_processor_if &ci,
+                                   nibi::cell_list_t &list, nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_total_pause_ns}", ==, 1)
+  return nibi::allocate_cell(
+      (int64_t)nibi::collector::get_stats().total_pause_ns);
+}
+
+nibi::cell_ptr meta_drain_budget(nibi::cell_processor_if &ci,
+                                 nibi::cell_list_t &list, nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_drain_budget}", <=, 2)
+  if (list.size() == 2) {
+    auto budget = ci.process_cell(list[1], env)->to_integer();
+    if (budget <= 0) {
+      throw nibi::interpreter_c::exception_c(
+          "Release queue budget must be positive", list[1]->locator());
+    }
+    nibi::collector::set_drain_budget(budget);
+  }
+  return nibi::allocate_cell((int64_t)nibi::collector::get_drain_budget());
+}
+
+nibi::cell_ptr meta_allocations(nibi::cell_processor_if &ci,
+                                nibi::cell_list_t &list, nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_allocations}", <=, 2)
+
+  using nibi::allocator::pool_e;
+
+  std::string name;
+  if (list.size() == 2) {
+    name = ci.process_cell(list[1], env)->to_string();
+  }
+
+  int64_t total = 0;
+  bool found = name.empty();
+  for (std::size_t i = 0; i < static_cast<std::size_t>(pool_e::COUNT); i++) {
+    auto pool = static_cast<pool_e>(i);
+    if (name.empty() || name == nibi::allocator::pool_name(pool)) {
+      total += nibi::allocator::get_pool_stats(pool).allocations;
+      found = true;
+    }
+  }
+
+  if (!found) {
+    throw nibi::interpreter_c::exception_c("Unknown allocation pool `" +
+                                               name + "`",
+                                           list[1]->locator());
+  }
+  return nibi::allocate_cell(total);
+}
+
+nibi::cell_ptr meta_heap_allocations(nibi::cell_processor_if &ci,
+                                     nibi::cell_list_t &list,
+                                     nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_heap_allocations}", ==, 1)
+  return nibi::allocate_cell((int64_t)nibi::heap::get_stats().allocations);
+}
+
+nibi::cell_ptr meta_heap_frees(nibi::cell_processor_if &ci,
+                               nibi::cell_list_t &list, nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_heap_frees}", ==, 1)
+  return nibi::allocate_cell((int64_t)nibi::heap::get_stats().frees);
+}
+
+nibi::cell_ptr meta_live_cells(nibi::cell_processor_if &ci,
+                               nibi::cell_list_t &list, nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_live_cells}", <=, 2)
+  return nibi::allocate_cell(
+      (int64_t)get_type_stats(ci, list, env).live_cells);
+}
+
+nibi::cell_ptr meta_payload_bytes(nibi::cell_processor_if &ci,
+                                  nibi::cell_list_t &list, nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_payload_bytes}", <=, 2)
+  return nibi::allocate_cell(
+      (int64_t)get_type_stats(ci, list, env).payload_bytes);
+}
+
+nibi::cell_ptr meta_live_bytes(nibi::cell_processor_if &ci,
+                               nibi::cell_list_t &list, nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_live_bytes}", ==, 1)
+  return nibi::allocate_cell((int64_t)nibi::heap::get_stats().live_bytes);
+}
+
+nibi::cell_ptr meta_peak_bytes(nibi::cell_processor_if &ci,
+                               nibi::cell_list_t &list, nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_peak_bytes}", ==, 1)
+  return nibi::allocate_cell((int64_t)nibi::heap::get_stats().peak_bytes);
+}
+
+nibi::cell_ptr meta_memory_budget(nibi::cell_processor_if &ci,
+                                  nibi::cell_list_t &list, nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_memory_budget}", <=, 2)
+  if (list.size() == 1) {
+    return nibi::allocate_cell((int64_t)ci.memory_available());
+  }
+  auto budget = ci.process_cell(list[1], env)->to_integer();
+  if (budget < 0) {
+    throw nibi::interpreter_c::exception_c(
+        "Memory budget must not be negative", list[1]->locator());
+  }
+  return nibi::allocate_cell((int64_t)ci.limit_memory(budget));
+}
+
+nibi::cell_ptr meta_alloc_profile(nibi::cell_processor_if &ci,
+                                  nibi::cell_list_t &list, nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_alloc_profile}", <=, 2)
+  if (list.size() == 2) {
+    if (ci.process_cell(list[1], env)->to_integer()) {
+      nibi::alloc_profiler::enable();
+    } else {
+      nibi::alloc_profiler::disable();
+    }
+  }
+  return nibi::allocate_cell((int64_t)nibi::alloc_profiler::is_enabled());
+}
+
+nibi::cell_ptr meta_alloc_report(nibi::cell_processor_if &ci,
+                                 nibi::cell_list_t &list, nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_alloc_report}", <=, 2)
+  std::size_t limit{0};
+  if (list.size() == 2) {
+    auto sites = ci.process_cell(list[1], env)->to_integer();
+    if (sites < 0) {
+      throw nibi::interpreter_c::exception_c(
+          "Number of sites must not be negative", list[1]->locator());
+    }
+    limit = sites;
+  }
+  std::ostringstream out;
+  nibi::alloc_profiler::write_report(out, limit);
+  return nibi::allocate_cell(out.str());
+}
+
+nibi::cell_ptr meta_alloc_collapsed(nibi::cell_processor_if &ci,
+                                    nibi::cell_list_t &list,
+                                    nibi::env_c &env) {
+  NIBI_LIST_ENFORCE_SIZE("{meta meta_alloc_collapsed}", ==, 1)
+  std::ostringstream out;
+  nibi::alloc_profiler::write_collapsed(out);
+  return nibi::allocate_cell(out.str());
+}
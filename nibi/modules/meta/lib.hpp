@@ -16,4 +16,88 @@ extern nibi::cell_ptr meta_cell(nibi::cell_processor_if &ci,
 API_EXPORT
 extern nibi::cell_ptr meta_locator(nibi::cell_processor_if &ci,
                                    nibi::cell_list_t &list, nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_collect_cycles(nibi::cell_processor_if &ci,
+                                          nibi::cell_list_t &list,
+                                          nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_collected_bytes(nibi::cell_processor_if &ci,
+                                           nibi::cell_list_t &list,
+                                           nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_collected_cells(nibi::cell_processor_if &ci,
+                                           nibi::cell_list_t &list,
+                                           nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_pending_roots(nibi::cell_processor_if &ci,
+                                         nibi::cell_list_t &list,
+                                         nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_cycle_budget(nibi::cell_processor_if &ci,
+                                        nibi::cell_list_t &list,
+                                        nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_queue_depth(nibi::cell_processor_if &ci,
+                                       nibi::cell_list_t &list,
+                                       nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_last_pause_ns(nibi::cell_processor_if &ci,
+                                         nibi::cell_list_t &list,
+                                         nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_max_pause_ns(nibi::cell_processor_if &ci,
+                                        nibi::cell_list_t &list,
+                                        nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_total_pause_ns(nibi::cell_processor_if &ci,
+                                          nibi::cell_list_t &list,
+                                          nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_drain_budget(nibi::cell_processor_if &ci,
+                                        nibi::cell_list_t &list,
+                                        nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_allocations(nibi::cell_processor_if &ci,
+                                       nibi::cell_list_t &list,
+                                       nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_heap_allocations(nibi::cell_processor_if &ci,
+                                            nibi::cell_list_t &list,
+                                            nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_heap_frees(nibi::cell_processor_if &ci,
+                                      nibi::cell_list_t &list,
+                                      nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_live_cells(nibi::cell_processor_if &ci,
+                                      nibi::cell_list_t &list,
+                                      nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_payload_bytes(nibi::cell_processor_if &ci,
+                                         nibi::cell_list_t &list,
+                                         nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_live_bytes(nibi::cell_processor_if &ci,
+                                      nibi::cell_list_t &list,
+                                      nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_peak_bytes(nibi::cell_processor_if &ci,
+                                      nibi::cell_list_t &list,
+                                      nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_memory_budget(nibi::cell_processor_if &ci,
+                                         nibi::cell_list_t &list,
+                                         nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_alloc_profile(nibi::cell_processor_if &ci,
+                                         nibi::cell_list_t &list,
+                                         nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_alloc_report(nibi::cell_processor_if &ci,
+                                        nibi::cell_list_t &list,
+                                        nibi::env_c &env);
+API_EXPORT
+extern nibi::cell_ptr meta_alloc_collapsed(nibi::cell_processor_if &ci,
+                                           nibi::cell_list_t &list,
+                                           nibi::env_c &env);
 }
@@ -18,6 +18,13 @@ test_directories = [
   check_directory + "/tests"
 ]
 
+# Every test runs under each way the interpreter can run functions
+execution_tiers = [
+  "tree",
+  "bytecode",
+  "closure"
+]
+
 def time_to_ms_str(t):
    return str(round(t * 1000, 4)) + "ms"
 
@@ -40,10 +47,28 @@ def display_result(result_item):
 
    print(out)
 
-def test_item(id, expected_result, item):
+# A test may give the interpreter more options on its first line,
+# as in `# args: --mem-budget 2000000`
+def options_of(item):
+   with open(item) as f:
+      first = f.readline()
+   if first.startswith("# args:"):
+      return first[len("# args:"):].split()
+   return []
+
+# A test that fails may give the line and column its error has to be
+# reported at on its first line, as in `# location: 6,3`
+def location_of(item):
+   with open(item) as f:
+      first = f.readline()
+   if first.startswith("# location:"):
+      return item + " : (" + first[len("# location:"):].strip() + ")"
+   return None
+
+def test_item(id, expected_result, item, tier):
    results = {}
    start = time.time()
-   result = subprocess.run([binary, item], stdout=subprocess.PIPE)
+   result = subprocess.run([binary, "--tier", tier] + options_of(item) + [item], stdout=subprocess.PIPE)
    end = time.time()
    parser_status = True
 
@@ -52,11 +77,13 @@ def test_item(id, expected_result, item):
    except:
       print("Failed to decode output: ", str(result))
       exit(1)
-   results["name"] = item
+   results["name"] = item + " (" + tier + ")"
 
+   location = location_of(item)
    results["result"] = {
    "time": end - start,
-   "success": result.returncode == int(expected_result),
+   "success": result.returncode == int(expected_result) and
+              (location is None or location in decoded),
    "output": decoded
    }
    return results
@@ -83,7 +110,8 @@ def build_exec_list(dirs):
 def task(id, jobs):
    results = []
    for item in jobs:
-      results.append(test_item(id, item["expected_code"], item["path"]))
+      for tier in execution_tiers:
+         results.append(test_item(id, item["expected_code"], item["path"], tier))
    for item in results:
       display_result(item)
 